@@ -24,51 +24,45 @@
 #include <err.h>
 #include <errno.h>
 #include <stdio.h>
-#include <stdint.h>
 #include <fcntl.h>
+#include <linux/joystick.h>
 #include <unistd.h>
 
 #include "uev.h"
 
-struct js_event {
-	uint32_t time;		/* event timestamp in milliseconds */
-	int16_t  value;		/* value */
-	uint8_t  type;		/* event type */
-	uint8_t  number;	/* axis/button number */
-} e;
-
 /*
  * Always check for UEV_ERROR in watcher callback!
  * Possibly joystick was unplugged
+ *
+ * Each callback gets a batch of events, intermediate axis motion has
+ * already been merged by libuEv.
  */
-static void joystick_cb(uev_t *w, void *arg, int events)
+static void joystick_cb(uev_t *w, void *arg, int events, void *batch, size_t num)
 {
-	ssize_t len;
+	struct js_event *e = batch;
+	size_t i;
 
 	if (UEV_ERROR == events) {
 		warnx("Spurious problem with the joystick watcher, restarting.");
 		uev_io_start(w);
-	}
-
-	len = read(w->fd, &e, sizeof(e));
-	if (len < 0) {
-		warn("Failed reading joystick event");
 		return;
 	}
 
-	if (len == 0 || UEV_HUP == events) {
-		warn("Joystick disconnected");
+	if (UEV_HUP & events) {
+		warnx("Joystick disconnected");
 		return;
 	}
 
-	switch (e.type) {
-	case 1:
-		printf("Button %d %s\n", e.number, e.value ? "pressed" : "released");
-		break;
+	for (i = 0; i < num; i++) {
+		switch (e[i].type) {
+		case JS_EVENT_BUTTON:
+			printf("Button %d %s\n", e[i].number, e[i].value ? "pressed" : "released");
+			break;
 
-	case 2:
-		printf("Joystick axis %d moved, value %d!\n", e.number, e.value);
-		break;
+		case JS_EVENT_AXIS:
+			printf("Joystick axis %d moved, value %d!\n", e[i].number, e[i].value);
+			break;
+		}
 	}
 }
 
@@ -78,12 +72,12 @@ int main(void)
 	uev_t js1_watcher;
 	uev_ctx_t ctx;
 
-	fd = open("/dev/input/js1", O_RDONLY, O_NONBLOCK);
+	fd = open("/dev/input/js1", O_RDONLY | O_NONBLOCK);
 	if (fd < 0)
 		errx(errno, "Cannot find a joystick attached.");
 
 	uev_init(&ctx);
-	uev_io_init(&ctx, &js1_watcher, joystick_cb, NULL, fd, UEV_READ);
+	uev_input_init(&ctx, &js1_watcher, joystick_cb, NULL, fd, UEV_INPUT_JOYSTICK);
 
 	puts("Starting, press Ctrl-C to exit.");
 
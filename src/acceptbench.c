@@ -0,0 +1,357 @@
+/* Connect storm benchmark, SO_REUSEPORT vs. descriptor handoff
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "uev.h"
+
+#define UNUSED(arg) arg __attribute__ ((unused))
+#define MAX_WORKERS 64
+
+static int workers = 4, clients = 8, total = 20000, skew, port;
+static int served, active, results[2];
+static uev_t channel;
+
+/* Worker 0 is slower, e.g. a noisy neighbor, when -s is given */
+static void spin(int usec)
+{
+	struct timespec start, now;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	do {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+	} while ((now.tv_sec - start.tv_sec) * 1000000 + (now.tv_nsec - start.tv_nsec) / 1000 < usec);
+}
+
+static void request_cb(uev_t *w, void *arg, int UNUSED(events))
+{
+	char buf[64];
+
+	if (read(w->fd, buf, sizeof(buf)) > 0) {
+		if (arg)
+			spin(skew);
+		if (write(w->fd, buf, 1) < 0)
+			perror("write");
+		served++;
+	}
+
+	uev_io_stop(w);
+	close(w->fd);
+	free(w);
+
+	active--;
+	if (uev_handoff_active(&channel))
+		uev_handoff_load(&channel, active);
+}
+
+static void serve(uev_ctx_t *ctx, int sd, void *slow)
+{
+	uev_t *w = malloc(sizeof(*w));
+
+	if (!w || uev_io_init(ctx, w, request_cb, slow, sd, UEV_READ)) {
+		close(sd);
+		free(w);
+		return;
+	}
+
+	active++;
+	if (uev_handoff_active(&channel))
+		uev_handoff_load(&channel, active);
+}
+
+static void accept_cb(uev_t *w, void *arg, int UNUSED(events))
+{
+	int sd;
+
+	while ((sd = accept4(w->fd, NULL, NULL, SOCK_NONBLOCK)) >= 0)
+		serve(w->ctx, sd, arg);
+}
+
+static void handoff_cb(uev_t *w, void *arg, int events, int sd)
+{
+	if (events & (UEV_HUP | UEV_ERROR)) {
+		uev_exit(w->ctx);
+		return;
+	}
+
+	serve(w->ctx, sd, arg);
+}
+
+/* Acceptor side, every connection goes to the least loaded worker */
+static void dispatch_cb(uev_t *w, void *UNUSED(arg), int UNUSED(events))
+{
+	int sd;
+
+	while ((sd = accept4(w->fd, NULL, NULL, SOCK_NONBLOCK)) >= 0) {
+		if (uev_handoff_send(w->ctx, sd))
+			close(sd);
+	}
+}
+
+static void quit_cb(uev_t *w, void *UNUSED(arg), int UNUSED(events))
+{
+	uev_exit(w->ctx);
+}
+
+static void report(int id)
+{
+	int res[2] = { id, served };
+
+	if (write(results[1], res, sizeof(res)) < 0)
+		perror("write");
+}
+
+static int listener(int reuse)
+{
+	struct sockaddr_in sin = { .sin_family = AF_INET };
+	socklen_t len = sizeof(sin);
+	int sd, on = 1;
+
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	sin.sin_port = htons(port);
+
+	sd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	if (reuse)
+		setsockopt(sd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+	if (bind(sd, (struct sockaddr *)&sin, sizeof(sin)) || listen(sd, 1024)) {
+		perror("bind");
+		exit(1);
+	}
+
+	getsockname(sd, (struct sockaddr *)&sin, &len);
+	port = ntohs(sin.sin_port);
+
+	return sd;
+}
+
+static void client(int num)
+{
+	struct sockaddr_in sin = { .sin_family = AF_INET };
+	int i;
+
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	sin.sin_port = htons(port);
+
+	for (i = 0; i < num; i++) {
+		int sd = socket(AF_INET, SOCK_STREAM, 0);
+		char ch = 'x';
+
+		if (connect(sd, (struct sockaddr *)&sin, sizeof(sin)) ||
+		    write(sd, &ch, 1) != 1 || read(sd, &ch, 1) != 1)
+			perror("client");
+		close(sd);
+	}
+}
+
+static void storm(const char *mode, pid_t *pid, int num)
+{
+	struct timeval start, end;
+	int i, count[MAX_WORKERS] = { 0 };
+	int res[2];
+	double sec;
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < clients; i++) {
+		if (!fork()) {
+			client(total / clients);
+			exit(0);
+		}
+	}
+	for (i = 0; i < clients; i++)
+		wait(NULL);
+	gettimeofday(&end, NULL);
+
+	for (i = 0; i < num; i++)
+		kill(pid[i], SIGTERM);
+	for (i = 0; i < num; i++)
+		waitpid(pid[i], NULL, 0);
+	for (i = 0; i < workers; i++) {
+		if (read(results[0], res, sizeof(res)) == sizeof(res) && res[0] < MAX_WORKERS)
+			count[res[0]] = res[1];
+	}
+
+	timersub(&end, &start, &end);
+	sec = end.tv_sec + end.tv_usec / 1e6;
+	printf("%-9s %8.0f conn/s %8.1f us/conn  served:", mode,
+	       total / clients * clients / sec, sec * 1e6 / (total / clients * clients));
+	for (i = 0; i < workers; i++)
+		printf(" %d", count[i]);
+	printf("\n");
+	fflush(stdout);
+}
+
+/* Worker loop, quit on SIGTERM, or when the acceptor is gone */
+static void worker(int id, int sd, int handoff)
+{
+	void *slow = skew && !id ? &skew : NULL;
+	uev_t io, sig;
+	uev_ctx_t ctx;
+
+	uev_init(&ctx);
+	uev_signal_init(&ctx, &sig, quit_cb, NULL, SIGTERM);
+	if (handoff)
+		uev_handoff_init(&ctx, &channel, handoff_cb, slow, sd);
+	else
+		uev_io_init(&ctx, &io, accept_cb, slow, sd, UEV_READ);
+	uev_run(&ctx, 0);
+
+	report(id);
+	exit(0);
+}
+
+static void reuseport(void)
+{
+	pid_t pid[MAX_WORKERS];
+	int i, sd[MAX_WORKERS];
+
+	port = 0;
+	for (i = 0; i < workers; i++)
+		sd[i] = listener(1);
+
+	for (i = 0; i < workers; i++) {
+		pid[i] = fork();
+		if (!pid[i])
+			worker(i, sd[i], 0);
+	}
+	for (i = 0; i < workers; i++)
+		close(sd[i]);
+
+	storm("reuseport", pid, workers);
+}
+
+static void handoff(void)
+{
+	pid_t pid[MAX_WORKERS + 1];
+	uev_t ch[MAX_WORKERS], io, sig;
+	uev_ctx_t ctx;
+	int i, lsd, sv[MAX_WORKERS][2];
+
+	port = 0;
+	lsd = listener(0);
+
+	for (i = 0; i < workers; i++) {
+		socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK, 0, sv[i]);
+		pid[i] = fork();
+		if (!pid[i]) {
+			close(lsd);
+			close(sv[i][0]);
+			worker(i, sv[i][1], 1);
+		}
+		close(sv[i][1]);
+	}
+
+	pid[workers] = fork();
+	if (!pid[workers]) {
+		uev_init(&ctx);
+		uev_signal_init(&ctx, &sig, quit_cb, NULL, SIGTERM);
+		uev_io_init(&ctx, &io, dispatch_cb, NULL, lsd, UEV_READ);
+		for (i = 0; i < workers; i++)
+			uev_handoff_init(&ctx, &ch[i], NULL, NULL, sv[i][0]);
+		uev_run(&ctx, 0);
+		exit(0);
+	}
+	for (i = 0; i < workers; i++)
+		close(sv[i][0]);
+	close(lsd);
+
+	storm("handoff", pid, workers + 1);
+}
+
+static int usage(int rc)
+{
+	fprintf(stderr,
+		"Usage: acceptbench [-h] [-c NUM] [-n NUM] [-s USEC] [-w NUM]\n"
+		"  -c NUM   Number of client processes, default 8\n"
+		"  -n NUM   Total number of connections, default 20000\n"
+		"  -s USEC  Extra time worker 0 spends per request, default 0\n"
+		"  -w NUM   Number of worker processes, default 4\n");
+	return rc;
+}
+
+int main(int argc, char **argv)
+{
+	sigset_t mask;
+	int c;
+
+	while ((c = getopt(argc, argv, "c:hn:s:w:")) != -1) {
+		switch (c) {
+		case 'c':
+			clients = atoi(optarg);
+			break;
+
+		case 'h':
+			return usage(0);
+
+		case 'n':
+			total = atoi(optarg);
+			break;
+
+		case 's':
+			skew = atoi(optarg);
+			break;
+
+		case 'w':
+			workers = atoi(optarg);
+			break;
+
+		default:
+			return usage(1);
+		}
+	}
+
+	if (workers < 1 || workers > MAX_WORKERS || clients < 1)
+		return usage(1);
+
+	/* Blocked until the workers' signal watchers are set up */
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGTERM);
+	sigprocmask(SIG_BLOCK, &mask, NULL);
+
+	if (pipe(results)) {
+		perror("pipe");
+		return 1;
+	}
+
+	reuseport();
+	handoff();
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -64,7 +64,7 @@ typedef struct {
 } myarg_t;
 
 static int num_pipes, num_active, num_writes;
-static int timers, count, writes, fired;
+static int timers, count, writes, fired, flags, bulk;
 static myarg_t *args;
 static int *pipes;
 static uev_t *evio;
@@ -156,24 +156,42 @@ static struct timeval *run_once(uev_ctx_t *ctx)
 int main(int argc, char **argv)
 {
 	struct rlimit rl;
+	struct timeval ts, te;
 	int i, c;
 	int *cp;
 	uev_ctx_t ctx;
+	uev_io_spec_t *io;
 	extern char *optarg;
 
 	num_pipes = 100;
 	num_active = 1;
 	num_writes = num_pipes;
-	while ((c = getopt(argc, argv, "a:n:tw:")) != -1) {
+	while ((c = getopt(argc, argv, "Aa:Lmn:ptw:")) != -1) {
 		switch (c) {
+		case 'A':
+			flags |= UEV_INIT_AUTO;
+			break;
+
 		case 'a':
 			num_active = atoi(optarg);
 			break;
 
+		case 'L':
+			flags |= UEV_INIT_LAZY;
+			break;
+
+		case 'm':
+			bulk = 1;
+			break;
+
 		case 'n':
 			num_pipes = atoi(optarg);
 			break;
 
+		case 'p':
+			flags |= UEV_INIT_POLL;
+			break;
+
 		case 't':
 			timers = 1;
 			break;
@@ -198,16 +216,13 @@ int main(int argc, char **argv)
 	evio   = calloc(num_pipes, sizeof(uev_t));
 	evto   = calloc(num_pipes, sizeof(uev_t));
 	pipes  = calloc(num_pipes * 2, sizeof(int));
-	if (!args || !evio || !evto || !pipes) {
+	io     = calloc(num_pipes, sizeof(uev_io_spec_t));
+	if (!args || !evio || !evto || !pipes || !io) {
 		perror("calloc");
 		return 1;
 	}
 
-	uev_init(&ctx);
-
 	for (cp = pipes, i = 0; i < num_pipes; i++, cp += 2) {
-		if (timers)
-			uev_timer_init(&ctx, &evto[i], timer_cb, NULL, 0, 0);
 		args[i].index = i;
 
 #ifdef USE_PIPES
@@ -219,12 +234,48 @@ int main(int argc, char **argv)
 			exit(1);
 		}
 
-		uev_io_init(&ctx, &evio[i], read_cb, &args[i], cp[0], UEV_READ);
+		io[i].w      = &evio[i];
+		io[i].fd     = cp[0];
+		io[i].events = UEV_READ;
+		io[i].cb     = read_cb;
+		io[i].arg    = &args[i];
+	}
+
+	/* Start-up cost: context and all watchers */
+	gettimeofday(&ts, NULL);
+	uev_init1(&ctx, flags);
+	for (cp = pipes, i = 0; i < num_pipes; i++, cp += 2) {
+		if (timers)
+			uev_timer_init(&ctx, &evto[i], timer_cb, NULL, 0, 0);
+		if (!bulk)
+			uev_io_init(&ctx, &evio[i], read_cb, &args[i], cp[0], UEV_READ);
 	}
+	if (bulk)
+		uev_io_init_many(&ctx, io, num_pipes);
+	gettimeofday(&te, NULL);
+
+	timersub(&te, &ts, &ts);
+	fprintf(stdout, "%8ld setup\n", ts.tv_sec * 1000000L + ts.tv_usec);
+
+	/* With -L watchers are added to epoll here */
+	gettimeofday(&ts, NULL);
+	uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	gettimeofday(&te, NULL);
+
+	timersub(&te, &ts, &ts);
+	fprintf(stdout, "%8ld first run\n", ts.tv_sec * 1000000L + ts.tv_usec);
 
 	for (i = 0; i < 2; i++)
 		run_once(&ctx);
 
+	/* Shutdown cost, all watchers still active */
+	gettimeofday(&ts, NULL);
+	uev_exit(&ctx);
+	gettimeofday(&te, NULL);
+
+	timersub(&te, &ts, &ts);
+	fprintf(stdout, "%8ld teardown\n", ts.tv_sec * 1000000L + ts.tv_usec);
+
 	return 0;
 }
 
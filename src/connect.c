@@ -0,0 +1,653 @@
+/* libuEv - Non-blocking outbound connect and keep-alive connection pool
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <netinet/in.h>		/* struct sockaddr_in, sockaddr_in6 */
+#include <stdlib.h>		/* calloc(), free() */
+#include <string.h>		/* memcmp(), memcpy(), memmove() */
+#include <sys/socket.h>
+#include <sys/un.h>		/* struct sockaddr_un */
+#include <unistd.h>		/* close() */
+
+#include "uev.h"
+
+#define UNUSED(arg) arg __attribute__ ((unused))
+
+/* Idle connection, closed when @due has passed */
+struct uev_idle {
+	int             sd;
+	uint64_t        due;
+};
+
+/* Idle connections to one destination, most recently returned last */
+struct uev_dest {
+	struct sockaddr_storage sa;
+	socklen_t       len;
+	int             num;
+	struct uev_idle idle[UEV_KEEP_MAX];
+	struct uev_dest *next;
+};
+
+/*
+ * Per context, one timer for all connect timeouts and idle evictions.
+ * Connects with a timeout are kept in a min-heap on due time, so a tick
+ * only looks at those that have expired.
+ */
+struct uev_connector {
+	uev_t           timer;
+	uint64_t        armed;	/* When the timer expires, 0: not armed */
+	uev_t         **heap;
+	int             num;
+	int             size;
+	struct uev_dest *dest;
+};
+
+static void conn_tick(uev_t *t, void *arg, int events);
+
+static uint64_t conn_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static struct uev_connector *connector(uev_ctx_t *ctx)
+{
+	if (!ctx->conn)
+		ctx->conn = calloc(1, sizeof(struct uev_connector));
+
+	return ctx->conn;
+}
+
+/* Expire at @due, unless already set to expire before that */
+static void conn_arm(uev_ctx_t *ctx, uint64_t due)
+{
+	struct uev_connector *cn = ctx->conn;
+	uint64_t now;
+	int msec;
+
+	if (!due || (cn->armed && cn->armed <= due))
+		return;
+
+	now  = conn_now();
+	msec = due > now ? (int)(due - now) : 1;
+	cn->armed = due;
+
+	if (uev_timer_active(&cn->timer))
+		uev_timer_set(&cn->timer, msec, 0);
+	else
+		uev_timer_init(ctx, &cn->timer, conn_tick, cn, msec, 0);
+}
+
+static void due_swap(struct uev_connector *cn, int a, int b)
+{
+	uev_t *w = cn->heap[a];
+
+	cn->heap[a] = cn->heap[b];
+	cn->heap[b] = w;
+	cn->heap[a]->u.cn.pos = a;
+	cn->heap[b]->u.cn.pos = b;
+}
+
+static void due_up(struct uev_connector *cn, int i)
+{
+	while (i > 0) {
+		int parent = (i - 1) / 2;
+
+		if (cn->heap[parent]->u.cn.due <= cn->heap[i]->u.cn.due)
+			break;
+
+		due_swap(cn, parent, i);
+		i = parent;
+	}
+}
+
+static void due_down(struct uev_connector *cn, int i)
+{
+	while (1) {
+		int min = i, l = 2 * i + 1, r = l + 1;
+
+		if (l < cn->num && cn->heap[l]->u.cn.due < cn->heap[min]->u.cn.due)
+			min = l;
+		if (r < cn->num && cn->heap[r]->u.cn.due < cn->heap[min]->u.cn.due)
+			min = r;
+		if (min == i)
+			break;
+
+		due_swap(cn, min, i);
+		i = min;
+	}
+}
+
+static int due_push(struct uev_connector *cn, uev_t *w)
+{
+	if (cn->num == cn->size) {
+		int size = cn->size ? cn->size * 2 : 64;
+		uev_t **heap;
+
+		heap = realloc(cn->heap, size * sizeof(uev_t *));
+		if (!heap)
+			return -1;
+
+		cn->heap = heap;
+		cn->size = size;
+	}
+
+	w->u.cn.pos = cn->num;
+	cn->heap[cn->num++] = w;
+	due_up(cn, w->u.cn.pos);
+
+	return 0;
+}
+
+static void due_del(struct uev_connector *cn, uev_t *w)
+{
+	int i = w->u.cn.pos;
+
+	if (i < 0)
+		return;
+
+	w->u.cn.pos = -1;
+	if (--cn->num == i)
+		return;
+
+	cn->heap[i] = cn->heap[cn->num];
+	cn->heap[i]->u.cn.pos = i;
+	due_up(cn, i);
+	due_down(cn, cn->heap[i]->u.cn.pos);
+}
+
+/* No connect timeouts or idle connections left, let uev_run() return */
+static void conn_idle(struct uev_connector *cn)
+{
+	struct uev_dest *d;
+
+	if (cn->num)
+		return;
+
+	for (d = cn->dest; d; d = d->next) {
+		if (d->num)
+			return;
+	}
+
+	uev_timer_stop(&cn->timer);
+	cn->armed = 0;
+}
+
+/* Connect no longer in progress, the socket is returned */
+static int conn_done(uev_t *w)
+{
+	int sd = w->fd;
+
+	_uev_watcher_stop(w);
+	due_del(w->ctx->conn, w);
+	conn_idle(w->ctx->conn);
+	w->fd = -1;
+
+	return sd;
+}
+
+/* Connected, or failed, the watcher is stopped and the socket handed over */
+static void connected(uev_t *w, int err)
+{
+	int sd = conn_done(w);
+
+	if (err) {
+		close(sd);
+		errno = err;
+		w->u.cn.cb(w, w->arg, UEV_ERROR, -1);
+		return;
+	}
+
+	w->u.cn.cb(w, w->arg, UEV_WRITE, sd);
+}
+
+static void conn_cb(uev_t *w, void *UNUSED(arg), int events)
+{
+	socklen_t len = sizeof(int);
+	int err = w->u.cn.err;
+
+	if (!err && getsockopt(w->fd, SOL_SOCKET, SO_ERROR, &err, &len))
+		err = errno;
+	if (!err && (events & (UEV_ERROR | UEV_HUP)))
+		err = ECONNRESET;
+
+	connected(w, err);
+}
+
+/* Close idle connections past their time, returns next due, or 0 */
+static uint64_t evict(struct uev_connector *cn, uint64_t now)
+{
+	struct uev_dest *d;
+	uint64_t next = 0;
+	int i, n;
+
+	for (d = cn->dest; d; d = d->next) {
+		for (i = n = 0; i < d->num; i++) {
+			if (d->idle[i].due <= now) {
+				close(d->idle[i].sd);
+				continue;
+			}
+
+			if (!next || d->idle[i].due < next)
+				next = d->idle[i].due;
+			d->idle[n++] = d->idle[i];
+		}
+		d->num = n;
+	}
+
+	return next;
+}
+
+static void conn_tick(uev_t *t, void *arg, int UNUSED(events))
+{
+	struct uev_connector *cn = arg;
+	uev_ctx_t *ctx = t->ctx;
+	uint64_t now;
+
+	now = conn_now();
+	cn->armed = 0;
+
+	/* One at a time, callbacks may start or stop other connects */
+	while (cn->num && cn->heap[0]->u.cn.due <= now) {
+		connected(cn->heap[0], ETIMEDOUT);
+		if (ctx->conn != cn)
+			return;	/* uev_exit() called from a callback */
+	}
+
+	if (cn->num)
+		conn_arm(ctx, cn->heap[0]->u.cn.due);
+	conn_arm(ctx, evict(cn, now));
+	conn_idle(cn);
+}
+
+/* Same destination, ignoring any padding in the socket address */
+static int same_peer(const struct sockaddr *a, const struct sockaddr *b, socklen_t len)
+{
+	if (a->sa_family != b->sa_family)
+		return 0;
+
+	switch (a->sa_family) {
+	case AF_INET: {
+		const struct sockaddr_in *x = (const struct sockaddr_in *)a;
+		const struct sockaddr_in *y = (const struct sockaddr_in *)b;
+
+		return x->sin_port == y->sin_port && x->sin_addr.s_addr == y->sin_addr.s_addr;
+	}
+
+	case AF_INET6: {
+		const struct sockaddr_in6 *x = (const struct sockaddr_in6 *)a;
+		const struct sockaddr_in6 *y = (const struct sockaddr_in6 *)b;
+
+		return x->sin6_port == y->sin6_port && x->sin6_scope_id == y->sin6_scope_id &&
+			!memcmp(&x->sin6_addr, &y->sin6_addr, sizeof(x->sin6_addr));
+	}
+
+	case AF_UNIX:
+		return !strncmp(((const struct sockaddr_un *)a)->sun_path,
+				((const struct sockaddr_un *)b)->sun_path,
+				sizeof(((struct sockaddr_un *)a)->sun_path));
+	}
+
+	return !memcmp(a, b, len);
+}
+
+static struct uev_dest *dest_find(struct uev_connector *cn, const struct sockaddr *sa, socklen_t len)
+{
+	struct uev_dest *d;
+
+	for (d = cn->dest; d; d = d->next) {
+		if (same_peer((struct sockaddr *)&d->sa, sa, len < d->len ? len : d->len))
+			return d;
+	}
+
+	return NULL;
+}
+
+/* Non-blocking connect, errors other than EINPROGRESS are saved in @err */
+static int dial(const struct sockaddr *sa, socklen_t len, int *err)
+{
+	int sd;
+
+	sd = socket(sa->sa_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (sd < 0)
+		return -1;
+
+	*err = 0;
+	if (connect(sd, sa, len) && errno != EINPROGRESS)
+		*err = errno;
+
+	return sd;
+}
+
+/* Wait for @sd to be writable, failed connects are reported from there too */
+static int launch(uev_ctx_t *ctx, uev_t *w, uev_connect_cb_t *cb, void *arg, int sd, int err, int timeout)
+{
+	struct uev_connector *cn;
+
+	cn = connector(ctx);
+	if (!cn)
+		return -1;
+
+	if (_uev_watcher_init(ctx, w, UEV_IO_TYPE, conn_cb, arg, sd, UEV_WRITE))
+		return -1;
+
+	w->u.cn.cb  = cb;
+	w->u.cn.due = timeout > 0 ? conn_now() + timeout : 0;
+	w->u.cn.err = err;
+	w->u.cn.pos = -1;
+	if (w->u.cn.due && due_push(cn, w))
+		return -1;
+
+	if (_uev_watcher_start(w)) {
+		due_del(cn, w);
+		return -1;
+	}
+
+	conn_arm(ctx, w->u.cn.due);
+
+	return 0;
+}
+
+/* Add @sd to the idle connections of its peer */
+static int keep(uev_ctx_t *ctx, int sd, int idle)
+{
+	struct sockaddr_storage ss;
+	socklen_t len = sizeof(ss);
+	struct uev_connector *cn;
+	struct uev_dest *d;
+
+	if (!ctx || sd < 0 || idle <= 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	cn = connector(ctx);
+	if (!cn || getpeername(sd, (struct sockaddr *)&ss, &len))
+		return -1;
+
+	d = dest_find(cn, (struct sockaddr *)&ss, len);
+	if (!d) {
+		d = calloc(1, sizeof(*d));
+		if (!d)
+			return -1;
+
+		memcpy(&d->sa, &ss, len);
+		d->len   = len;
+		d->next  = cn->dest;
+		cn->dest = d;
+	}
+
+	/* Full, make room by closing the oldest */
+	if (d->num == UEV_KEEP_MAX) {
+		close(d->idle[0].sd);
+		memmove(&d->idle[0], &d->idle[1], --d->num * sizeof(d->idle[0]));
+	}
+
+	d->idle[d->num].sd  = sd;
+	d->idle[d->num].due = conn_now() + idle;
+	conn_arm(ctx, d->idle[d->num].due);
+	d->num++;
+
+	return 0;
+}
+
+/* Private to libuEv, do not use directly! */
+int _uev_conn_owns(uev_t *w)
+{
+	return w && (w->cb == conn_tick || w->cb == conn_cb);
+}
+
+/* Private to libuEv, do not use directly! */
+void _uev_conn_exit(uev_ctx_t *ctx)
+{
+	struct uev_connector *cn = ctx->conn;
+	uev_t *w;
+
+	if (!cn)
+		return;
+
+	/* The sockets of connects in progress belong to us */
+	LIST_FOREACH(w, &ctx->watchers, link) {
+		if (w->cb == conn_cb && w->fd >= 0) {
+			close(w->fd);
+			w->fd = -1;
+		}
+	}
+
+	evict(cn, (uint64_t)-1);
+	while (cn->dest) {
+		struct uev_dest *d = cn->dest;
+
+		cn->dest = d->next;
+		free(d);
+	}
+
+	uev_timer_stop(&cn->timer);
+	free(cn->heap);
+	free(cn);
+	ctx->conn = NULL;
+}
+
+/**
+ * Connect a stream socket without blocking
+ * @param ctx      A valid libuEv context
+ * @param w        Pointer to an uev_t watcher
+ * @param cb       Callback when connected, or failed
+ * @param arg      Optional callback argument
+ * @param sa       Address to connect to, e.g. struct sockaddr_in
+ * @param len      Length of @param sa
+ * @param timeout  Timeout in milliseconds, or zero to wait for the kernel
+ *
+ * A non-blocking socket is created and connected, @param w is an I/O
+ * watcher waiting for it to be writable.  @param cb is called with
+ * %UEV_WRITE and the connected socket, which from then on belongs to
+ * the application, e.g. to uev_io_init() a watcher for it.  On failure
+ * @param cb is called with %UEV_ERROR, -1, and errno set: the SO_ERROR
+ * of the socket, or %ETIMEDOUT.  Errors from connect() itself are also
+ * reported to @param cb, from the event loop.
+ *
+ * All timeouts share one timer per context, it only runs while there
+ * are connects with a timeout or idle connections.  Use
+ * uev_connect_stop() to cancel, not uev_io_stop(), so the socket is
+ * closed and the timeout removed.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_connect(uev_ctx_t *ctx, uev_t *w, uev_connect_cb_t *cb, void *arg,
+		const struct sockaddr *sa, socklen_t len, int timeout)
+{
+	int sd, err;
+
+	if (!ctx || !w || !cb || !sa) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	sd = dial(sa, len, &err);
+	if (sd < 0)
+		return -1;
+
+	if (launch(ctx, w, cb, arg, sd, err, timeout)) {
+		err = errno;
+		close(sd);
+		errno = err;
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Start several non-blocking connects at once
+ * @param ctx      A valid libuEv context
+ * @param c        Array of connects to start
+ * @param num      Number of entries in @param c
+ * @param timeout  Timeout in milliseconds for all, or zero
+ *
+ * Same as uev_connect() for each entry, but the timer is only armed
+ * once for the whole batch.  Either all are started, or none: if one
+ * fails, the ones already started are stopped and their sockets closed.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_connect_many(uev_ctx_t *ctx, uev_connect_spec_t *c, size_t num, int timeout)
+{
+	size_t i;
+	int err;
+
+	if (!ctx || (!c && num)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	for (i = 0; i < num; i++) {
+		if (!c[i].w || !c[i].cb || !c[i].sa) {
+			errno = EINVAL;
+			return -1;
+		}
+	}
+
+	for (i = 0; i < num; i++) {
+		if (uev_connect(ctx, c[i].w, c[i].cb, c[i].arg, c[i].sa, c[i].len, timeout))
+			break;
+	}
+
+	if (i == num)
+		return 0;
+
+	err = errno;
+	while (i--)
+		uev_connect_stop(c[i].w);
+	errno = err;
+
+	return -1;
+}
+
+/**
+ * Cancel a connect in progress
+ * @param w  Watcher passed to uev_connect() or uev_connect_get()
+ *
+ * The socket is closed and the callback is not called.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_connect_stop(uev_t *w)
+{
+	int sd;
+
+	if (!w || w->cb != conn_cb) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (!_uev_is_active(w))
+		return 0;
+
+	sd = conn_done(w);
+
+	return close(sd);
+}
+
+/**
+ * Connect, reusing an idle connection to the same destination if any
+ * @param ctx      A valid libuEv context
+ * @param w        Pointer to an uev_t watcher
+ * @param cb       Callback when connected, or failed
+ * @param arg      Optional callback argument
+ * @param sa       Address to connect to
+ * @param len      Length of @param sa
+ * @param timeout  Timeout in milliseconds for a new connect, or zero
+ *
+ * Like uev_connect(), but the most recently returned idle connection to
+ * @param sa from uev_connect_put() is used, saving a handshake.  Idle
+ * connections closed by the peer, or with unexpected data to read, are
+ * closed and skipped.  @param cb is always called from the event loop.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_connect_get(uev_ctx_t *ctx, uev_t *w, uev_connect_cb_t *cb, void *arg,
+		    const struct sockaddr *sa, socklen_t len, int timeout)
+{
+	struct uev_dest *d = NULL;
+
+	if (!ctx || !w || !cb || !sa) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (ctx->conn)
+		d = dest_find(ctx->conn, sa, len);
+
+	while (d && d->num > 0) {
+		int sd = d->idle[--d->num].sd;
+		char ch;
+
+		if (recv(sd, &ch, 1, MSG_PEEK | MSG_DONTWAIT) < 0 && errno == EAGAIN) {
+			if (!launch(ctx, w, cb, arg, sd, 0, 0))
+				return 0;
+		}
+
+		close(sd);
+	}
+
+	return uev_connect(ctx, w, cb, arg, sa, len, timeout);
+}
+
+/**
+ * Return a connection to the keep-alive pool
+ * @param ctx   A valid libuEv context
+ * @param sd    Connected socket, from uev_connect_get() or elsewhere
+ * @param idle  Milliseconds to keep it when not used again
+ *
+ * The socket now belongs to the pool, keyed by its peer address, and
+ * is closed after @param idle milliseconds, or when more than
+ * %UEV_KEEP_MAX connections to the same destination are idle, oldest
+ * first.  The application must not have any watcher for @param sd.
+ * On error @param sd is closed.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_connect_put(uev_ctx_t *ctx, int sd, int idle)
+{
+	int err;
+
+	if (!keep(ctx, sd, idle))
+		return 0;
+
+	err = errno;
+	if (sd >= 0)
+		close(sd);
+	errno = err;
+
+	return -1;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,851 @@
+/* libuEv - Asynchronous DNS stub resolver, A, AAAA, and SRV records
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <arpa/inet.h>		/* inet_pton() */
+#include <ctype.h>		/* tolower(), isspace() */
+#include <errno.h>
+#include <stddef.h>		/* offsetof() */
+#include <stdio.h>		/* fopen(), fgets() */
+#include <stdlib.h>		/* calloc(), free() */
+#include <string.h>
+#include <sys/random.h>		/* getrandom() */
+#include <sys/socket.h>
+#include <unistd.h>		/* close() */
+
+#include "uev.h"
+
+#define UNUSED(arg) arg __attribute__ ((unused))
+
+#define DNS_BUCKETS  256
+#define DNS_RETRY    1000	/* msec between retransmits */
+#define DNS_NEG_TTL  30		/* sec, negative answer without SOA */
+#define DNS_TTL_MAX  86400	/* sec, max. time to cache anything */
+#define DNS_BUFSIZE  1232	/* EDNS0 UDP payload size, no fragments */
+
+/* Application waiting for an answer */
+struct dns_waiter {
+	uev_dns_cb_t      *cb;
+	void              *arg;
+	uint64_t           due;	/* Timeout, 0: none */
+	struct dns_waiter *next;
+};
+
+/* Query in flight, shared by all waiters for the same name and type */
+struct dns_query {
+	char               name[256];
+	int                type;
+	uint16_t           id;
+	uint64_t           sent;
+	struct dns_waiter *waiters;
+	struct dns_query  *next_id;
+	struct dns_query  *next_name;
+};
+
+/* Cached answer, err is set for negative answers */
+struct dns_entry {
+	char               name[256];
+	int                type;
+	int                err;
+	int                num;
+	uev_dns_rr_t      *rr;
+	uint64_t           expires;
+	struct dns_entry  *next;
+};
+
+/* Parsed answer */
+struct dns_result {
+	int                err;
+	int                num;
+	uint32_t           ttl;
+	uev_dns_rr_t       rr[UEV_DNS_MAX_RR];
+};
+
+struct uev_dns {
+	uev_t             *w;
+	uev_t              timer;
+	uint64_t           armed;	/* When the timer expires, 0: not armed */
+	int                cached;
+	struct dns_query  *byid[DNS_BUCKETS];
+	struct dns_query  *byname[DNS_BUCKETS];
+	struct dns_entry  *cache[DNS_BUCKETS];
+};
+
+static void dns_tick(uev_t *t, void *arg, int events);
+
+static uint64_t dns_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static unsigned int dns_hash(const char *name, int type)
+{
+	unsigned int h = type;
+
+	while (*name)
+		h = h * 31 + (unsigned char)*name++;
+
+	return h % DNS_BUCKETS;
+}
+
+/* Lower case, without trailing dot, and valid label lengths */
+static int dns_norm(char *dst, const char *src)
+{
+	size_t len = strlen(src), i, label = 0;
+
+	if (len && src[len - 1] == '.')
+		len--;
+	if (!len || len > 253)
+		return -1;
+
+	for (i = 0; i < len; i++) {
+		if (src[i] == '.') {
+			if (!label)
+				return -1;
+			label = 0;
+		} else if (++label > 63) {
+			return -1;
+		}
+		dst[i] = tolower((unsigned char)src[i]);
+	}
+	dst[len] = 0;
+
+	return label ? 0 : -1;
+}
+
+static void dns_arm(struct uev_dns *r, uint64_t due)
+{
+	uint64_t now;
+	int msec;
+
+	if (!due || (r->armed && r->armed <= due))
+		return;
+
+	now  = dns_now();
+	msec = due > now ? (int)(due - now) : 1;
+	r->armed = due;
+
+	if (uev_timer_active(&r->timer))
+		uev_timer_set(&r->timer, msec, 0);
+	else
+		uev_timer_init(r->w->ctx, &r->timer, dns_tick, r, msec, 0);
+}
+
+static void dns_send(struct uev_dns *r, struct dns_query *q)
+{
+	unsigned char buf[12 + 256 + 4 + 11] = { 0 };
+	size_t len = 12;
+	char *label = q->name;
+
+	buf[0]  = q->id >> 8;
+	buf[1]  = q->id & 0xff;
+	buf[2]  = 0x01;		/* RD, recursion desired */
+	buf[5]  = 1;		/* QDCOUNT */
+	buf[11] = 1;		/* ARCOUNT, EDNS0 OPT */
+
+	while (*label) {
+		char *dot = strchr(label, '.');
+		size_t n = dot ? (size_t)(dot - label) : strlen(label);
+
+		buf[len++] = n;
+		memcpy(&buf[len], label, n);
+		len  += n;
+		label += n + (dot ? 1 : 0);
+	}
+	buf[len++] = 0;
+
+	buf[len++] = q->type >> 8;
+	buf[len++] = q->type & 0xff;
+	buf[len++] = 0;
+	buf[len++] = 1;		/* Class IN */
+
+	/* OPT: root name, type 41, class is our UDP payload size */
+	buf[len++] = 0;
+	buf[len++] = 0;
+	buf[len++] = 41;
+	buf[len++] = DNS_BUFSIZE >> 8;
+	buf[len++] = DNS_BUFSIZE & 0xff;
+	len += 6;		/* Extended RCODE, flags, and RDLEN */
+
+	/* Lost or not, the retransmit timer takes care of it */
+	send(r->w->fd, buf, len, 0);
+	q->sent = dns_now();
+}
+
+/* Read a possibly compressed name at @off, returns offset after it */
+static int dns_name(const unsigned char *m, size_t len, size_t off, char *out, size_t outsz)
+{
+	size_t pos = 0, next = 0;
+	int hops = 0;
+
+	while (off < len) {
+		size_t n = m[off];
+
+		if (!n) {
+			if (out) {
+				if (pos)
+					pos--;	/* No trailing dot */
+				out[pos] = 0;
+			}
+			return next ? (int)next : (int)off + 1;
+		}
+
+		if ((n & 0xc0) == 0xc0) {
+			if (off + 1 >= len || ++hops > 16)
+				return -1;
+			if (!next)
+				next = off + 2;
+			off = ((n & 0x3f) << 8) | m[off + 1];
+			continue;
+		}
+
+		if (n > 63 || off + 1 + n > len)
+			return -1;
+
+		if (out) {
+			size_t i;
+
+			if (pos + n + 1 >= outsz)
+				return -1;
+			for (i = 0; i < n; i++)
+				out[pos++] = tolower(m[off + 1 + i]);
+			out[pos++] = '.';
+		}
+		off += n + 1;
+	}
+
+	return -1;
+}
+
+static uint16_t get16(const unsigned char *p)
+{
+	return (p[0] << 8) | p[1];
+}
+
+static uint32_t get32(const unsigned char *p)
+{
+	return ((uint32_t)get16(p) << 16) | get16(p + 2);
+}
+
+/* Parse response to @q, returns -1 if not a valid response to it */
+static int dns_parse(const unsigned char *m, size_t len, struct dns_query *q, struct dns_result *res)
+{
+	int an, ns, off, i, rcode, neg = -1;
+	char name[256];
+
+	if (len < 12 || !(m[2] & 0x80) || get16(&m[4]) != 1)
+		return -1;
+
+	off = dns_name(m, len, 12, name, sizeof(name));
+	if (off < 0 || (size_t)off + 4 > len || strcmp(name, q->name) ||
+	    get16(&m[off]) != q->type || get16(&m[off + 2]) != 1)
+		return -1;
+	off += 4;
+
+	memset(res, 0, offsetof(struct dns_result, rr));
+	res->ttl = DNS_TTL_MAX;
+	if (m[2] & 0x02) {
+		/* Truncated, no TCP fallback in a stub resolver */
+		res->err = EMSGSIZE;
+		res->ttl = 0;
+		return 0;
+	}
+
+	rcode = m[3] & 0x0f;
+	if (rcode != 0 && rcode != 3) {
+		/* SERVFAIL, REFUSED, ... try again later */
+		res->err = EIO;
+		res->ttl = 0;
+		return 0;
+	}
+
+	an = get16(&m[6]);
+	ns = get16(&m[8]);
+	for (i = 0; i < an + ns; i++) {
+		uint16_t type, class, rdlen;
+		uev_dns_rr_t *rr;
+		uint32_t ttl;
+
+		off = dns_name(m, len, off, NULL, 0);
+		if (off < 0 || (size_t)off + 10 > len)
+			return -1;
+
+		type  = get16(&m[off]);
+		class = get16(&m[off + 2]);
+		ttl   = get32(&m[off + 4]);
+		rdlen = get16(&m[off + 8]);
+		off  += 10;
+		if ((size_t)off + rdlen > len)
+			return -1;
+
+		/* Authority section, SOA for negative caching, RFC 2308 */
+		if (i >= an) {
+			if (type == 6 && rdlen >= 20) {
+				uint32_t min = get32(&m[off + rdlen - 4]);
+
+				neg = ttl < min ? ttl : min;
+			}
+			off += rdlen;
+			continue;
+		}
+
+		/* Answers, CNAMEs on the way are skipped */
+		if (type != q->type || class != 1 || res->num == UEV_DNS_MAX_RR) {
+			off += rdlen;
+			continue;
+		}
+
+		rr = &res->rr[res->num];
+		rr->type = type;
+		rr->ttl  = ttl;
+		if (type == UEV_DNS_A && rdlen == 4) {
+			memcpy(&rr->u.a, &m[off], 4);
+		} else if (type == UEV_DNS_AAAA && rdlen == 16) {
+			memcpy(&rr->u.aaaa, &m[off], 16);
+		} else if (type == UEV_DNS_SRV && rdlen >= 7) {
+			rr->u.srv.prio   = get16(&m[off]);
+			rr->u.srv.weight = get16(&m[off + 2]);
+			rr->u.srv.port   = get16(&m[off + 4]);
+			if (dns_name(m, len, off + 6, rr->u.srv.target, sizeof(rr->u.srv.target)) < 0)
+				return -1;
+		} else {
+			return -1;
+		}
+
+		if (ttl < res->ttl)
+			res->ttl = ttl;
+		res->num++;
+		off += rdlen;
+	}
+
+	if (!res->num) {
+		if (rcode == 3)
+			res->err = ENOENT;
+		res->ttl = neg < 0 ? DNS_NEG_TTL : (uint32_t)neg;
+	}
+	if (res->ttl > DNS_TTL_MAX)
+		res->ttl = DNS_TTL_MAX;
+
+	return 0;
+}
+
+static void dns_drop(struct uev_dns *r, struct dns_entry **pe)
+{
+	struct dns_entry *e = *pe;
+
+	*pe = e->next;
+	free(e->rr);
+	free(e);
+	r->cached--;
+}
+
+/* Find unexpired entry, dropping any expired on the way */
+static struct dns_entry *dns_cache_get(struct uev_dns *r, const char *name, int type, uint64_t now)
+{
+	struct dns_entry **pe = &r->cache[dns_hash(name, type)];
+
+	while (*pe) {
+		struct dns_entry *e = *pe;
+
+		if (e->expires <= now) {
+			dns_drop(r, pe);
+			continue;
+		}
+
+		if (e->type == type && !strcmp(e->name, name))
+			return e;
+		pe = &e->next;
+	}
+
+	return NULL;
+}
+
+static void dns_cache_put(struct uev_dns *r, struct dns_query *q, struct dns_result *res)
+{
+	struct dns_entry *e;
+	uint64_t now;
+	int i;
+
+	if (!res->ttl || (res->err && res->err != ENOENT))
+		return;
+
+	now = dns_now();
+	if (r->cached >= UEV_DNS_CACHE_MAX) {
+		for (i = 0; i < DNS_BUCKETS; i++) {
+			struct dns_entry **pe = &r->cache[i];
+
+			while (*pe) {
+				if ((*pe)->expires <= now)
+					dns_drop(r, pe);
+				else
+					pe = &(*pe)->next;
+			}
+		}
+
+		if (r->cached >= UEV_DNS_CACHE_MAX)
+			return;
+	}
+
+	e = calloc(1, sizeof(*e));
+	if (!e)
+		return;
+
+	if (res->num) {
+		e->rr = malloc(res->num * sizeof(uev_dns_rr_t));
+		if (!e->rr) {
+			free(e);
+			return;
+		}
+		memcpy(e->rr, res->rr, res->num * sizeof(uev_dns_rr_t));
+	}
+
+	strcpy(e->name, q->name);
+	e->type    = q->type;
+	e->err     = res->err;
+	e->num     = res->num;
+	e->expires = now + (uint64_t)res->ttl * 1000;
+
+	i = dns_hash(q->name, q->type);
+	e->next = r->cache[i];
+	r->cache[i] = e;
+	r->cached++;
+}
+
+static void dns_unlink(struct uev_dns *r, struct dns_query *q)
+{
+	struct dns_query **pq;
+
+	for (pq = &r->byid[q->id % DNS_BUCKETS]; *pq; pq = &(*pq)->next_id) {
+		if (*pq == q) {
+			*pq = q->next_id;
+			break;
+		}
+	}
+
+	for (pq = &r->byname[dns_hash(q->name, q->type)]; *pq; pq = &(*pq)->next_name) {
+		if (*pq == q) {
+			*pq = q->next_name;
+			break;
+		}
+	}
+}
+
+/* Call back waiters, unless the resolver is stopped by one of them */
+static void dns_notify(uev_t *w, struct uev_dns *r, struct dns_waiter *list, int err,
+		       const uev_dns_rr_t *rr, int num)
+{
+	while (list) {
+		struct dns_waiter *wt = list;
+
+		list = wt->next;
+		if (w->u.dn.r == r) {
+			if (err) {
+				errno = err;
+				wt->cb(w, wt->arg, NULL, -1);
+			} else {
+				wt->cb(w, wt->arg, rr, num);
+			}
+		}
+		free(wt);
+	}
+}
+
+static void dns_answer(uev_t *w, struct uev_dns *r, const unsigned char *buf, size_t len)
+{
+	struct dns_result res;
+	struct dns_waiter *list;
+	struct dns_query *q;
+
+	for (q = r->byid[get16(buf) % DNS_BUCKETS]; q; q = q->next_id) {
+		if (q->id == get16(buf))
+			break;
+	}
+
+	if (!q || dns_parse(buf, len, q, &res))
+		return;
+
+	dns_cache_put(r, q, &res);
+	dns_unlink(r, q);
+	list = q->waiters;
+	free(q);
+
+	dns_notify(w, r, list, res.err, res.rr, res.num);
+}
+
+static void dns_cb(uev_t *w, void *UNUSED(arg), int events)
+{
+	struct uev_dns *r = w->u.dn.r;
+	unsigned char buf[DNS_BUFSIZE];
+	int i;
+
+	/* E.g. ICMP port unreachable, queries are retransmitted or time out */
+	if (events & UEV_ERROR) {
+		socklen_t len = sizeof(i);
+
+		getsockopt(w->fd, SOL_SOCKET, SO_ERROR, &i, &len);
+		uev_io_start(w);
+		return;
+	}
+
+	for (i = 0; i < 64 && w->u.dn.r == r; i++) {
+		ssize_t len;
+
+		len = recv(w->fd, buf, sizeof(buf), 0);
+		if (len < 0)
+			break;
+		if (len >= 12)
+			dns_answer(w, r, buf, len);
+	}
+}
+
+static void dns_tick(uev_t *UNUSED(t), void *arg, int UNUSED(events))
+{
+	struct dns_waiter *expired = NULL;
+	struct uev_dns *r = arg;
+	uev_t *w = r->w;
+	uint64_t now, next = 0;
+	int i;
+
+	now = dns_now();
+	r->armed = 0;
+
+	for (i = 0; i < DNS_BUCKETS; i++) {
+		struct dns_query **pq = &r->byid[i];
+
+		while (*pq) {
+			struct dns_query *q = *pq;
+			struct dns_waiter **pw = &q->waiters;
+
+			while (*pw) {
+				struct dns_waiter *wt = *pw;
+
+				if (wt->due && wt->due <= now) {
+					*pw = wt->next;
+					wt->next = expired;
+					expired = wt;
+					continue;
+				}
+
+				if (wt->due && (!next || wt->due < next))
+					next = wt->due;
+				pw = &wt->next;
+			}
+
+			if (!q->waiters) {
+				dns_unlink(r, q);
+				free(q);
+				continue;
+			}
+
+			if (now >= q->sent + DNS_RETRY)
+				dns_send(r, q);
+			if (!next || q->sent + DNS_RETRY < next)
+				next = q->sent + DNS_RETRY;
+			pq = &q->next_id;
+		}
+	}
+
+	dns_arm(r, next);
+	dns_notify(w, r, expired, ETIMEDOUT, NULL, 0);
+}
+
+/* Read first nameserver from /etc/resolv.conf, or use localhost */
+static void dns_default(struct sockaddr_storage *ss, socklen_t *len)
+{
+	struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)ss;
+	struct sockaddr_in *sin = (struct sockaddr_in *)ss;
+	char line[256];
+	FILE *fp;
+
+	memset(ss, 0, sizeof(*ss));
+	sin->sin_family      = AF_INET;
+	sin->sin_port        = htons(53);
+	sin->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	*len = sizeof(*sin);
+
+	fp = fopen("/etc/resolv.conf", "r");
+	if (!fp)
+		return;
+
+	while (fgets(line, sizeof(line), fp)) {
+		char *addr = line + 10;
+
+		if (strncmp(line, "nameserver", 10) || !isspace((unsigned char)*addr))
+			continue;
+
+		addr += strspn(addr, " \t");
+		addr[strcspn(addr, " \t\r\n%")] = 0;
+		if (inet_pton(AF_INET, addr, &sin->sin_addr) == 1)
+			break;
+
+		if (inet_pton(AF_INET6, addr, &sin6->sin6_addr) == 1) {
+			sin6->sin6_family = AF_INET6;
+			sin6->sin6_port   = htons(53);
+			*len = sizeof(*sin6);
+			break;
+		}
+	}
+	fclose(fp);
+}
+
+static void dns_free(struct uev_dns *r)
+{
+	int i;
+
+	for (i = 0; i < DNS_BUCKETS; i++) {
+		while (r->byid[i]) {
+			struct dns_query *q = r->byid[i];
+
+			r->byid[i] = q->next_id;
+			while (q->waiters) {
+				struct dns_waiter *wt = q->waiters;
+
+				q->waiters = wt->next;
+				free(wt);
+			}
+			free(q);
+		}
+
+		while (r->cache[i])
+			dns_drop(r, &r->cache[i]);
+	}
+
+	uev_timer_stop(&r->timer);
+	free(r);
+}
+
+/* Private to libuEv, do not use directly! */
+int _uev_dns_owns(uev_t *w)
+{
+	return w && w->cb == dns_tick;
+}
+
+/* Private to libuEv, do not use directly! */
+void _uev_dns_exit(uev_ctx_t *ctx)
+{
+	uev_t *w;
+
+	/* Stopping removes it from the list, start over each time */
+	do {
+		LIST_FOREACH(w, &ctx->watchers, link) {
+			if (w->cb == dns_cb)
+				break;
+		}
+	} while (w && !uev_dns_stop(w));
+}
+
+/**
+ * Create a DNS stub resolver
+ * @param ctx     A valid libuEv context
+ * @param w       Pointer to an uev_t watcher
+ * @param server  Recursive name server, or NULL for the first nameserver
+ *                in /etc/resolv.conf
+ * @param len     Length of @param server
+ *
+ * The resolver has one non-blocking UDP socket to @param server, and a
+ * cache of answers per resolver.  Use uev_dns_query() to look up names
+ * and uev_dns_stop() to close it.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_dns_init(uev_ctx_t *ctx, uev_t *w, const struct sockaddr *server, socklen_t len)
+{
+	struct sockaddr_storage ss;
+	struct uev_dns *r;
+	int sd, err;
+
+	if (!ctx || !w || (server && len > sizeof(ss))) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (server)
+		memcpy(&ss, server, len);
+	else
+		dns_default(&ss, &len);
+
+	sd = socket(ss.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (sd < 0)
+		return -1;
+
+	r = calloc(1, sizeof(*r));
+	if (r && !connect(sd, (struct sockaddr *)&ss, len) &&
+	    !_uev_watcher_init(ctx, w, UEV_IO_TYPE, dns_cb, NULL, sd, UEV_READ)) {
+		r->w = w;
+		w->u.dn.r = r;
+		if (!_uev_watcher_start(w))
+			return 0;
+		w->u.dn.r = NULL;
+	}
+
+	err = errno;
+	free(r);
+	close(sd);
+	errno = err;
+
+	return -1;
+}
+
+/**
+ * Look up a name
+ * @param w        Resolver from uev_dns_init()
+ * @param name     Name to look up, e.g. "example.com" or "_sip._udp.example.com"
+ * @param type     Record type: %UEV_DNS_A, %UEV_DNS_AAAA, or %UEV_DNS_SRV
+ * @param timeout  Timeout in milliseconds, or zero to wait indefinitely
+ * @param cb       Callback with the answer
+ * @param arg      Optional callback argument
+ *
+ * Answers are cached for their TTL, and names that do not exist, or
+ * have no records of @param type, for the SOA minimum TTL.  For a cached
+ * answer @param cb is called before uev_dns_query() returns, otherwise
+ * from the event loop.  Queries for a name and type already in flight
+ * are coalesced into it, each with its own @param timeout.  Queries are
+ * retransmitted every second until answered or all have timed out.
+ *
+ * @param cb is called with the records and their number, possibly zero,
+ * or with -1 and errno set: %ENOENT no such name, %ETIMEDOUT, %EIO name
+ * server failure, or %EMSGSIZE when the answer did not fit in a UDP
+ * datagram.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_dns_query(uev_t *w, const char *name, int type, int timeout, uev_dns_cb_t *cb, void *arg)
+{
+	struct dns_waiter *wt, **pw;
+	struct dns_entry *e;
+	struct dns_query *q;
+	struct uev_dns *r;
+	char norm[256];
+	uint64_t now;
+
+	if (!w || w->cb != dns_cb || !w->u.dn.r || !name || !cb || dns_norm(norm, name) ||
+	    (type != UEV_DNS_A && type != UEV_DNS_AAAA && type != UEV_DNS_SRV)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	r   = w->u.dn.r;
+	now = dns_now();
+	e   = dns_cache_get(r, norm, type, now);
+	if (e) {
+		if (e->err) {
+			errno = e->err;
+			cb(w, arg, NULL, -1);
+		} else {
+			cb(w, arg, e->rr, e->num);
+		}
+		return 0;
+	}
+
+	wt = calloc(1, sizeof(*wt));
+	if (!wt)
+		return -1;
+
+	wt->cb  = cb;
+	wt->arg = arg;
+	wt->due = timeout > 0 ? now + timeout : 0;
+
+	for (q = r->byname[dns_hash(norm, type)]; q; q = q->next_name) {
+		if (q->type == type && !strcmp(q->name, norm))
+			break;
+	}
+
+	if (!q) {
+		struct dns_query *p;
+		uint16_t id;
+
+		q = calloc(1, sizeof(*q));
+		if (!q) {
+			free(wt);
+			return -1;
+		}
+
+		/* Random id, unique among queries in flight */
+		do {
+			if (getrandom(&id, sizeof(id), GRND_NONBLOCK) != sizeof(id))
+				id = (uint16_t)random();
+			for (p = r->byid[id % DNS_BUCKETS]; p; p = p->next_id) {
+				if (p->id == id)
+					break;
+			}
+		} while (p);
+
+		strcpy(q->name, norm);
+		q->type = type;
+		q->id   = id;
+		q->next_id   = r->byid[id % DNS_BUCKETS];
+		r->byid[id % DNS_BUCKETS] = q;
+		q->next_name = r->byname[dns_hash(norm, type)];
+		r->byname[dns_hash(norm, type)] = q;
+
+		dns_send(r, q);
+	}
+
+	for (pw = &q->waiters; *pw; pw = &(*pw)->next)
+		;
+	*pw = wt;
+
+	dns_arm(r, wt->due);
+	dns_arm(r, q->sent + DNS_RETRY);
+
+	return 0;
+}
+
+/**
+ * Stop a DNS resolver
+ * @param w  Resolver from uev_dns_init()
+ *
+ * Queries in flight are dropped without calling back, the cache is
+ * freed and the socket closed.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_dns_stop(uev_t *w)
+{
+	if (!w || w->cb != dns_cb) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (w->u.dn.r) {
+		dns_free(w->u.dn.r);
+		w->u.dn.r = NULL;
+	}
+
+	uev_io_stop(w);
+	if (w->fd >= 0)
+		close(w->fd);
+	w->fd = -1;
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
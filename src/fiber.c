@@ -0,0 +1,397 @@
+/* libuEv - Stackful fibers, resumed from the event loop
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <stdint.h>		/* uintptr_t */
+#include <stdlib.h>		/* calloc(), free() */
+#include <sys/mman.h>		/* mmap(), mprotect(), munmap() */
+#include <ucontext.h>
+#include <unistd.h>		/* sysconf() */
+
+#include "uev.h"
+
+#define UNUSED(arg) arg __attribute__ ((unused))
+
+/* Finished fibers kept, with their stacks, for uev_fiber_spawn() */
+#define FIBER_POOL 64
+
+/*
+ * Kept at the top of the fiber's own mapping, above the stack, with a
+ * PROT_NONE guard page at the bottom.  Stack pages are only committed
+ * when first touched.
+ */
+struct uev_fiber {
+	LIST_ENTRY(uev_fiber) link;
+	uev_ctx_t      *ctx;
+	uev_fiber_fn_t *fn;
+	void           *arg;
+
+	ucontext_t      uc;
+	ucontext_t     *back;	/* Resumer, to switch back to */
+
+	uev_t           io;	/* For uev_fiber_wait_io() */
+	uev_t           tm;	/* For uev_fiber_sleep() */
+	int             events;	/* From the watcher that woke us */
+
+	int             running;
+	int             done;
+	int             orphan;	/* uev_exit() while running */
+
+	char           *base;	/* Mapping, guard page first */
+	size_t          len;
+	size_t          stack;	/* Requested size */
+};
+
+struct uev_fibers {
+	struct uev_fiber *current;
+	LIST_HEAD(, uev_fiber) live;
+	LIST_HEAD(, uev_fiber) dead; /* Until the loop is done with watchers */
+	LIST_HEAD(, uev_fiber) pool;
+	int             pooled;
+	size_t          page;
+};
+
+static struct uev_fibers *fibers(uev_ctx_t *ctx)
+{
+	struct uev_fibers *fb = ctx->fib;
+
+	if (fb)
+		return fb;
+
+	fb = calloc(1, sizeof(*fb));
+	if (!fb)
+		return NULL;
+
+	LIST_INIT(&fb->live);
+	LIST_INIT(&fb->dead);
+	LIST_INIT(&fb->pool);
+	fb->page = sysconf(_SC_PAGESIZE);
+	ctx->fib = fb;
+
+	return fb;
+}
+
+static struct uev_fiber *fiber_get(struct uev_fibers *fb, size_t stack)
+{
+	struct uev_fiber *f;
+	size_t len, top;
+	char *base;
+
+	if (stack == UEV_FIBER_STACK && !LIST_EMPTY(&fb->pool)) {
+		f = LIST_FIRST(&fb->pool);
+		LIST_REMOVE(f, link);
+		fb->pooled--;
+		return f;
+	}
+
+	/* Guard page, stack, and fiber on the page(s) at the top */
+	top = (sizeof(*f) + fb->page - 1) & ~(fb->page - 1);
+	len = fb->page + ((stack + fb->page - 1) & ~(fb->page - 1)) + top;
+
+	base = mmap(NULL, len, PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+	if (base == MAP_FAILED)
+		return NULL;
+
+	if (mprotect(base, fb->page, PROT_NONE)) {
+		munmap(base, len);
+		return NULL;
+	}
+
+	f = (struct uev_fiber *)(base + len - top);
+	f->base  = base;
+	f->len   = len;
+	f->stack = stack;
+
+	return f;
+}
+
+static void fiber_put(struct uev_fibers *fb, struct uev_fiber *f)
+{
+	if (f->stack == UEV_FIBER_STACK && fb->pooled < FIBER_POOL) {
+		LIST_INSERT_HEAD(&fb->pool, f, link);
+		fb->pooled++;
+		return;
+	}
+
+	munmap(f->base, f->len);
+}
+
+/* Runs on the fiber's stack, the pointer is split for makecontext() */
+static void trampoline(unsigned int hi, unsigned int lo)
+{
+	struct uev_fiber *f = (struct uev_fiber *)(uintptr_t)(((uint64_t)hi << 32) | lo);
+
+	f->fn(f->ctx, f->arg);
+
+	f->done = 1;
+	setcontext(f->back);
+}
+
+/* Not inlined, getcontext() returns twice and would clobber the caller */
+static __attribute__ ((noinline)) int fiber_make(struct uev_fiber *f, size_t page)
+{
+	uint64_t ptr = (uintptr_t)f;
+
+	if (getcontext(&f->uc))
+		return -1;
+
+	f->uc.uc_stack.ss_sp   = f->base + page;
+	f->uc.uc_stack.ss_size = (char *)f - (f->base + page);
+	f->uc.uc_link          = NULL;
+	makecontext(&f->uc, (void (*)(void))trampoline, 2,
+		    (unsigned int)(ptr >> 32), (unsigned int)ptr);
+
+	return 0;
+}
+
+static void resume(struct uev_fiber *f)
+{
+	struct uev_fibers *fb = f->ctx->fib;
+	struct uev_fiber *prev = fb->current;
+	ucontext_t back;
+
+	f->back    = &back;
+	f->running = 1;
+	fb->current = f;
+
+	swapcontext(&back, &f->uc);
+
+	/* Everything else was freed by uev_exit() */
+	if (f->orphan) {
+		munmap(f->base, f->len);
+		return;
+	}
+
+	f->running  = 0;
+	fb->current = prev;
+
+	/* Watchers of this fiber may still be in use by the event loop */
+	if (f->done) {
+		LIST_REMOVE(f, link);
+		LIST_INSERT_HEAD(&fb->dead, f, link);
+	}
+}
+
+static void suspend(struct uev_fiber *f)
+{
+	swapcontext(&f->uc, f->back);
+}
+
+static void fiber_cb(uev_t *w, void *arg, int events)
+{
+	struct uev_fiber *f = arg;
+
+	if (w == &f->io)
+		uev_io_stop(w);
+	else
+		uev_timer_stop(w);
+
+	f->events = events;
+	resume(f);
+}
+
+static struct uev_fiber *current(uev_ctx_t *ctx)
+{
+	if (!ctx || !ctx->fib || !ctx->fib->current) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	return ctx->fib->current;
+}
+
+/* Private to libuEv, do not use directly! */
+int _uev_fiber_owns(uev_t *w)
+{
+	return w->cb == fiber_cb;
+}
+
+/* Private to libuEv, do not use directly!  Before the loop waits */
+void _uev_fiber_reap(uev_ctx_t *ctx)
+{
+	struct uev_fibers *fb = ctx->fib;
+
+	if (!fb)
+		return;
+
+	while (!LIST_EMPTY(&fb->dead)) {
+		struct uev_fiber *f = LIST_FIRST(&fb->dead);
+
+		LIST_REMOVE(f, link);
+		fiber_put(fb, f);
+	}
+}
+
+/* Private to libuEv, do not use directly!  After all watchers are stopped */
+void _uev_fiber_exit(uev_ctx_t *ctx)
+{
+	struct uev_fibers *fb = ctx->fib;
+	struct uev_fiber *f;
+
+	if (!fb)
+		return;
+
+	/* Suspended fibers are never resumed, running ones free themselves */
+	while (!LIST_EMPTY(&fb->live)) {
+		f = LIST_FIRST(&fb->live);
+		LIST_REMOVE(f, link);
+		if (f->running)
+			f->orphan = 1;
+		else
+			munmap(f->base, f->len);
+	}
+
+	_uev_fiber_reap(ctx);
+	while (!LIST_EMPTY(&fb->pool)) {
+		f = LIST_FIRST(&fb->pool);
+		LIST_REMOVE(f, link);
+		munmap(f->base, f->len);
+	}
+
+	ctx->fib = NULL;
+	free(fb);
+}
+
+/**
+ * Start a fiber
+ * @param ctx    A valid libuEv context
+ * @param fn     Function to run in the fiber
+ * @param arg    Optional argument to @param fn
+ * @param stack  Stack size, or zero for %UEV_FIBER_STACK
+ *
+ * The fiber runs at once, until it calls uev_fiber_wait_io() or
+ * uev_fiber_sleep(), or returns.  It is then resumed from uev_run() when
+ * the descriptor is ready or the time is up.  Stacks have a guard page
+ * below them, and pages are committed when first used, so most of
+ * @param stack only costs address space.  Stacks of the default size
+ * are reused.
+ *
+ * A fiber that is waiting when uev_exit() is called is freed without
+ * being resumed, so anything on its stack is lost.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_fiber_spawn(uev_ctx_t *ctx, uev_fiber_fn_t *fn, void *arg, size_t stack)
+{
+	struct uev_fibers *fb;
+	struct uev_fiber *f;
+	if (!ctx || !ctx->backend || !fn) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (!stack)
+		stack = UEV_FIBER_STACK;
+
+	fb = fibers(ctx);
+	if (!fb)
+		return -1;
+
+	f = fiber_get(fb, stack);
+	if (!f)
+		return -1;
+
+	f->ctx     = ctx;
+	f->fn      = fn;
+	f->arg     = arg;
+	f->running = 0;
+	f->done    = 0;
+	f->orphan  = 0;
+
+	if (fiber_make(f, fb->page)) {
+		fiber_put(fb, f);
+		return -1;
+	}
+
+	LIST_INSERT_HEAD(&fb->live, f, link);
+	resume(f);
+
+	return 0;
+}
+
+/**
+ * Wait in a fiber for a descriptor to be ready
+ * @param ctx     A valid libuEv context
+ * @param fd      Descriptor to wait for
+ * @param events  %UEV_READ, %UEV_WRITE, or both
+ *
+ * Switches back to the event loop, or whoever started or resumed the
+ * fiber, until @param fd is ready.  Must be called from a fiber.
+ *
+ * @return The events received, %UEV_ERROR or %UEV_HUP included, or -1
+ * with @param errno set on error.
+ */
+int uev_fiber_wait_io(uev_ctx_t *ctx, int fd, int events)
+{
+	struct uev_fiber *f;
+
+	f = current(ctx);
+	if (!f)
+		return -1;
+
+	if (uev_io_init(ctx, &f->io, fiber_cb, f, fd, events))
+		return -1;
+
+	suspend(f);
+
+	return f->events;
+}
+
+/**
+ * Sleep in a fiber
+ * @param ctx  A valid libuEv context
+ * @param ms   Time to sleep, in milliseconds
+ *
+ * Switches back to the event loop, or whoever started or resumed the
+ * fiber, until @param ms have passed.  Must be called from a fiber.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_fiber_sleep(uev_ctx_t *ctx, int ms)
+{
+	struct uev_fiber *f;
+
+	if (ms <= 0) {
+		errno = ERANGE;
+		return -1;
+	}
+
+	f = current(ctx);
+	if (!f)
+		return -1;
+
+	if (uev_timer_init(ctx, &f->tm, fiber_cb, f, ms, 0))
+		return -1;
+
+	suspend(f);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
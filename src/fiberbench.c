@@ -0,0 +1,252 @@
+/* libuEv - Micro event loop library
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "uev.h"
+
+#define UNUSED(arg) arg __attribute__ ((unused))
+
+static long rounds = 100000, resumes;
+static int pairs = 1, fibers = 10000;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void ping(uev_ctx_t *ctx, void *arg)
+{
+	int sd = *(int *)arg;
+	long i;
+	char c;
+
+	for (i = 0; i < rounds; i++) {
+		write(sd, "p", 1);
+		uev_fiber_wait_io(ctx, sd, UEV_READ);
+		read(sd, &c, 1);
+		resumes++;
+	}
+}
+
+static void pong(uev_ctx_t *ctx, void *arg)
+{
+	int sd = *(int *)arg;
+	long i;
+	char c;
+
+	for (i = 0; i < rounds; i++) {
+		uev_fiber_wait_io(ctx, sd, UEV_READ);
+		read(sd, &c, 1);
+		write(sd, "P", 1);
+		resumes++;
+	}
+}
+
+/* Same ping-pong, as callbacks, for comparison */
+static void ping_cb(uev_t *w, void *arg, int UNUSED(events))
+{
+	long *n = arg;
+	char c;
+
+	read(w->fd, &c, 1);
+	resumes++;
+	if (++*n < rounds)
+		write(w->fd, "p", 1);
+	else
+		uev_io_stop(w);
+}
+
+static void pong_cb(uev_t *w, void *arg, int UNUSED(events))
+{
+	long *n = arg;
+	char c;
+
+	read(w->fd, &c, 1);
+	write(w->fd, "P", 1);
+	resumes++;
+	if (++*n == rounds)
+		uev_io_stop(w);
+}
+
+static double pingpong(int callbacks)
+{
+	uev_ctx_t ctx;
+	uev_t *w;
+	long *n;
+	double start;
+	int *sv, i;
+
+	sv = calloc(pairs * 2, sizeof(*sv));
+	w  = calloc(pairs * 2, sizeof(*w));
+	n  = calloc(pairs * 2, sizeof(*n));
+	if (!sv || !w || !n) {
+		perror("calloc");
+		exit(1);
+	}
+
+	uev_init(&ctx);
+	for (i = 0; i < pairs; i++) {
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, &sv[2 * i])) {
+			perror("socketpair");
+			exit(1);
+		}
+	}
+
+	start = now();
+	for (i = 0; i < pairs; i++) {
+		if (callbacks) {
+			uev_io_init(&ctx, &w[2 * i + 1], pong_cb, &n[2 * i + 1], sv[2 * i + 1], UEV_READ);
+			uev_io_init(&ctx, &w[2 * i], ping_cb, &n[2 * i], sv[2 * i], UEV_READ);
+			write(sv[2 * i], "p", 1);
+		} else {
+			uev_fiber_spawn(&ctx, pong, &sv[2 * i + 1], 0);
+			uev_fiber_spawn(&ctx, ping, &sv[2 * i], 0);
+		}
+	}
+	uev_run(&ctx, 0);
+	start = now() - start;
+
+	uev_exit(&ctx);
+	for (i = 0; i < pairs * 2; i++)
+		close(sv[i]);
+	free(sv);
+	free(w);
+	free(n);
+
+	return start;
+}
+
+static void sleeper(uev_ctx_t *ctx, void *UNUSED(arg))
+{
+	uev_fiber_sleep(ctx, 3600 * 1000);
+}
+
+static long rss(void)
+{
+	long size = 0, resident = 0;
+	FILE *fp;
+
+	fp = fopen("/proc/self/statm", "r");
+	if (fp) {
+		if (fscanf(fp, "%ld %ld", &size, &resident) != 2)
+			resident = 0;
+		fclose(fp);
+	}
+
+	return resident * sysconf(_SC_PAGESIZE);
+}
+
+static void memory(void)
+{
+	uev_ctx_t ctx;
+	long before;
+	int i;
+
+	uev_init(&ctx);
+
+	before = rss();
+	for (i = 0; i < fibers; i++) {
+		if (uev_fiber_spawn(&ctx, sleeper, NULL, 0)) {
+			perror("uev_fiber_spawn");
+			exit(1);
+		}
+	}
+
+	printf("%d fibers %8.1f KiB resident %8.1f KiB reserved per fiber\n", fibers,
+	       (rss() - before) / 1024.0 / fibers, (UEV_FIBER_STACK + 8192) / 1024.0);
+	uev_exit(&ctx);
+}
+
+static int usage(int rc)
+{
+	fprintf(stderr,
+		"Usage: fiberbench [-chm] [-f FIBERS] [-n ROUNDS] [-p PAIRS]\n"
+		"  -c         Callbacks, the default is fibers\n"
+		"  -f FIBERS  Number of fibers for -m, default 10000\n"
+		"  -h         This help text\n"
+		"  -m         Memory per waiting fiber, instead of ping-pong\n"
+		"  -n ROUNDS  Ping-pong round trips per pair, default 100000\n"
+		"  -p PAIRS   Number of ping-pong pairs, default 1\n");
+	return rc;
+}
+
+int main(int argc, char **argv)
+{
+	int c, callbacks = 0;
+	double sec;
+
+	while ((c = getopt(argc, argv, "cf:hmn:p:")) != -1) {
+		switch (c) {
+		case 'c':
+			callbacks = 1;
+			break;
+
+		case 'f':
+			fibers = atoi(optarg);
+			break;
+
+		case 'h':
+			return usage(0);
+
+		case 'm':
+			memory();
+			return 0;
+
+		case 'n':
+			rounds = atol(optarg);
+			break;
+
+		case 'p':
+			pairs = atoi(optarg);
+			break;
+
+		default:
+			return usage(1);
+		}
+	}
+
+	if (rounds < 1 || pairs < 1 || fibers < 1)
+		return usage(1);
+
+	sec = pingpong(callbacks);
+	printf("%-9s pairs %-4d %10.0f wakeups/s %10.0f switches/s\n",
+	       callbacks ? "callbacks" : "fibers", pairs, resumes / sec,
+	       callbacks ? 0 : 2 * resumes / sec);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,955 @@
+/* libuEv - Micro event loop library
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>		/* UINT32_MAX */
+#include <stdlib.h>		/* calloc(), free() */
+#include <string.h>		/* memset() */
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>		/* pwritev2(), RWF_DSYNC */
+#include <unistd.h>		/* pread(), pwrite(), fsync() */
+#include <linux/io_uring.h>
+
+#include "uev.h"
+
+#define URING_ENTRIES 256
+
+enum { OP_READ, OP_WRITE, OP_FSYNC, OP_RECV, OP_CANCEL, OP_WRITE_DSYNC };
+
+/* Max. completions copied from the CQ before calling back */
+#define REAP_BATCH 64
+
+/* Request, queued on the loop thread until submitted */
+struct uev_file_req {
+	struct uev_file_req *next;
+	uev_t          *w;
+	int             op;
+	int             fd;
+	uint64_t        ud;       /* OP_RECV/OP_CANCEL user_data */
+	void           *buf;
+	size_t          len;
+	off_t           off;
+	ssize_t         res;
+	int             err;
+	uev_file_cb_t  *cb;
+	void           *arg;
+};
+
+/* Completion copied from the CQ */
+struct cqe {
+	uint64_t        ud;
+	int             res;
+	unsigned int    flags;
+};
+
+/* Raw io_uring, no dependency on liburing */
+struct ring {
+	int             fd;
+	unsigned int    entries;
+	unsigned int    tail;     /* Local SQ tail, published on submit */
+	unsigned int    inflight; /* Submitted, waiting for final completion */
+
+	unsigned int   *sq_head, *sq_tail, *sq_mask, *sq_array, *sq_flags;
+	unsigned int   *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+
+	void           *sq_map, *cq_map;
+	size_t          sq_len, cq_len, sqes_len;
+};
+
+/* Per-context file I/O engine, allocated on first use */
+struct uev_aio {
+	int             backend;
+	int             efd;      /* Completion notification */
+	uev_t           w;        /* Watcher for efd, active while pending */
+	size_t          pending;  /* Queued or in flight */
+
+	struct uev_file_req *todo, **todo_tail;
+	struct uev_file_req *free;
+
+	/* UEV_FILE_URING */
+	struct ring     ring;
+
+	/* UEV_FILE_THREADS */
+	pthread_t       thr[UEV_FILE_WORKERS];
+	int             nthr;
+	int             stop;
+	pthread_mutex_t lock;
+	pthread_cond_t  cond;
+	struct uev_file_req *queue, **queue_tail;
+	struct uev_file_req *done;
+};
+
+
+static int ring_setup(struct ring *r, int efd)
+{
+	struct io_uring_params p;
+	char *sq, *cq;
+
+	/* Room for bursts of multishot receive completions */
+	memset(&p, 0, sizeof(p));
+	p.flags = IORING_SETUP_CQSIZE;
+	p.cq_entries = URING_ENTRIES * 16;
+	r->fd = syscall(__NR_io_uring_setup, URING_ENTRIES, &p);
+	if (r->fd < 0)
+		return -1;
+
+	/* Kernel 5.7, IORING_OP_READ/WRITE and no dropped completions */
+	if (!(p.features & IORING_FEAT_FAST_POLL) || !(p.features & IORING_FEAT_NODROP)) {
+		close(r->fd);
+		errno = ENOSYS;
+		return -1;
+	}
+
+	r->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	r->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (r->cq_len > r->sq_len)
+			r->sq_len = r->cq_len;
+		r->cq_len = 0;
+	}
+
+	r->sq_map = mmap(NULL, r->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			 r->fd, IORING_OFF_SQ_RING);
+	if (r->sq_map == MAP_FAILED)
+		goto fail;
+
+	r->cq_map = r->sq_map;
+	if (r->cq_len) {
+		r->cq_map = mmap(NULL, r->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+				 r->fd, IORING_OFF_CQ_RING);
+		if (r->cq_map == MAP_FAILED)
+			goto fail_sq;
+	}
+
+	r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+	r->sqes = mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		       r->fd, IORING_OFF_SQES);
+	if (r->sqes == MAP_FAILED)
+		goto fail_cq;
+
+	if (syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_EVENTFD, &efd, 1))
+		goto fail_sqes;
+
+	sq = r->sq_map;
+	r->sq_head    = (unsigned int *)(sq + p.sq_off.head);
+	r->sq_tail    = (unsigned int *)(sq + p.sq_off.tail);
+	r->sq_mask    = (unsigned int *)(sq + p.sq_off.ring_mask);
+	r->sq_array   = (unsigned int *)(sq + p.sq_off.array);
+	r->sq_flags   = (unsigned int *)(sq + p.sq_off.flags);
+	r->tail       = *r->sq_tail;
+	r->entries    = p.sq_entries;
+
+	cq = r->cq_map;
+	r->cq_head    = (unsigned int *)(cq + p.cq_off.head);
+	r->cq_tail    = (unsigned int *)(cq + p.cq_off.tail);
+	r->cq_mask    = (unsigned int *)(cq + p.cq_off.ring_mask);
+	r->cqes       = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+	return 0;
+
+fail_sqes:
+	munmap(r->sqes, r->sqes_len);
+fail_cq:
+	if (r->cq_len)
+		munmap(r->cq_map, r->cq_len);
+fail_sq:
+	munmap(r->sq_map, r->sq_len);
+fail:
+	close(r->fd);
+	return -1;
+}
+
+static struct io_uring_sqe *ring_sqe(struct ring *r)
+{
+	unsigned int head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+	unsigned int idx = r->tail & *r->sq_mask;
+	struct io_uring_sqe *sqe;
+
+	if (r->tail - head >= r->entries)
+		return NULL;
+
+	sqe = &r->sqes[idx];
+	memset(sqe, 0, sizeof(*sqe));
+	r->sq_array[idx] = idx;
+	r->tail++;
+	r->inflight++;
+
+	return sqe;
+}
+
+/* SQEs not yet consumed by the kernel, also those from a failed enter */
+static unsigned int ring_pending(struct ring *r)
+{
+	return r->tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * Submit all pending SQEs.  Only EINTR is retried here, with EAGAIN or
+ * EBUSY the kernel needs completions to be reaped first, so the caller
+ * tries again later, e.g. on the next loop iteration.
+ */
+static int ring_enter(struct ring *r, unsigned int min, unsigned int flags)
+{
+	unsigned int num;
+
+	__atomic_store_n(r->sq_tail, r->tail, __ATOMIC_RELEASE);
+	num = ring_pending(r);
+
+	while (syscall(__NR_io_uring_enter, r->fd, num, min, flags, NULL, 0) < 0) {
+		if (errno != EINTR)
+			return -1;
+	}
+
+	return 0;
+}
+
+static void ring_free(struct ring *r)
+{
+	struct io_uring_sqe *sqe;
+
+	/* Multishot receives only end when cancelled */
+	sqe = ring_sqe(r);
+	if (sqe) {
+		sqe->opcode       = IORING_OP_ASYNC_CANCEL;
+		sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+		sqe->fd           = -1;
+		ring_enter(r, 0, 0);
+	}
+
+	/* Wait for requests in flight, the kernel may still use their buffers */
+	while (r->inflight) {
+		unsigned int head = *r->cq_head;
+		unsigned int tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+
+		/* Also submits the cancel, if the CQ was full above */
+		if (head == tail) {
+			if (ring_enter(r, 1, IORING_ENTER_GETEVENTS) && errno != EAGAIN && errno != EBUSY)
+				break;
+			continue;
+		}
+
+		while (head != tail) {
+			struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+
+			/* File requests are allocated, receives are tagged */
+			if (!(cqe->user_data & 1))
+				free((void *)(uintptr_t)cqe->user_data);
+			if (!(cqe->flags & IORING_CQE_F_MORE))
+				r->inflight--;
+			head++;
+		}
+		__atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+	}
+
+	munmap(r->sqes, r->sqes_len);
+	if (r->cq_len)
+		munmap(r->cq_map, r->cq_len);
+	munmap(r->sq_map, r->sq_len);
+	close(r->fd);
+}
+
+/*
+ * Move queued requests to the SQ, overflowing completions are kept by
+ * the kernel.  If it refuses more until the CQ is reaped, the rest is
+ * left for the next loop iteration.
+ */
+static void ring_submit(struct uev_aio *aio)
+{
+	struct ring *r = &aio->ring;
+
+	while (aio->todo) {
+		struct uev_file_req *req = aio->todo;
+		struct io_uring_sqe *sqe;
+
+		sqe = ring_sqe(r);
+		if (!sqe) {
+			if (ring_enter(r, 0, 0))
+				return;
+			continue;
+		}
+
+		aio->todo = req->next;
+		if (!aio->todo)
+			aio->todo_tail = &aio->todo;
+
+		sqe->fd        = req->fd;
+		sqe->user_data = (uintptr_t)req;
+		switch (req->op) {
+		case OP_READ:
+			sqe->opcode = IORING_OP_READ;
+			break;
+		case OP_WRITE:
+			sqe->opcode = IORING_OP_WRITE;
+			break;
+		case OP_FSYNC:
+			sqe->opcode = IORING_OP_FSYNC;
+			break;
+		case OP_WRITE_DSYNC:
+			sqe->opcode   = IORING_OP_WRITE;
+			sqe->rw_flags = RWF_DSYNC;
+			break;
+		case OP_RECV:
+			sqe->opcode    = IORING_OP_RECV;
+			sqe->ioprio    = IORING_RECV_MULTISHOT;
+			sqe->flags     = IOSQE_BUFFER_SELECT;
+			sqe->buf_group = 0;
+			sqe->user_data = req->ud;
+			break;
+		case OP_CANCEL:
+			sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+			sqe->addr      = req->ud;
+			sqe->user_data = 0;
+			break;
+		}
+
+		if (req->op == OP_RECV || req->op == OP_CANCEL) {
+			req->next = aio->free;
+			aio->free = req;
+		} else {
+			sqe->addr = (uintptr_t)req->buf;
+			sqe->len  = req->len;
+			sqe->off  = req->off;
+		}
+	}
+
+	if (ring_pending(r))
+		ring_enter(r, 0, 0);
+}
+
+/* Copy posted completions, oldest first */
+static size_t ring_reap(struct ring *r, struct cqe *batch, size_t max)
+{
+	unsigned int head, tail;
+	size_t num = 0;
+
+	head = *r->cq_head;
+	tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+
+	/* Completions that did not fit in the CQ are flushed on enter */
+	if (head == tail && (__atomic_load_n(r->sq_flags, __ATOMIC_ACQUIRE) & IORING_SQ_CQ_OVERFLOW)) {
+		ring_enter(r, 0, IORING_ENTER_GETEVENTS);
+		tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+	}
+
+	while (head != tail && num < max) {
+		struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+
+		batch[num].ud    = cqe->user_data;
+		batch[num].res   = cqe->res;
+		batch[num].flags = cqe->flags;
+		if (!(cqe->flags & IORING_CQE_F_MORE))
+			r->inflight--;
+
+		num++;
+		head++;
+	}
+	__atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+
+	return num;
+}
+
+static void execute(struct uev_file_req *req)
+{
+	struct iovec iov = { req->buf, req->len };
+
+	switch (req->op) {
+	case OP_READ:
+		req->res = pread(req->fd, req->buf, req->len, req->off);
+		break;
+	case OP_WRITE:
+		req->res = pwrite(req->fd, req->buf, req->len, req->off);
+		break;
+	case OP_FSYNC:
+		req->res = fsync(req->fd);
+		break;
+	case OP_WRITE_DSYNC:
+		req->res = pwritev2(req->fd, &iov, 1, req->off, RWF_DSYNC);
+		break;
+	}
+	req->err = req->res < 0 ? errno : 0;
+}
+
+/* Thread pool fallback, runs blocking calls off the loop thread */
+static void *worker(void *arg)
+{
+	struct uev_aio *aio = arg;
+	uint64_t one = 1;
+
+	pthread_mutex_lock(&aio->lock);
+	while (1) {
+		struct uev_file_req *req;
+		int wake;
+
+		while (!aio->stop && !aio->queue)
+			pthread_cond_wait(&aio->cond, &aio->lock);
+		if (aio->stop)
+			break;
+
+		req = aio->queue;
+		aio->queue = req->next;
+		if (!aio->queue)
+			aio->queue_tail = &aio->queue;
+		pthread_mutex_unlock(&aio->lock);
+
+		execute(req);
+
+		pthread_mutex_lock(&aio->lock);
+		wake = !aio->done;
+		req->next = aio->done;
+		aio->done = req;
+
+		/* One wakeup per batch, the loop takes all that are done */
+		if (wake) {
+			pthread_mutex_unlock(&aio->lock);
+			write(aio->efd, &one, sizeof(one));
+			pthread_mutex_lock(&aio->lock);
+		}
+	}
+	pthread_mutex_unlock(&aio->lock);
+
+	return NULL;
+}
+
+static int threads_setup(struct uev_aio *aio)
+{
+	pthread_mutex_init(&aio->lock, NULL);
+	pthread_cond_init(&aio->cond, NULL);
+	aio->queue_tail = &aio->queue;
+
+	for (aio->nthr = 0; aio->nthr < UEV_FILE_WORKERS; aio->nthr++) {
+		if (pthread_create(&aio->thr[aio->nthr], NULL, worker, aio))
+			break;
+	}
+
+	if (!aio->nthr) {
+		pthread_cond_destroy(&aio->cond);
+		pthread_mutex_destroy(&aio->lock);
+		errno = EAGAIN;
+		return -1;
+	}
+
+	return 0;
+}
+
+static void free_list(struct uev_file_req *list)
+{
+	while (list) {
+		struct uev_file_req *req = list;
+
+		list = req->next;
+		free(req);
+	}
+}
+
+static void threads_free(struct uev_aio *aio)
+{
+	int i;
+
+	pthread_mutex_lock(&aio->lock);
+	aio->stop = 1;
+	pthread_cond_broadcast(&aio->cond);
+	pthread_mutex_unlock(&aio->lock);
+
+	/* Each worker finishes the call it is in, if any */
+	for (i = 0; i < aio->nthr; i++)
+		pthread_join(aio->thr[i], NULL);
+
+	free_list(aio->queue);
+	free_list(aio->done);
+	pthread_cond_destroy(&aio->cond);
+	pthread_mutex_destroy(&aio->lock);
+}
+
+static void threads_submit(struct uev_aio *aio)
+{
+	struct uev_file_req *req;
+	int num = 0;
+
+	for (req = aio->todo; req; req = req->next)
+		num++;
+	if (!num)
+		return;
+
+	pthread_mutex_lock(&aio->lock);
+	*aio->queue_tail = aio->todo;
+	aio->queue_tail = aio->todo_tail;
+	if (num > 1)
+		pthread_cond_broadcast(&aio->cond);
+	else
+		pthread_cond_signal(&aio->cond);
+	pthread_mutex_unlock(&aio->lock);
+
+	aio->todo = NULL;
+	aio->todo_tail = &aio->todo;
+}
+
+/* Collect all completed calls, oldest first */
+static struct uev_file_req *threads_reap(struct uev_aio *aio)
+{
+	struct uev_file_req *list, *prev = NULL;
+
+	pthread_mutex_lock(&aio->lock);
+	list = aio->done;
+	aio->done = NULL;
+	pthread_mutex_unlock(&aio->lock);
+
+	while (list) {
+		struct uev_file_req *next = list->next;
+
+		list->next = prev;
+		prev = list;
+		list = next;
+	}
+
+	return prev;
+}
+
+/* Call back for one completed file request, false if uev_exit() was called */
+static int deliver(uev_ctx_t *ctx, struct uev_aio *aio, struct uev_file_req *req)
+{
+	aio->pending--;
+
+	errno = req->err;
+	req->cb(req->w, req->arg, req->buf, req->res);
+
+	if (ctx->aio != aio) {
+		free(req);
+		return 0;
+	}
+
+	req->next = aio->free;
+	aio->free = req;
+
+	return 1;
+}
+
+static void ring_complete(uev_ctx_t *ctx, struct uev_aio *aio)
+{
+	struct cqe batch[REAP_BATCH];
+	size_t i, num;
+
+	do {
+		num = ring_reap(&aio->ring, batch, REAP_BATCH);
+		for (i = 0; i < num; i++) {
+			struct uev_file_req *req;
+
+			if (!batch[i].ud)
+				continue; /* Cancel request */
+
+			if (batch[i].ud & 1) {
+				_uev_ring_recv_done(ctx, batch[i].ud, batch[i].res, batch[i].flags);
+			} else {
+				req = (struct uev_file_req *)(uintptr_t)batch[i].ud;
+				req->res = batch[i].res < 0 ? -1 : batch[i].res;
+				req->err = batch[i].res < 0 ? -batch[i].res : 0;
+				deliver(ctx, aio, req);
+			}
+
+			/* Callback may have called uev_exit() */
+			if (ctx->aio != aio) {
+				while (++i < num) {
+					if (!(batch[i].ud & 1))
+						free((void *)(uintptr_t)batch[i].ud);
+				}
+				return;
+			}
+		}
+	} while (num == REAP_BATCH);
+
+	/* Return receive buffers to the kernel, once per batch */
+	_uev_ring_flush(ctx);
+}
+
+/* Deliver a batch of completions, on the loop thread */
+static void complete_cb(uev_t *w, void *arg, int events)
+{
+	struct uev_aio *aio = arg;
+	uev_ctx_t *ctx = w->ctx;
+	struct uev_file_req *list;
+	uint64_t cnt;
+
+	if (events & UEV_ERROR) {
+		uev_io_start(w);
+		return;
+	}
+
+	read(aio->efd, &cnt, sizeof(cnt));
+	if (aio->backend == UEV_FILE_URING) {
+		ring_complete(ctx, aio);
+		if (ctx->aio != aio)
+			return;
+	} else {
+		list = threads_reap(aio);
+		while (list) {
+			struct uev_file_req *req = list;
+
+			list = req->next;
+			if (!deliver(ctx, aio, req)) {
+				free_list(list);
+				return;
+			}
+		}
+	}
+
+	if (!aio->pending)
+		uev_io_stop(&aio->w);
+}
+
+static struct uev_aio *aio_new(uev_ctx_t *ctx, int backend)
+{
+	struct uev_aio *aio;
+
+	aio = calloc(1, sizeof(*aio));
+	if (!aio)
+		return NULL;
+
+	aio->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (aio->efd < 0)
+		goto fail;
+
+	aio->todo_tail = &aio->todo;
+	if (backend != UEV_FILE_THREADS) {
+		if (!ring_setup(&aio->ring, aio->efd)) {
+			aio->backend = UEV_FILE_URING;
+			goto done;
+		}
+
+		/* E.g., older kernel or io_uring disabled by seccomp */
+		if (backend == UEV_FILE_URING)
+			goto fail_efd;
+	}
+
+	if (threads_setup(aio))
+		goto fail_efd;
+	aio->backend = UEV_FILE_THREADS;
+
+done:
+	/* Not started until there is a request pending */
+	if (_uev_watcher_init(ctx, &aio->w, UEV_IO_TYPE, complete_cb, aio, aio->efd, UEV_READ))
+		goto fail_efd;
+
+	ctx->aio = aio;
+
+	return aio;
+
+fail_efd:
+	close(aio->efd);
+fail:
+	free(aio);
+	return NULL;
+}
+
+/* Private to libuEv, do not use directly! */
+int _uev_file_owns(uev_t *w)
+{
+	return w->cb == complete_cb;
+}
+
+/* Private to libuEv, do not use directly! */
+void _uev_file_submit(uev_ctx_t *ctx)
+{
+	struct uev_aio *aio = ctx->aio;
+
+	if (!aio)
+		return;
+
+	/* Left over from an earlier iteration, see ring_submit() */
+	if (aio->backend == UEV_FILE_URING) {
+		if (aio->todo || ring_pending(&aio->ring))
+			ring_submit(aio);
+	} else if (aio->todo) {
+		threads_submit(aio);
+	}
+}
+
+/* Private to libuEv, do not use directly! */
+void _uev_file_free(uev_ctx_t *ctx)
+{
+	struct uev_aio *aio = ctx->aio;
+
+	if (!aio)
+		return;
+
+	ctx->aio = NULL;
+	uev_io_stop(&aio->w);
+
+	/* Completion callbacks are not called after uev_exit() */
+	if (aio->backend == UEV_FILE_URING)
+		ring_free(&aio->ring);
+	else
+		threads_free(aio);
+
+	free_list(aio->todo);
+	free_list(aio->free);
+	close(aio->efd);
+	free(aio);
+}
+
+static struct uev_file_req *req_get(struct uev_aio *aio)
+{
+	struct uev_file_req *req;
+
+	req = aio->free;
+	if (req) {
+		aio->free = req->next;
+	} else {
+		req = malloc(sizeof(*req));
+		if (!req)
+			return NULL;
+	}
+	req->next = NULL;
+
+	/* Submitted in one batch before the loop waits for events */
+	*aio->todo_tail = req;
+	aio->todo_tail = &req->next;
+
+	return req;
+}
+
+static int queue(uev_t *w, int op, void *buf, size_t len, off_t off, uev_file_cb_t *cb, void *arg)
+{
+	struct uev_aio *aio;
+	struct uev_file_req *req;
+
+	if (!w || !w->ctx || !w->ctx->backend || w->type != UEV_FILE_TYPE || !cb ||
+	    (op != OP_FSYNC && !buf) || off < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* Length is 32 bits in an io_uring SQE, same limit for all backends */
+	if (len > UINT32_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	aio = w->ctx->aio;
+	if (!aio) {
+		aio = aio_new(w->ctx, UEV_FILE_AUTO);
+		if (!aio)
+			return -1;
+	}
+
+	req = req_get(aio);
+	if (!req)
+		return -1;
+
+	req->w    = w;
+	req->op   = op;
+	req->fd   = w->fd;
+	req->buf  = buf;
+	req->len  = len;
+	req->off  = off;
+	req->cb   = cb;
+	req->arg  = arg;
+
+	_uev_uring_hold(w->ctx, 1);
+
+	return 0;
+}
+
+/* Private to libuEv, do not use directly! */
+int _uev_uring_fd(uev_ctx_t *ctx)
+{
+	if (!ctx->aio && !aio_new(ctx, UEV_FILE_AUTO))
+		return -1;
+
+	if (ctx->aio->backend != UEV_FILE_URING) {
+		errno = ENOSYS;
+		return -1;
+	}
+
+	return ctx->aio->ring.fd;
+}
+
+/* Private to libuEv, do not use directly! */
+int _uev_uring_recv(uev_ctx_t *ctx, int fd, uint64_t ud, int cancel)
+{
+	struct uev_file_req *req;
+
+	if (_uev_uring_fd(ctx) < 0)
+		return -1;
+
+	req = req_get(ctx->aio);
+	if (!req)
+		return -1;
+
+	req->op = cancel ? OP_CANCEL : OP_RECV;
+	req->fd = fd;
+	req->ud = ud;
+
+	return 0;
+}
+
+/* Private to libuEv, do not use directly! */
+void _uev_uring_hold(uev_ctx_t *ctx, int delta)
+{
+	struct uev_aio *aio = ctx->aio;
+
+	if (!aio)
+		return;
+
+	/* Keep the loop running while requests are pending */
+	aio->pending += delta;
+	if (aio->pending && !uev_io_active(&aio->w))
+		uev_io_start(&aio->w);
+	if (!aio->pending && uev_io_active(&aio->w))
+		uev_io_stop(&aio->w);
+}
+
+/* Private to libuEv, do not use directly!  Keep the loop running for requests not yet queued */
+int _uev_file_hold(uev_ctx_t *ctx, int delta)
+{
+	if (!ctx->aio && !aio_new(ctx, UEV_FILE_AUTO))
+		return -1;
+
+	_uev_uring_hold(ctx, delta);
+
+	return 0;
+}
+
+/* Private to libuEv, do not use directly!  Write and fdatasync() in one */
+int _uev_file_write_dsync(uev_t *w, const void *buf, size_t len, off_t off, uev_file_cb_t *cb, void *arg)
+{
+	return queue(w, OP_WRITE_DSYNC, (void *)buf, len, off, cb, arg);
+}
+
+/**
+ * Select asynchronous file I/O backend
+ * @param ctx      A valid libuEv context
+ * @param backend  One of %UEV_FILE_AUTO, %UEV_FILE_URING, %UEV_FILE_THREADS
+ *
+ * Optional, call before the first file request to override the default,
+ * %UEV_FILE_AUTO, which uses io_uring when the kernel supports it and a
+ * pool of %UEV_FILE_WORKERS threads otherwise.
+ *
+ * @return The backend in use, or -1 with @param errno set on error.
+ */
+int uev_file_backend(uev_ctx_t *ctx, int backend)
+{
+	if (!ctx || !ctx->backend || backend < UEV_FILE_AUTO || backend > UEV_FILE_THREADS) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (ctx->aio) {
+		if (backend == UEV_FILE_AUTO || backend == ctx->aio->backend)
+			return ctx->aio->backend;
+
+		errno = EBUSY;
+		return -1;
+	}
+
+	if (!aio_new(ctx, backend))
+		return -1;
+
+	return ctx->aio->backend;
+}
+
+/**
+ * Create a file watcher for asynchronous I/O
+ * @param ctx  A valid libuEv context
+ * @param w    Pointer to an uev_t watcher
+ * @param fd   Regular file, or block device, opened by the application
+ *
+ * Regular files are always readable to epoll, so reading them blocks
+ * the event loop.  Use uev_file_read(), uev_file_write(), and
+ * uev_file_fsync() on this watcher instead, their callbacks are called
+ * from the event loop when the request has completed.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_file_init(uev_ctx_t *ctx, uev_t *w, int fd)
+{
+	if (fd < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return _uev_watcher_init(ctx, w, UEV_FILE_TYPE, NULL, NULL, fd, 0);
+}
+
+/**
+ * Read from a file at an offset, asynchronously
+ * @param w    Pointer to an uev_t file watcher
+ * @param buf  Buffer to read into, must be valid until @param cb is called
+ * @param len  Number of bytes to read, at most %UINT32_MAX
+ * @param off  Offset in file to read from
+ * @param cb   Completion callback, called with the result of pread()
+ * @param arg  Optional callback argument
+ *
+ * Requests are queued and submitted in one batch before the event loop
+ * next waits for events.  Completions are also delivered in batches.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_file_read(uev_t *w, void *buf, size_t len, off_t off, uev_file_cb_t *cb, void *arg)
+{
+	return queue(w, OP_READ, buf, len, off, cb, arg);
+}
+
+/**
+ * Write to a file at an offset, asynchronously
+ * @param w    Pointer to an uev_t file watcher
+ * @param buf  Data to write, must be valid until @param cb is called
+ * @param len  Number of bytes to write, at most %UINT32_MAX
+ * @param off  Offset in file to write to
+ * @param cb   Completion callback, called with the result of pwrite()
+ * @param arg  Optional callback argument
+ *
+ * Requests are not ordered, use uev_file_fsync() from the callback
+ * for a write barrier.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_file_write(uev_t *w, const void *buf, size_t len, off_t off, uev_file_cb_t *cb, void *arg)
+{
+	return queue(w, OP_WRITE, (void *)buf, len, off, cb, arg);
+}
+
+/**
+ * Flush a file to storage, asynchronously
+ * @param w    Pointer to an uev_t file watcher
+ * @param cb   Completion callback, called with the result of fsync()
+ * @param arg  Optional callback argument
+ *
+ * Only writes that have completed before this call are covered.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_file_fsync(uev_t *w, uev_file_cb_t *cb, void *arg)
+{
+	return queue(w, OP_FSYNC, NULL, 0, 0, cb, arg);
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
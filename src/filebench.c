@@ -0,0 +1,227 @@
+/* libuEv - Micro event loop library
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "uev.h"
+
+#define UNUSED(arg) arg __attribute__ ((unused))
+#define BLOCK 4096
+
+static int backend = -1, depth = 32;
+static long ops = 100000, issued, completed, failed;
+static off_t blocks;
+static uint64_t seed = 88172645463325252ULL;
+
+static off_t random_offset(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 7;
+	seed ^= seed << 17;
+
+	return (off_t)(seed % blocks) * BLOCK;
+}
+
+static void read_cb(uev_t *w, void *UNUSED(arg), void *buf, ssize_t res)
+{
+	if (res != BLOCK)
+		failed++;
+	completed++;
+
+	/* Keep the queue full */
+	if (issued < ops) {
+		issued++;
+		uev_file_read(w, buf, BLOCK, random_offset(), read_cb, NULL);
+	}
+}
+
+static double blocking(int fd)
+{
+	struct timeval start, end;
+	char *buf;
+	long i;
+
+	buf = aligned_alloc(BLOCK, BLOCK);
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < ops; i++) {
+		if (pread(fd, buf, BLOCK, random_offset()) != BLOCK)
+			failed++;
+	}
+	gettimeofday(&end, NULL);
+	free(buf);
+
+	timersub(&end, &start, &end);
+	return end.tv_sec + end.tv_usec / 1e6;
+}
+
+static double async(int fd)
+{
+	struct timeval start, end;
+	uev_ctx_t ctx;
+	uev_t w;
+	int i;
+
+	uev_init(&ctx);
+	backend = uev_file_backend(&ctx, backend);
+	if (backend < 0) {
+		perror("uev_file_backend");
+		exit(1);
+	}
+	uev_file_init(&ctx, &w, fd);
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < depth && issued < ops; i++, issued++)
+		uev_file_read(&w, aligned_alloc(BLOCK, BLOCK), BLOCK, random_offset(), read_cb, NULL);
+	uev_run(&ctx, 0);
+	gettimeofday(&end, NULL);
+	uev_exit(&ctx);
+
+	timersub(&end, &start, &end);
+	return end.tv_sec + end.tv_usec / 1e6;
+}
+
+static int usage(int rc)
+{
+	fprintf(stderr,
+		"Usage: filebench [-bdhtu] [-f FILE] [-n OPS] [-q DEPTH] [-s MB]\n"
+		"  -b        Inline blocking pread(), the default is uev_file_read()\n"
+		"  -d        Use O_DIRECT, bypass the page cache\n"
+		"  -f FILE   File to read, created if missing, default filebench.dat\n"
+		"  -n OPS    Number of 4 KiB reads, default 100000\n"
+		"  -q DEPTH  Number of reads in flight, default 32\n"
+		"  -s MB     Size of file to create, default 256\n"
+		"  -t        Force thread pool backend\n"
+		"  -u        Force io_uring backend\n");
+	return rc;
+}
+
+int main(int argc, char **argv)
+{
+	const char *file = "filebench.dat", *mode;
+	int c, fd, flags = O_RDONLY;
+	long size = 256;
+	double sec;
+
+	while ((c = getopt(argc, argv, "bdf:hn:q:s:tu")) != -1) {
+		switch (c) {
+		case 'b':
+			backend = -2;
+			break;
+
+		case 'd':
+			flags |= O_DIRECT;
+			break;
+
+		case 'f':
+			file = optarg;
+			break;
+
+		case 'h':
+			return usage(0);
+
+		case 'n':
+			ops = atol(optarg);
+			break;
+
+		case 'q':
+			depth = atoi(optarg);
+			break;
+
+		case 's':
+			size = atol(optarg);
+			break;
+
+		case 't':
+			backend = UEV_FILE_THREADS;
+			break;
+
+		case 'u':
+			backend = UEV_FILE_URING;
+			break;
+
+		default:
+			return usage(1);
+		}
+	}
+
+	if (access(file, F_OK)) {
+		char buf[65536];
+		long i;
+
+		fd = open(file, O_WRONLY | O_CREAT, 0644);
+		if (fd < 0) {
+			perror("open");
+			return 1;
+		}
+
+		memset(buf, 0x55, sizeof(buf));
+		for (i = 0; i < size * 16; i++)
+			write(fd, buf, sizeof(buf));
+		fsync(fd);
+		close(fd);
+	}
+
+	fd = open(file, flags);
+	if (fd < 0) {
+		perror("open");
+		return 1;
+	}
+
+	blocks = lseek(fd, 0, SEEK_END) / BLOCK;
+	if (blocks < 1) {
+		fprintf(stderr, "%s: too small\n", file);
+		return 1;
+	}
+
+	if (backend == -2) {
+		mode = "blocking";
+		depth = 1;
+		sec = blocking(fd);
+	} else {
+		if (backend < 0)
+			backend = UEV_FILE_AUTO;
+		sec = async(fd);
+		mode = backend == UEV_FILE_URING ? "io_uring" : "threads";
+	}
+	close(fd);
+
+	printf("%-8s %s qd %-3d %10.0f IOPS %8ld errors\n", mode,
+	       flags & O_DIRECT ? "direct" : "cached", depth, ops / sec, failed);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,280 @@
+/* libuEv - Length prefixed frame receive, woken up per whole frame
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <stdlib.h>		/* calloc(), free() */
+#include <sys/socket.h>		/* setsockopt() */
+#include <unistd.h>		/* read() */
+
+#include "uev.h"
+
+/* Max. frames delivered per wakeup, to not starve other watchers */
+#define FRAME_BATCH 16
+
+/* Partial frame, allocated on first read, kept until uev_frame_stop() */
+struct uev_frame {
+	unsigned char   hdr[4];
+	size_t          have;	/* Bytes of header read so far */
+	size_t          need;	/* Payload length, when header is complete */
+	uev_buf_t      *buf;	/* Payload read so far */
+	int             lowat;	/* Current SO_RCVLOWAT, 0: unknown */
+};
+
+/* Wake up when the rest of the header, or payload, can be read */
+static void rcvlowat(uev_t *w, struct uev_frame *f, size_t want)
+{
+	int val = (int)want;
+
+	if (val == f->lowat)
+		return;
+
+	/* Only TCP honors it, others fall back to collecting partial frames */
+	setsockopt(w->fd, SOL_SOCKET, SO_RCVLOWAT, &val, sizeof(val));
+	f->lowat = val;
+}
+
+static void reset(uev_t *w, struct uev_frame *f)
+{
+	uev_buf_put(w->ctx, f->buf);
+	f->buf  = NULL;
+	f->have = 0;
+	f->need = 0;
+}
+
+/* Stops the watcher on hangup, as uev_run() does for other I/O watchers */
+static void frame_end(uev_t *w, void *arg, int hup, int events, int err)
+{
+	if (hup)
+		_uev_io_end(w);
+
+	errno = err;
+	w->u.fr.cb(w, arg, events, NULL);
+}
+
+static void frame_cb(uev_t *w, void *arg, int events)
+{
+	struct uev_frame *f = w->u.fr.f;
+	size_t hdrlen = w->u.fr.hdrlen;
+	int hup = events & (UEV_HUP | UEV_ERROR);
+	int num = 0;
+
+	if (!f) {
+		f = calloc(1, sizeof(*f));
+		if (!f) {
+			frame_end(w, arg, hup, UEV_ERROR, errno);
+			return;
+		}
+		w->u.fr.f = f;
+	}
+
+	/* Peer gone, frames still buffered are delivered before the hangup */
+	while (hup || num < FRAME_BATCH) {
+		uev_buf_t *buf;
+		size_t want, i;
+		ssize_t len = 0;
+		char *ptr;
+
+		if (f->have < hdrlen) {
+			ptr  = (char *)f->hdr + f->have;
+			want = hdrlen - f->have;
+		} else {
+			ptr  = f->buf->data + f->buf->len;
+			want = f->need - f->buf->len;
+		}
+
+		if (want) {
+			len = read(w->fd, ptr, want);
+			if (len < 0 && errno == EINTR)
+				continue;
+			if (len < 0 && errno == EAGAIN) {
+				if (!hup) {
+					rcvlowat(w, f, want);
+					return;
+				}
+				len = 0;	/* Nothing more will arrive */
+			}
+
+			if (len <= 0) {
+				/* Peer closed mid-frame, the partial frame is dropped */
+				if (!len && (f->have || f->buf)) {
+					reset(w, f);
+					frame_end(w, arg, hup, UEV_ERROR | UEV_HUP, EPROTO);
+					return;
+				}
+
+				frame_end(w, arg, hup, len ? UEV_ERROR : events | UEV_HUP, errno);
+				return;
+			}
+
+			_uev_limit_count(w, UEV_LIMIT_BYTES, len);
+		}
+
+		if (f->have < hdrlen) {
+			f->have += len;
+			if (f->have < hdrlen)
+				continue;
+
+			/* Big endian length of payload, not including the header */
+			for (f->need = 0, i = 0; i < hdrlen; i++)
+				f->need = (f->need << 8) | f->hdr[i];
+
+			/* Payload is not read, the stream cannot be resumed */
+			if (f->need > w->u.fr.max) {
+				reset(w, f);
+				frame_end(w, arg, 1, UEV_ERROR, EMSGSIZE);
+				return;
+			}
+
+			f->buf = uev_buf_get(w->ctx, f->need);
+			if (!f->buf) {
+				reset(w, f);
+				frame_end(w, arg, 1, UEV_ERROR, errno);
+				return;
+			}
+			continue;
+		}
+
+		f->buf->len += len;
+		if (f->buf->len < f->need)
+			continue;
+
+		buf    = f->buf;
+		f->buf = NULL;
+		reset(w, f);
+
+		num++;
+		w->u.fr.cb(w, arg, hup ? UEV_READ : events, buf);
+		if (!buf->keep)
+			uev_buf_put(w->ctx, buf);
+
+		/* Stopped by the callback, partial frame state is gone */
+		if (!_uev_is_active(w) || !w->u.fr.f)
+			return;
+	}
+
+	/* Batch limit, lower the mark left by a larger frame for the next header */
+	rcvlowat(w, f, hdrlen);
+}
+
+/* Private to libuEv, do not use directly! */
+int _uev_frame_owns(uev_t *w)
+{
+	return w->cb == frame_cb;
+}
+
+/* Private to libuEv, do not use directly! */
+void _uev_frame_free(uev_t *w)
+{
+	struct uev_frame *f;
+	int val = 1;
+
+	if (!w || w->cb != frame_cb || !w->u.fr.f)
+		return;
+
+	f = w->u.fr.f;
+	if (f->lowat > 1)
+		setsockopt(w->fd, SOL_SOCKET, SO_RCVLOWAT, &val, sizeof(val));
+
+	reset(w, f);
+	free(f);
+	w->u.fr.f = NULL;
+}
+
+/**
+ * Create a receive watcher for length prefixed frames
+ * @param ctx     A valid libuEv context
+ * @param w       Pointer to an uev_t watcher
+ * @param cb      Receive callback, called with one whole frame
+ * @param arg     Optional callback argument
+ * @param fd      Non-blocking socket to read from
+ * @param hdrlen  Size of big endian length prefix: 1, 2, or 4 bytes
+ * @param max     Max. payload length, at most %UEV_FRAME_MAX
+ *
+ * Each frame is a length prefix followed by that many bytes of payload.
+ * @param cb is called with the payload in a pooled buffer, see the
+ * uev_recv_init() for buffer ownership.  Between frames SO_RCVLOWAT is
+ * set to the remaining bytes of the current header or payload, so on a
+ * TCP socket the loop only wakes up when they can be read.  Other types
+ * of descriptors ignore SO_RCVLOWAT, partial frames are then collected
+ * across wakeups instead.
+ *
+ * Frames longer than @param max are reported as %UEV_ERROR with errno
+ * set to %EMSGSIZE, and a peer closing the connection mid-frame as
+ * %UEV_ERROR | %UEV_HUP with errno set to %EPROTO.  An oversized frame
+ * ends the stream, the watcher is stopped before @param cb is called,
+ * since the payload that follows cannot be told apart from the next
+ * header.  The same goes for failing to allocate a payload buffer.
+ * Use uev_io_start() and uev_io_stop() as for other I/O watchers, a
+ * partial frame is kept while stopped.  Use uev_frame_stop() when done.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_frame_init(uev_ctx_t *ctx, uev_t *w, uev_recv_cb_t *cb, void *arg, int fd, int hdrlen, size_t max)
+{
+	if (fd < 0 || !cb || (hdrlen != 1 && hdrlen != 2 && hdrlen != 4)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (max > UEV_FRAME_MAX) {
+		errno = ERANGE;
+		return -1;
+	}
+
+	if (_uev_watcher_init(ctx, w, UEV_IO_TYPE, frame_cb, arg, fd, UEV_READ))
+		return -1;
+
+	w->u.fr.cb     = cb;
+	w->u.fr.f      = NULL;
+	w->u.fr.hdrlen = hdrlen;
+	w->u.fr.max    = max;
+
+	return _uev_watcher_start(w);
+}
+
+/**
+ * Stop a frame watcher for good
+ * @param w  Frame watcher, from uev_frame_init()
+ *
+ * Unlike uev_io_stop(), any partial frame is dropped and the default
+ * SO_RCVLOWAT of the socket is restored.  The socket is owned by the
+ * caller.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_frame_stop(uev_t *w)
+{
+	if (!w || w->cb != frame_cb) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return _uev_io_end(w);
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,503 @@
+/* libuEv - Descriptor handoff to other processes, SCM_RIGHTS
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <stdlib.h>		/* calloc(), realloc(), free() */
+#include <string.h>		/* memcpy(), memmove() */
+#include <sys/socket.h>
+#include <unistd.h>		/* close() */
+
+#include "uev.h"
+
+#define UNUSED(arg) arg __attribute__ ((unused))
+
+/* Max. messages read per wakeup, to not starve other watchers */
+#define HANDOFF_READS 16
+
+/* Every message, with or without descriptors, carries the sender's figures */
+struct uev_handoff_msg {
+	uint32_t        load;	/* Set with uev_handoff_load() */
+	uint32_t        seen;	/* Descriptors received, total */
+};
+
+/* Channel state, allocated on first use and freed when stopped */
+struct uev_handoff {
+	int            *fds;	/* Queued for the peer, owned by us */
+	size_t          num;
+	size_t          size;
+	int             dirty;	/* Our load changed, report it */
+	int             queued;	/* Counted in ctx->handoff */
+	int             dead;	/* Peer gone, waiting for HUP */
+	uint32_t        load;	/* Ours */
+	uint32_t        sent;	/* Descriptors sent, total */
+	uint32_t        seen;	/* Descriptors received, total */
+	uint32_t        peer;	/* Load last reported by peer */
+	uint32_t        acked;	/* Peer's count of descriptors received */
+};
+
+static void handoff_cb(uev_t *w, void *arg, int events);
+
+static struct uev_handoff *state(uev_t *w)
+{
+	if (!w->u.ho.h)
+		w->u.ho.h = calloc(1, sizeof(struct uev_handoff));
+
+	return w->u.ho.h;
+}
+
+/* Flushed at the end of the loop iteration */
+static void pending(uev_t *w, struct uev_handoff *h)
+{
+	if (h->queued)
+		return;
+
+	h->queued = 1;
+	w->ctx->handoff++;
+}
+
+/* Peer load, plus descriptors it has not seen yet */
+static uint32_t estimate(uev_t *w)
+{
+	struct uev_handoff *h = w->u.ho.h;
+
+	if (!h)
+		return 0;
+
+	return h->peer + (h->sent - h->acked) + h->num;
+}
+
+/* Least loaded channel, except @skip */
+static uev_t *pick(uev_ctx_t *ctx, uev_t *skip)
+{
+	uev_t *w, *best = NULL;
+	uint32_t min = 0;
+
+	LIST_FOREACH(w, &ctx->watchers, link) {
+		uint32_t load;
+
+		if (w == skip || w->cb != handoff_cb || !_uev_is_active(w))
+			continue;
+		if (w->u.ho.h && w->u.ho.h->dead)
+			continue;
+
+		load = estimate(w);
+		if (!best || load < min) {
+			best = w;
+			min  = load;
+		}
+	}
+
+	return best;
+}
+
+static int dispatch(uev_ctx_t *ctx, int fd, uev_t *skip)
+{
+	struct uev_handoff *h;
+	uev_t *w;
+
+	w = pick(ctx, skip);
+	if (!w) {
+		errno = ENOTCONN;
+		return -1;
+	}
+
+	h = state(w);
+	if (!h)
+		return -1;
+
+	if (h->num == h->size) {
+		size_t size = h->size ? h->size * 2 : UEV_HANDOFF_BATCH;
+		int *fds;
+
+		fds = realloc(h->fds, size * sizeof(int));
+		if (!fds)
+			return -1;
+
+		h->fds  = fds;
+		h->size = size;
+	}
+
+	h->fds[h->num++] = fd;
+	pending(w, h);
+
+	return 0;
+}
+
+/* Send queued descriptors in batches, and our load, until done or EAGAIN */
+static int flush(uev_t *w, struct uev_handoff *h)
+{
+	union {
+		char            buf[CMSG_SPACE(sizeof(int) * UEV_HANDOFF_BATCH)];
+		struct cmsghdr  align;
+	} ctl;
+
+	while (h->num || h->dirty) {
+		struct uev_handoff_msg m = { h->load, h->seen };
+		struct iovec iov = { &m, sizeof(m) };
+		struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1 };
+		size_t i, num = h->num > UEV_HANDOFF_BATCH ? UEV_HANDOFF_BATCH : h->num;
+
+		if (num) {
+			struct cmsghdr *cmsg;
+
+			msg.msg_control    = ctl.buf;
+			msg.msg_controllen = CMSG_SPACE(sizeof(int) * num);
+			cmsg = CMSG_FIRSTHDR(&msg);
+			cmsg->cmsg_level = SOL_SOCKET;
+			cmsg->cmsg_type  = SCM_RIGHTS;
+			cmsg->cmsg_len   = CMSG_LEN(sizeof(int) * num);
+			memcpy(CMSG_DATA(cmsg), h->fds, sizeof(int) * num);
+		}
+
+		if (sendmsg(w->fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				return -1;
+
+			/* Peer busy, wait until it has read some */
+			if (!(w->events & UEV_WRITE)) {
+				w->events |= UEV_WRITE;
+				_uev_watcher_rearm(w);
+			}
+			return 0;
+		}
+
+		/* The peer has its own reference now */
+		for (i = 0; i < num; i++)
+			close(h->fds[i]);
+		h->num -= num;
+		memmove(h->fds, &h->fds[num], h->num * sizeof(int));
+		h->sent += num;
+		h->dirty = 0;
+	}
+
+	if (w->events & UEV_WRITE) {
+		w->events &= ~UEV_WRITE;
+		_uev_watcher_rearm(w);
+	}
+
+	return 0;
+}
+
+/* Receive descriptors, and the peer's figures, until EAGAIN or EOF */
+static void receive(uev_t *w, void *arg)
+{
+	union {
+		char            buf[CMSG_SPACE(sizeof(int) * UEV_HANDOFF_BATCH)];
+		struct cmsghdr  align;
+	} ctl;
+	int active = _uev_is_active(w);
+	int i;
+
+	/* After a hangup everything left is read, unless stopped by cb */
+	for (i = 0; !active || i < HANDOFF_READS; i++) {
+		struct uev_handoff_msg m;
+		struct iovec iov = { &m, sizeof(m) };
+		struct msghdr msg = {
+			.msg_iov        = &iov,
+			.msg_iovlen     = 1,
+			.msg_control    = ctl.buf,
+			.msg_controllen = sizeof(ctl.buf),
+		};
+		struct uev_handoff *h;
+		struct cmsghdr *cmsg;
+		ssize_t len;
+
+		if (active && !_uev_is_active(w))
+			return;
+
+		len = recvmsg(w->fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+		if (len <= 0)
+			return;
+
+		/* No state after a hangup, the watcher is already stopped */
+		h = active ? state(w) : NULL;
+		if (h && len == sizeof(m)) {
+			h->peer  = m.load;
+			h->acked = m.seen;
+		}
+
+		for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+			int *fds = (int *)CMSG_DATA(cmsg);
+			size_t j, num;
+
+			if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+				continue;
+
+			num = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+			if (h)
+				h->seen += num;
+
+			for (j = 0; j < num; j++) {
+				int fd;
+
+				memcpy(&fd, &fds[j], sizeof(fd));
+				if (w->u.ho.cb)
+					w->u.ho.cb(w, arg, UEV_READ, fd);
+				else
+					close(fd);
+			}
+		}
+	}
+}
+
+static void handoff_cb(uev_t *w, void *arg, int events)
+{
+	struct uev_handoff *h = w->u.ho.h;
+
+	if (h && (events & UEV_WRITE) && !h->dead && flush(w, h))
+		h->dead = 1;
+
+	/* Any descriptors sent before a hangup are still delivered */
+	if (events & (UEV_READ | UEV_HUP | UEV_ERROR))
+		receive(w, arg);
+
+	if ((events & (UEV_HUP | UEV_ERROR)) && w->u.ho.cb)
+		w->u.ho.cb(w, arg, events & (UEV_HUP | UEV_ERROR), -1);
+}
+
+/* Private to libuEv, do not use directly! */
+int _uev_handoff_owns(uev_t *w)
+{
+	return w && w->cb == handoff_cb;
+}
+
+/* Private to libuEv, do not use directly! */
+void _uev_handoff_flush(uev_ctx_t *ctx)
+{
+	uev_t *w;
+
+	if (!ctx->handoff)
+		return;
+
+	LIST_FOREACH(w, &ctx->watchers, link) {
+		struct uev_handoff *h;
+
+		if (w->cb != handoff_cb || !w->u.ho.h || !w->u.ho.h->queued)
+			continue;
+
+		h = w->u.ho.h;
+		if (h->dead || flush(w, h))
+			h->dead = 1;
+		else if (h->num || h->dirty)
+			continue;	/* Waiting for UEV_WRITE */
+
+		h->queued = 0;
+		ctx->handoff--;
+	}
+}
+
+/* Private to libuEv, do not use directly!  Stopped, descriptors are kept */
+void _uev_handoff_pause(uev_t *w)
+{
+	struct uev_handoff *h;
+
+	if (!w || w->cb != handoff_cb || !w->u.ho.h)
+		return;
+
+	h = w->u.ho.h;
+	if (h->queued) {
+		h->queued = 0;
+		w->ctx->handoff--;
+	}
+}
+
+/* Private to libuEv, do not use directly!  Started again, send what is kept */
+void _uev_handoff_resume(uev_t *w)
+{
+	struct uev_handoff *h;
+
+	if (!w || w->cb != handoff_cb || !w->u.ho.h)
+		return;
+
+	h = w->u.ho.h;
+	if (h->num || h->dirty)
+		pending(w, h);
+}
+
+/*
+ * Private to libuEv, do not use directly!  Descriptors not yet sent go
+ * to the other channels, or are closed if there are none.
+ */
+void _uev_handoff_free(uev_t *w)
+{
+	struct uev_handoff *h;
+	size_t i;
+
+	if (!w || w->cb != handoff_cb || !w->u.ho.h)
+		return;
+
+	h = w->u.ho.h;
+	w->u.ho.h = NULL;
+	if (h->queued)
+		w->ctx->handoff--;
+
+	for (i = 0; i < h->num; i++) {
+		if (dispatch(w->ctx, h->fds[i], w))
+			close(h->fds[i]);
+	}
+
+	free(h->fds);
+	free(h);
+}
+
+/**
+ * Create a descriptor handoff channel
+ * @param ctx  A valid libuEv context
+ * @param w    Pointer to an uev_t watcher
+ * @param cb   Callback for each descriptor received, or NULL
+ * @param arg  Optional callback argument
+ * @param sd   Connected %AF_UNIX %SOCK_SEQPACKET socket to the peer
+ *
+ * One end of a channel between processes, e.g. from socketpair() before
+ * fork(), for an acceptor that passes connections to worker processes.
+ * The acceptor has one channel per worker and sends with
+ * uev_handoff_send(), the workers get each connection in @param cb with
+ * %UEV_READ, to add as an I/O watcher.  Received descriptors are closed
+ * if @param cb is NULL.
+ *
+ * Workers report their load with uev_handoff_load(), which is sent in
+ * every message on the channel, so the acceptor can pick the least
+ * loaded.  When the peer is gone @param cb is called with %UEV_HUP, or
+ * %UEV_ERROR, and -1 for the descriptor.
+ *
+ * A channel stopped with uev_io_stop() is not picked by
+ * uev_handoff_send(), but keeps the descriptors already queued on it
+ * until uev_io_start().  Use uev_handoff_stop() to close the channel
+ * for good.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_handoff_init(uev_ctx_t *ctx, uev_t *w, uev_handoff_cb_t *cb, void *arg, int sd)
+{
+	socklen_t len = sizeof(int);
+	int type;
+
+	if (sd < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* Message boundaries, and HUP when the peer closes */
+	if (getsockopt(sd, SOL_SOCKET, SO_TYPE, &type, &len))
+		return -1;
+	if (type != SOCK_SEQPACKET) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (_uev_watcher_init(ctx, w, UEV_IO_TYPE, handoff_cb, arg, sd, UEV_READ))
+		return -1;
+
+	w->u.ho.cb = cb;
+	w->u.ho.h  = NULL;
+
+	return _uev_watcher_start(w);
+}
+
+/**
+ * Stop a descriptor handoff channel for good
+ * @param w  Handoff channel, from uev_handoff_init()
+ *
+ * Descriptors queued on @param w, but not yet sent, are passed on to
+ * another channel, or closed if there is none.  The socket is owned by
+ * the caller.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_handoff_stop(uev_t *w)
+{
+	if (!w || w->cb != handoff_cb) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return _uev_io_end(w);
+}
+
+/**
+ * Pass a descriptor to the least loaded peer
+ * @param ctx  A valid libuEv context
+ * @param fd   Descriptor to pass, e.g. from accept()
+ *
+ * Picks the active handoff channel with the lowest load, as last reported
+ * by its peer plus descriptors sent since then, and queues @param fd on
+ * it.  All descriptors queued during one iteration of the event loop are
+ * sent when all callbacks have run, up to %UEV_HANDOFF_BATCH per message.
+ * The descriptor is closed once sent, or should the channel be stopped
+ * with uev_handoff_stop(), passed on to another one.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error, then
+ * @param fd is still owned by the caller.  %ENOTCONN if there are no
+ * channels.
+ */
+int uev_handoff_send(uev_ctx_t *ctx, int fd)
+{
+	if (!ctx || fd < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return dispatch(ctx, fd, NULL);
+}
+
+/**
+ * Report load to the peer of a handoff channel
+ * @param w     Handoff channel, from uev_handoff_init()
+ * @param load  Current load, e.g. number of connections being served
+ *
+ * The figure is sent at the end of the loop iteration, so a worker can
+ * update it for every connection opened and closed at the cost of at
+ * most one message per iteration.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_handoff_load(uev_t *w, unsigned int load)
+{
+	struct uev_handoff *h;
+
+	if (!w || w->cb != handoff_cb || !_uev_is_active(w)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	h = state(w);
+	if (!h)
+		return -1;
+
+	if (h->load != load) {
+		h->load  = load;
+		h->dirty = 1;
+		pending(w, h);
+	}
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,247 @@
+/* libuEv - Micro event loop library
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <linux/input.h>
+#include <linux/joystick.h>
+#include <string.h>		/* memmove() */
+#include <unistd.h>		/* read() */
+
+#include "uev.h"
+
+
+/*
+ * Merge joystick axis motion.  A later value for the same axis replaces
+ * any earlier one, unless a button event is seen in between.  Button
+ * and init events are never dropped or reordered.
+ */
+static size_t js_compress(struct js_event *ev, size_t num)
+{
+	size_t i, j, n = 0, base = 0;
+
+	for (i = 0; i < num; i++) {
+		if (ev[i].type == JS_EVENT_AXIS) {
+			for (j = base; j < n; j++) {
+				if (ev[j].type == JS_EVENT_AXIS && ev[j].number == ev[i].number)
+					break;
+			}
+
+			if (j < n) {
+				ev[j].time  = ev[i].time;
+				ev[j].value = ev[i].value;
+				continue;
+			}
+
+			ev[n++] = ev[i];
+			continue;
+		}
+
+		/* Barrier, buttons and synthetic init events */
+		ev[n++] = ev[i];
+		base = n;
+	}
+
+	return n;
+}
+
+/*
+ * Per-frame hardware timestamps are sent with motion, treat as such.
+ * Multi-touch codes are not, ABS_MT_* values refer to the slot last
+ * selected by ABS_MT_SLOT and cannot be moved to another frame.
+ */
+static int is_motion(struct input_event *ev)
+{
+	if (ev->type == EV_ABS)
+		return ev->code < ABS_MT_SLOT;
+	if (ev->type == EV_REL)
+		return 1;
+#ifdef MSC_TIMESTAMP
+	if (ev->type == EV_MSC && ev->code == MSC_TIMESTAMP)
+		return 1;
+#endif
+
+	return 0;
+}
+
+/* Length of the frame at @ev, @motion is set if complete and motion-only */
+static size_t frame_len(struct input_event *ev, size_t num, int *motion)
+{
+	size_t i;
+
+	*motion = 1;
+	for (i = 0; i < num; i++) {
+		if (ev[i].type == EV_SYN && ev[i].code == SYN_REPORT)
+			return i + 1;
+		if (!is_motion(&ev[i]))
+			*motion = 0;
+	}
+
+	/* Rest of the frame is in the next read */
+	*motion = 0;
+
+	return num;
+}
+
+/*
+ * Merge consecutive evdev frames that only carry relative or absolute
+ * motion.  The intermediate SYN_REPORTs are dropped, absolute axes keep
+ * their last value and relative axes are summed.  Frames with any other
+ * event, e.g. EV_KEY, ABS_MT_* or SYN_DROPPED, and incomplete frames are
+ * delivered as-is and nothing is merged across them.
+ */
+static size_t evdev_compress(struct input_event *ev, size_t num)
+{
+	size_t i, j, k, len, n = 0, base = 0;
+	int motion, merge = 0;
+
+	for (i = 0; i < num; i += len) {
+		len = frame_len(&ev[i], num - i, &motion);
+
+		if (!motion || !merge) {
+			memmove(&ev[n], &ev[i], len * sizeof(*ev));
+			base  = n;
+			n    += len;
+			merge = motion;
+			continue;
+		}
+
+		/* Fold into the previous frame, ev[base] .. ev[n - 1] */
+		for (k = i; k < i + len - 1; k++) {
+			struct input_event e = ev[k];
+
+			for (j = base; j < n - 1; j++) {
+				if (ev[j].type == e.type && ev[j].code == e.code)
+					break;
+			}
+
+			if (j < n - 1) {
+				if (e.type == EV_REL)
+					e.value += ev[j].value;
+				ev[j] = e;
+				continue;
+			}
+
+			/* Keep the SYN_REPORT last, never overtakes ev[k + 1] */
+			ev[n]     = ev[n - 1];
+			ev[n - 1] = e;
+			n++;
+		}
+
+		/* Only refresh time of the last SYN_REPORT */
+		ev[n - 1] = ev[i + len - 1];
+	}
+
+	return n;
+}
+
+/* Reads one batch of events per wakeup, compresses and calls user cb */
+static void input_cb(uev_t *w, void *arg, int events)
+{
+	union {
+		struct js_event    js[UEV_INPUT_BATCH];
+		struct input_event ev[UEV_INPUT_BATCH];
+	} buf;
+	size_t num;
+	ssize_t len;
+
+	if (events & (UEV_ERROR | UEV_HUP)) {
+		w->u.in.cb(w, arg, events, NULL, 0);
+		return;
+	}
+
+	if (w->u.in.proto == UEV_INPUT_JOYSTICK)
+		len = read(w->fd, buf.js, sizeof(buf.js));
+	else
+		len = read(w->fd, buf.ev, sizeof(buf.ev));
+	if (len < 0) {
+		if (errno == EAGAIN || errno == EINTR)
+			return;
+
+		w->u.in.cb(w, arg, UEV_ERROR, NULL, 0);
+		return;
+	}
+
+	if (len == 0) {
+		w->u.in.cb(w, arg, events | UEV_HUP, NULL, 0);
+		return;
+	}
+
+	/* Device nodes always return whole events, drop any trailing bytes */
+	if (w->u.in.proto == UEV_INPUT_JOYSTICK) {
+		num = js_compress(buf.js, len / sizeof(struct js_event));
+		w->u.in.cb(w, arg, events, buf.js, num);
+	} else {
+		num = evdev_compress(buf.ev, len / sizeof(struct input_event));
+		w->u.in.cb(w, arg, events, buf.ev, num);
+	}
+}
+
+/* Private to libuEv, do not use directly! */
+int _uev_input_owns(uev_t *w)
+{
+	return w && w->cb == input_cb;
+}
+
+/**
+ * Create an input device watcher
+ * @param ctx    A valid libuEv context
+ * @param w      Pointer to an uev_t watcher
+ * @param cb     Input callback, called with a batch of events
+ * @param arg    Optional callback argument
+ * @param fd     Non-blocking descriptor for a joystick or evdev device
+ * @param proto  Device protocol: %UEV_INPUT_JOYSTICK or %UEV_INPUT_EVDEV
+ *
+ * Instead of one wakeup per event, up to %UEV_INPUT_BATCH events are
+ * read per wakeup.  Intermediate axis motion is merged before the batch
+ * is handed to @param cb, so a high-rate device only costs one callback
+ * per wakeup.  Use uev_io_start() and uev_io_stop() as for I/O watchers.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_input_init(uev_ctx_t *ctx, uev_t *w, uev_input_cb_t *cb, void *arg, int fd, int proto)
+{
+	if (fd < 0 || !cb) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (proto != UEV_INPUT_JOYSTICK && proto != UEV_INPUT_EVDEV) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (_uev_watcher_init(ctx, w, UEV_IO_TYPE, input_cb, arg, fd, UEV_READ))
+		return -1;
+
+	w->u.in.cb    = cb;
+	w->u.in.proto = proto;
+
+	return _uev_watcher_start(w);
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -23,9 +23,146 @@
  */
 
 #include <errno.h>
+#include <limits.h>		/* INT_MAX */
+#include <stdlib.h>		/* calloc(), realloc() */
+#include <string.h>		/* memcpy(), memmove() */
+#include <netinet/in.h>		/* IPPROTO_TCP */
+#include <netinet/tcp.h>	/* TCP_NOTSENT_LOWAT */
+#include <sys/socket.h>		/* send() */
+#include <unistd.h>		/* write() */
+
 #include "uev.h"
 
 
+/* Milliseconds since oldest queued byte */
+static int held(struct uev_oq *oq)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - oq->since.tv_sec) * 1000 +
+		(now.tv_nsec - oq->since.tv_nsec) / 1000000;
+}
+
+static struct uev_oq *oq_get(uev_t *w)
+{
+	if (!w->oq)
+		w->oq = calloc(1, sizeof(struct uev_oq));
+
+	return w->oq;
+}
+
+/* Private to libuEv, do not use directly! */
+int _uev_io_flush(uev_t *w)
+{
+	struct uev_oq *oq = w->oq;
+	ssize_t num;
+	int blocked;
+
+	if (!oq)
+		return 0;
+
+	if (oq->queued) {
+		LIST_REMOVE(w, oq->link);
+		oq->queued = 0;
+	}
+
+	if (!oq->len)
+		return 0;
+
+	/* Avoid SIGPIPE on sockets, fall back to write() for pipes etc. */
+	num = send(w->fd, oq->buf, oq->len, MSG_NOSIGNAL | MSG_DONTWAIT);
+	if (num < 0 && errno == ENOTSOCK)
+		num = write(w->fd, oq->buf, oq->len);
+	if (num < 0) {
+		if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+			oq->len = 0;
+			return -1;
+		}
+		num = 0;
+	}
+
+	oq->len -= num;
+	if (oq->len)
+		memmove(oq->buf, oq->buf + num, oq->len);
+
+	/* Ask for EPOLLOUT while there is a remainder, and drop it after */
+	blocked = oq->len > 0;
+	if (blocked != oq->blocked) {
+		oq->blocked = blocked;
+		if (_uev_is_active(w))
+			return _uev_watcher_rearm(w);
+	}
+
+	return 0;
+}
+
+/* Private to libuEv, do not use directly! */
+void _uev_io_flush_all(uev_ctx_t *ctx)
+{
+	while (!LIST_EMPTY(&ctx->flushq)) {
+		uev_t *w = LIST_FIRST(&ctx->flushq);
+
+		if (!_uev_io_flush(w))
+			continue;
+
+		/* Same failure mode as for any other I/O watcher error */
+		_uev_io_free(w);
+		_uev_io_end(w);
+		if (w->cb)
+			w->cb(w, w->arg, UEV_ERROR);
+	}
+}
+
+/* Private to libuEv, do not use directly! */
+void _uev_io_free(uev_t *w)
+{
+	if (!w || !w->oq)
+		return;
+
+	if (w->oq->queued)
+		LIST_REMOVE(w, oq->link);
+
+	free(w->oq->buf);
+	free(w->oq);
+	w->oq = NULL;
+}
+
+
+/* Output and zero-copy sends cannot wait for the watcher to be started again */
+static void io_pause(uev_t *w)
+{
+	/* Best effort, the descriptor is likely closed after this */
+	if (w && w->oq && !w->oq->blocked)
+		_uev_io_flush(w);
+	_uev_io_free(w);
+	_uev_io_zc_free(w);
+	_uev_limit_pause(w);
+	_uev_handoff_pause(w);
+	if (w)
+		w->lowait = 0;
+}
+
+/* Private to libuEv, do not use directly!  Stopped for good, all state freed */
+void _uev_io_release(uev_t *w)
+{
+	io_pause(w);
+	_uev_limit_free(w);
+	_uev_frame_free(w);
+	_uev_handoff_free(w);
+	if (w)
+		w->lowat = 0;
+}
+
+/* Private to libuEv, do not use directly!  On error, hangup, or *_stop() */
+int _uev_io_end(uev_t *w)
+{
+	_uev_io_release(w);
+
+	return _uev_watcher_stop(w);
+}
+
 /**
  * Create an I/O watcher
  * @param ctx     A valid libuEv context
@@ -50,6 +187,54 @@ int uev_io_init(uev_ctx_t *ctx, uev_t *w, uev_cb_t *cb, void *arg, int fd, int e
 	return _uev_watcher_start(w);
 }
 
+/**
+ * Create many I/O watchers
+ * @param ctx  A valid libuEv context
+ * @param io   Array of @num watchers, with descriptor, events, and callback
+ * @param num  Number of watchers in @io
+ *
+ * Same as calling uev_io_init() for each entry in @io, but all entries
+ * are checked before any watcher is started, and if one fails to start
+ * the ones already started are stopped again.  Use with a context from
+ * uev_init1() with %UEV_INIT_LAZY to defer all epoll_ctl() calls to the
+ * first uev_run().
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_io_init_many(uev_ctx_t *ctx, uev_io_spec_t *io, size_t num)
+{
+	size_t i;
+
+	if (!ctx || (!io && num)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	for (i = 0; i < num; i++) {
+		if (!io[i].w || io[i].fd < 0) {
+			errno = EINVAL;
+			return -1;
+		}
+	}
+
+	for (i = 0; i < num; i++) {
+		uev_t *w = io[i].w;
+
+		_uev_watcher_init(ctx, w, UEV_IO_TYPE, io[i].cb, io[i].arg, io[i].fd, io[i].events);
+		if (_uev_watcher_start(w)) {
+			int err = errno;
+
+			while (i--)
+				uev_io_stop(io[i].w);
+			errno = err;
+
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
 /**
  * Reset an I/O watcher
  * @param w       Pointer to an uev_t watcher
@@ -61,13 +246,29 @@ int uev_io_init(uev_ctx_t *ctx, uev_t *w, uev_cb_t *cb, void *arg, int fd, int e
 int uev_io_set(uev_t *w, int fd, int events)
 {
 
-	if ((events & UEV_ONESHOT) && _uev_watcher_active(w))
+	if ((events & UEV_ONESHOT) && _uev_is_active(w))
 		return _uev_watcher_rearm(w);
 
 	/* Ignore any errors, only to clean up anything lingering ... */
-	uev_io_stop(w);
+	_uev_watcher_stop(w);
+
+	if (fd < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* Keep callback and any per-type data, e.g. for input watchers */
+	w->fd     = fd;
+	w->events = events;
 
-	return uev_io_init(w->ctx, w, (uev_cb_t *)w->cb, w->arg, fd, events);
+	if (_uev_watcher_start(w))
+		return -1;
+
+	/* State kept by uev_io_stop() */
+	_uev_limit_resume(w);
+	_uev_handoff_resume(w);
+
+	return 0;
 }
 
 /**
@@ -85,13 +286,224 @@ int uev_io_start(uev_t *w)
  * Stop an I/O watcher
  * @param w  Watcher to stop
  *
+ * Output queued with uev_io_write() is written, best effort, and any
+ * outstanding uev_io_send_zc() requests are completed.  Other state is
+ * kept for uev_io_start(): the token bucket of uev_io_limit(), the
+ * partial frame of a frame watcher, descriptors queued on a handoff
+ * channel, and the uev_io_lowat() threshold.  Release it before reusing
+ * the watcher's memory, with uev_frame_stop(), uev_handoff_stop(), or
+ * uev_io_limit() with zero rate.  All of it is released on %UEV_HUP,
+ * %UEV_ERROR, and uev_exit().
+ *
  * @return POSIX OK(0) or non-zero with @param errno set on error.
  */
 int uev_io_stop(uev_t *w)
 {
+	io_pause(w);
+
 	return _uev_watcher_stop(w);
 }
 
+/**
+ * Queue data for writing on an I/O watcher
+ * @param w    Active I/O watcher
+ * @param buf  Data to write
+ * @param len  Length of @param buf
+ *
+ * The data is copied to the watcher's output queue.  All data queued
+ * during one iteration of the event loop is written with a single call
+ * to send(), or write() for non-sockets, when all callbacks have run.
+ * This saves both syscalls and small TCP segments for request handlers
+ * that produce several small responses to the same socket.
+ *
+ * Should the descriptor not accept all data, the remainder is written
+ * when it is writable again, without the callback being called unless
+ * it has asked for %UEV_WRITE.  Do not mix with plain write() calls on
+ * the same descriptor, data would be reordered.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_io_write(uev_t *w, const void *buf, size_t len)
+{
+	struct uev_oq *oq;
+
+	if (!w || !buf || w->type != UEV_IO_TYPE || !_uev_is_active(w)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	oq = oq_get(w);
+	if (!oq)
+		return -1;
+
+	if (oq->len + len > oq->size) {
+		size_t size = oq->size ? oq->size : 512;
+		char *ptr;
+
+		while (size < oq->len + len)
+			size *= 2;
+
+		ptr = realloc(oq->buf, size);
+		if (!ptr)
+			return -1;
+
+		oq->buf  = ptr;
+		oq->size = size;
+	}
+
+	if (!oq->len)
+		clock_gettime(CLOCK_MONOTONIC, &oq->since);
+	memcpy(oq->buf + oq->len, buf, len);
+	oq->len += len;
+
+	/* Remainder of previous flush pending, wait for EPOLLOUT */
+	if (oq->blocked)
+		return 0;
+
+	if (oq->hold < 0 || oq->len >= UEV_IO_COALESCE_MAX ||
+	    (oq->hold > 0 && held(oq) >= oq->hold))
+		return _uev_io_flush(w);
+
+	if (!oq->queued) {
+		LIST_INSERT_HEAD(&w->ctx->flushq, w, oq->link);
+		oq->queued = 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Write any queued output on an I/O watcher now
+ * @param w  Active I/O watcher
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_io_flush(uev_t *w)
+{
+	if (!w || w->type != UEV_IO_TYPE) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return _uev_io_flush(w);
+}
+
+/**
+ * Number of bytes queued, but not yet written, on an I/O watcher
+ * @param w  I/O watcher
+ *
+ * Useful for applying back pressure on a slow peer.
+ *
+ * @return Number of bytes in the output queue.
+ */
+size_t uev_io_pending(uev_t *w)
+{
+	if (!w || !w->oq)
+		return 0;
+
+	return w->oq->len;
+}
+
+/**
+ * Control output coalescing of an I/O watcher
+ * @param w     I/O watcher
+ * @param hold  Max. time in milliseconds to hold output, zero (default)
+ *              to hold until the end of the event loop iteration, or
+ *              -1 to disable coalescing for this watcher
+ *
+ * Latency sensitive flows can opt out completely, in which case each
+ * uev_io_write() is written immediately, or set a max. hold time which
+ * flushes the queue early when an iteration runs long.  The setting is
+ * reset when the watcher is stopped with uev_io_stop().
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_io_coalesce(uev_t *w, int hold)
+{
+	struct uev_oq *oq;
+
+	if (!w || w->type != UEV_IO_TYPE || !_uev_is_active(w)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	oq = oq_get(w);
+	if (!oq)
+		return -1;
+
+	oq->hold = hold < 0 ? -1 : hold;
+	if (oq->hold < 0 && !oq->blocked)
+		return _uev_io_flush(w);
+
+	return 0;
+}
+
+/**
+ * Set writable threshold for an I/O watcher
+ * @param w      Pointer to an I/O watcher
+ * @param bytes  Free send buffer space needed for %UEV_WRITE, or 0 to disable
+ *
+ * Streaming senders are otherwise woken up as soon as any send buffer
+ * space frees up, which leads to many small writes.  TCP sockets use
+ * TCP_NOTSENT_LOWAT, the callback is then called when less than @bytes
+ * are waiting to be sent.  Other sockets, e.g. UNIX and UDP, where the
+ * kernel does not allow setting SO_SNDLOWAT, are tracked in user space:
+ * %UEV_WRITE is held back until @bytes of the send buffer is free, in
+ * the meantime the watcher is edge triggered.  This needs the epoll()
+ * backend.  Pipes only wake up writers when going from full, so they
+ * cannot be tracked without polling, and fail with %EOPNOTSUPP.
+ *
+ * The user space setting is kept across uev_io_stop() and uev_io_start(),
+ * and reset on %UEV_HUP and %UEV_ERROR.  The TCP socket option stays
+ * with the socket.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_io_lowat(uev_t *w, size_t bytes)
+{
+	socklen_t len = sizeof(int);
+	int val = (int)bytes;
+	int sndbuf;
+
+	if (!w || w->type != UEV_IO_TYPE || w->fd < 0 || bytes > INT_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	w->lowat = 0;
+	if (w->lowait) {
+		w->lowait = 0;
+		if (_uev_is_active(w))
+			_uev_watcher_rearm(w);
+	}
+
+	/* Zero restores the system default, net.ipv4.tcp_notsent_lowat */
+	if (!setsockopt(w->fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &val, len))
+		return 0;
+	if (!bytes)
+		return 0;
+
+	/* Read-only on Linux, but not on all systems */
+	if (!setsockopt(w->fd, SOL_SOCKET, SO_SNDLOWAT, &val, len))
+		return 0;
+
+	if (getsockopt(w->fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, &len)) {
+		if (errno == ENOTSOCK)
+			errno = EOPNOTSUPP;
+		return -1;
+	}
+
+	if (w->ctx->backend != UEV_BACKEND_EPOLL) {
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+
+	/* Both SO_SNDBUF and SIOCOUTQ include kernel bookkeeping */
+	w->lowat = sndbuf > val ? sndbuf - val : 1;
+
+	return 0;
+}
+
 /**
  * Local Variables:
  *  indent-tabs-mode: t
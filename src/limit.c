@@ -0,0 +1,402 @@
+/* libuEv - Micro event loop library
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>		/* calloc(), realloc(), free() */
+#include <time.h>		/* clock_gettime() */
+
+#include "uev.h"
+
+#define UNUSED(arg) arg __attribute__ ((unused))
+
+/* Tokens are kept in 1/1000 units, refilled at @rate per second */
+#define UNIT 1000
+
+/* Token bucket, per rate limited I/O watcher */
+struct uev_rl {
+	int             unit;	/* UEV_LIMIT_EVENTS or UEV_LIMIT_BYTES */
+	int64_t         rate;	/* Units per second == 1/1000 units per msec */
+	int64_t         cap;	/* Burst, in 1/1000 units */
+	int64_t         tokens;	/* May go negative, reads are not split */
+	uint64_t        last;	/* Last refill, loop time */
+	uint64_t        due;	/* When paused, loop time to resume */
+	int             pos;	/* Index in heap, -1 when not paused */
+};
+
+/*
+ * Paused watchers, in a min-heap on due time, and one timer for the
+ * context that fires when the first of them can resume.
+ */
+struct uev_limiter {
+	uev_t           timer;
+	uint64_t        now;	/* Cached loop time, msec */
+	uev_t         **heap;
+	int             num;
+	int             size;
+};
+
+static uint64_t loop_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void heap_swap(struct uev_limiter *lim, int a, int b)
+{
+	uev_t *w = lim->heap[a];
+
+	lim->heap[a] = lim->heap[b];
+	lim->heap[b] = w;
+	lim->heap[a]->rl->pos = a;
+	lim->heap[b]->rl->pos = b;
+}
+
+static void heap_up(struct uev_limiter *lim, int i)
+{
+	while (i > 0) {
+		int parent = (i - 1) / 2;
+
+		if (lim->heap[parent]->rl->due <= lim->heap[i]->rl->due)
+			break;
+
+		heap_swap(lim, parent, i);
+		i = parent;
+	}
+}
+
+static void heap_down(struct uev_limiter *lim, int i)
+{
+	while (1) {
+		int min = i, l = 2 * i + 1, r = l + 1;
+
+		if (l < lim->num && lim->heap[l]->rl->due < lim->heap[min]->rl->due)
+			min = l;
+		if (r < lim->num && lim->heap[r]->rl->due < lim->heap[min]->rl->due)
+			min = r;
+		if (min == i)
+			break;
+
+		heap_swap(lim, min, i);
+		i = min;
+	}
+}
+
+static int heap_push(struct uev_limiter *lim, uev_t *w)
+{
+	if (lim->num == lim->size) {
+		int size = lim->size ? lim->size * 2 : 64;
+		uev_t **heap;
+
+		heap = realloc(lim->heap, size * sizeof(uev_t *));
+		if (!heap)
+			return -1;
+
+		lim->heap = heap;
+		lim->size = size;
+	}
+
+	w->rl->pos = lim->num;
+	lim->heap[lim->num++] = w;
+	heap_up(lim, w->rl->pos);
+
+	return 0;
+}
+
+static void heap_del(struct uev_limiter *lim, uev_t *w)
+{
+	int i = w->rl->pos;
+
+	w->rl->pos = -1;
+	if (--lim->num == i)
+		return;
+
+	lim->heap[i] = lim->heap[lim->num];
+	lim->heap[i]->rl->pos = i;
+	heap_up(lim, i);
+	heap_down(lim, lim->heap[i]->rl->pos);
+}
+
+static void resume_cb(uev_t *t, void *arg, int events);
+
+/*
+ * Arm the context timer for the first watcher to resume.  The timer is
+ * one-shot, when nothing is paused it is stopped and the event loop can
+ * return when all other watchers are stopped.
+ */
+static void schedule(uev_ctx_t *ctx, struct uev_limiter *lim)
+{
+	uint64_t due;
+	int msec;
+
+	if (!lim->num)
+		return;
+
+	due  = lim->heap[0]->rl->due;
+	msec = due > lim->now ? (int)(due - lim->now) : 1;
+	if (uev_timer_active(&lim->timer))
+		uev_timer_set(&lim->timer, msec, 0);
+	else
+		uev_timer_init(ctx, &lim->timer, resume_cb, lim, msec, 0);
+}
+
+static void refill(struct uev_rl *rl, uint64_t now)
+{
+	uint64_t elapsed = now - rl->last;
+
+	rl->last = now;
+	if (elapsed >= (uint64_t)((rl->cap - rl->tokens) / rl->rate) + 1)
+		rl->tokens = rl->cap;
+	else
+		rl->tokens += (int64_t)elapsed * rl->rate;
+}
+
+/* Stop read interest until the bucket has at least one unit again */
+static void throttle(uev_t *w)
+{
+	struct uev_limiter *lim = w->ctx->lim;
+	struct uev_rl *rl = w->rl;
+	int top;
+
+	rl->due = lim->now + (UNIT - rl->tokens + rl->rate - 1) / rl->rate;
+	if (heap_push(lim, w))
+		return;		/* Out of memory, keep reading */
+
+	top = rl->pos == 0;
+	_uev_watcher_rearm(w);
+	if (top)
+		schedule(w->ctx, lim);
+}
+
+static void resume_cb(uev_t *t, void *arg, int UNUSED(events))
+{
+	struct uev_limiter *lim = arg;
+
+	lim->now = loop_time();
+	while (lim->num && lim->heap[0]->rl->due <= lim->now) {
+		uev_t *w = lim->heap[0];
+
+		heap_del(lim, w);
+		refill(w->rl, lim->now);
+		if (_uev_is_active(w))
+			_uev_watcher_rearm(w);
+	}
+
+	schedule(t->ctx, lim);
+}
+
+static struct uev_limiter *limiter(uev_ctx_t *ctx)
+{
+	struct uev_limiter *lim;
+
+	if (ctx->lim)
+		return ctx->lim;
+
+	lim = calloc(1, sizeof(*lim));
+	if (!lim)
+		return NULL;
+
+	lim->now = loop_time();
+	ctx->lim = lim;
+
+	return lim;
+}
+
+/* Private to libuEv, do not use directly! */
+void _uev_limit_tick(uev_ctx_t *ctx)
+{
+	ctx->lim->now = loop_time();
+}
+
+/* Private to libuEv, do not use directly! */
+int _uev_limit_paused(uev_t *w)
+{
+	return w->rl && w->rl->pos >= 0;
+}
+
+/* Private to libuEv, do not use directly! */
+int _uev_limit_owns(uev_t *w)
+{
+	return w->cb == resume_cb;
+}
+
+/* Private to libuEv, do not use directly! */
+void _uev_limit_count(uev_t *w, int unit, size_t num)
+{
+	if (w->rl && w->rl->unit == unit)
+		uev_io_charge(w, num);
+}
+
+/* Private to libuEv, do not use directly!  Stopped, the bucket is kept */
+void _uev_limit_pause(uev_t *w)
+{
+	if (!w || !w->rl || w->rl->pos < 0)
+		return;
+
+	heap_del(w->ctx->lim, w);
+}
+
+/* Private to libuEv, do not use directly!  Started again, maybe still empty */
+void _uev_limit_resume(uev_t *w)
+{
+	struct uev_rl *rl;
+
+	if (!w || !w->rl || w->rl->pos >= 0)
+		return;
+
+	rl = w->rl;
+	refill(rl, w->ctx->lim->now);
+	if (rl->tokens < UNIT)
+		throttle(w);
+}
+
+/* Private to libuEv, do not use directly! */
+void _uev_limit_free(uev_t *w)
+{
+	if (!w || !w->rl)
+		return;
+
+	if (w->rl->pos >= 0)
+		heap_del(w->ctx->lim, w);
+
+	free(w->rl);
+	w->rl = NULL;
+}
+
+/* Private to libuEv, do not use directly! */
+void _uev_limit_exit(uev_ctx_t *ctx)
+{
+	struct uev_limiter *lim = ctx->lim;
+
+	if (!lim)
+		return;
+
+	/* Paused watchers have been released by uev_exit() */
+	ctx->lim = NULL;
+	free(lim->heap);
+	free(lim);
+}
+
+/**
+ * Limit the rate of an I/O watcher
+ * @param w      Pointer to an active I/O watcher
+ * @param unit   Either %UEV_LIMIT_EVENTS or %UEV_LIMIT_BYTES
+ * @param rate   Units per second, or zero to remove the limit
+ * @param burst  Max. number of units saved up while idle, at least one
+ *
+ * Token bucket for one watcher, refilled at @rate per second from the
+ * cached loop time.  With %UEV_LIMIT_EVENTS each %UEV_READ callback takes
+ * one token, with %UEV_LIMIT_BYTES receive watchers are charged for the
+ * bytes read, other watchers call uev_io_charge().  When the bucket runs
+ * empty the watcher stops asking for %UEV_READ, and is resumed when it
+ * has refilled.  One timer per context is used for all watchers.
+ *
+ * The bucket is kept across uev_io_stop() and uev_io_start().  It is
+ * removed on %UEV_HUP, %UEV_ERROR, and uev_exit(), or with zero @rate,
+ * which must be done before reusing the memory of a stopped watcher.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_io_limit(uev_t *w, int unit, unsigned int rate, unsigned int burst)
+{
+	struct uev_limiter *lim;
+	struct uev_rl *rl;
+
+	if (!w || !w->ctx || w->type != UEV_IO_TYPE ||
+	    (unit != UEV_LIMIT_EVENTS && unit != UEV_LIMIT_BYTES)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (!rate) {
+		int paused = _uev_limit_paused(w);
+
+		_uev_limit_free(w);
+		if (paused && _uev_is_active(w))
+			return _uev_watcher_rearm(w);
+
+		return 0;
+	}
+
+	lim = limiter(w->ctx);
+	if (!lim)
+		return -1;
+
+	if (!w->rl) {
+		w->rl = calloc(1, sizeof(*w->rl));
+		if (!w->rl)
+			return -1;
+
+		w->rl->pos    = -1;
+		w->rl->last   = lim->now;
+		w->rl->tokens = (int64_t)(burst ? burst : 1) * UNIT;
+	}
+
+	rl = w->rl;
+	rl->unit = unit;
+	rl->rate = rate;
+	rl->cap  = (int64_t)(burst ? burst : 1) * UNIT;
+	if (rl->tokens > rl->cap)
+		rl->tokens = rl->cap;
+
+	return 0;
+}
+
+/**
+ * Charge a rate limited I/O watcher
+ * @param w    Pointer to an I/O watcher with a limit, see uev_io_limit()
+ * @param num  Number of units consumed, e.g. bytes read by the callback
+ *
+ * Takes @num tokens from the watcher's bucket.  The bucket may go into
+ * debt, a large read is paid for with a longer pause.  When no whole
+ * unit is left the watcher is paused.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_io_charge(uev_t *w, size_t num)
+{
+	struct uev_rl *rl;
+
+	if (!w || !w->rl) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	rl = w->rl;
+	refill(rl, w->ctx->lim->now);
+	rl->tokens -= (int64_t)num * UNIT;
+	if (rl->tokens < UNIT && rl->pos < 0 && _uev_is_active(w))
+		throttle(w);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
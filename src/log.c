@@ -0,0 +1,412 @@
+/* libuEv - Durable append log, group commit on the file I/O engine
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <stdlib.h>		/* calloc(), realloc(), free() */
+#include <string.h>		/* memcpy() */
+#include <sys/stat.h>		/* fstat() */
+
+#include "uev.h"
+
+#define UNUSED(arg) arg __attribute__ ((unused))
+
+/* Initial size of a batch, doubled as needed up to UEV_LOG_MAX */
+#define LOG_BATCH 65536
+
+/* Record waiting for its batch to reach the disk */
+struct uev_rec {
+	uev_log_cb_t   *cb;
+	void           *arg;
+	size_t          pos;	/* Offset in batch */
+};
+
+struct uev_batch {
+	char           *buf;
+	size_t          len;
+	size_t          size;
+	size_t          done;	/* Bytes written, on short writes */
+	struct uev_rec *rec;
+	size_t          num;
+	size_t          max;
+};
+
+/*
+ * One batch is filled by the application while the other one is being
+ * written, so each write covers all records appended during the last.
+ */
+struct uev_log {
+	struct uev_log *next;	/* All logs of the context */
+	uev_ctx_t      *ctx;
+	uev_t          *w;
+	off_t           off;	/* End of log, where the next batch goes */
+	struct uev_batch b[2];
+	int             fill;	/* Batch being filled */
+	int             busy;	/* The other one is being written */
+	int             queued;	/* Counted in ctx->logq */
+	int             stopped; /* Free when the write completes */
+	int             delivering; /* Calling back, free on return */
+	int             err;	/* Sticky, once a write fails */
+};
+
+static void log_cb(uev_t *w, void *arg, void *buf, ssize_t res);
+
+static void batch_free(struct uev_batch *b)
+{
+	free(b->buf);
+	free(b->rec);
+}
+
+static void log_free(struct uev_log *l)
+{
+	struct uev_log **pp;
+
+	for (pp = &l->ctx->logs; *pp; pp = &(*pp)->next) {
+		if (*pp == l) {
+			*pp = l->next;
+			break;
+		}
+	}
+
+	batch_free(&l->b[0]);
+	batch_free(&l->b[1]);
+	free(l);
+}
+
+/* Written when the loop next waits, more records may be appended until then */
+static int seal(struct uev_log *l)
+{
+	if (l->queued || l->busy || !l->b[l->fill].num)
+		return 0;
+
+	if (_uev_file_hold(l->ctx, 1))
+		return -1;
+
+	l->queued = 1;
+	l->ctx->logq++;
+
+	return 0;
+}
+
+static void dequeue(struct uev_log *l)
+{
+	if (!l->queued)
+		return;
+
+	l->queued = 0;
+	l->ctx->logq--;
+	_uev_file_hold(l->ctx, -1);
+}
+
+static int submit(struct uev_log *l)
+{
+	struct uev_batch *b = &l->b[!l->fill];
+
+	return _uev_file_write_dsync(l->w, b->buf + b->done, b->len - b->done,
+				     l->off + b->done, log_cb, l);
+}
+
+/* Call back for each record of a batch, false if the log was stopped */
+static int durable(struct uev_log *l, struct uev_batch *b, int err)
+{
+	size_t i;
+
+	l->delivering = 1;
+	for (i = 0; i < b->num; i++) {
+		struct uev_rec *r = &b->rec[i];
+
+		errno = err;
+		r->cb(l->w, r->arg, err ? -1 : l->off + (off_t)r->pos);
+
+		/* By the callback, with uev_log_stop() or uev_exit() */
+		if (l->stopped) {
+			log_free(l);
+			return 0;
+		}
+	}
+	l->delivering = 0;
+
+	b->len  = 0;
+	b->done = 0;
+	b->num  = 0;
+
+	return 1;
+}
+
+static void log_cb(uev_t *UNUSED(w), void *arg, void *UNUSED(buf), ssize_t res)
+{
+	struct uev_log *l = arg;
+	struct uev_batch *b = &l->b[!l->fill];
+	size_t len = b->len;
+	int err = res < 0 ? errno : 0;
+
+	if (l->stopped) {
+		log_free(l);
+		return;
+	}
+
+	if (!err && res == 0)
+		err = EIO;
+	if (!err) {
+		b->done += res;
+		if (b->done < b->len) {
+			if (!submit(l))
+				return;
+			err = errno;
+		}
+	}
+
+	/* After a failed write the end of the log is unknown, give up */
+	if (err)
+		l->err = err;
+
+	if (!durable(l, b, err))
+		return;
+
+	l->off += len;
+	l->busy = 0;
+	if (l->err) {
+		/* Nothing more is written, drop the hold on the loop */
+		dequeue(l);
+		durable(l, &l->b[l->fill], l->err);
+		return;
+	}
+
+	seal(l);
+}
+
+/* Private to libuEv, do not use directly! */
+void _uev_log_submit(uev_ctx_t *ctx)
+{
+	struct uev_log *l;
+
+	if (!ctx->logq)
+		return;
+
+	for (l = ctx->logs; l; l = l->next) {
+		if (!l->queued)
+			continue;
+
+		/* Never a zero-length write */
+		if (l->err || !l->b[l->fill].num) {
+			dequeue(l);
+			continue;
+		}
+
+		l->fill = !l->fill;
+		if (submit(l)) {
+			/* Out of memory, try again next time */
+			l->fill = !l->fill;
+			continue;
+		}
+
+		l->busy = 1;
+		dequeue(l);
+	}
+}
+
+/* Private to libuEv, do not use directly!  After _uev_file_free() */
+void _uev_log_exit(uev_ctx_t *ctx)
+{
+	while (ctx->logs) {
+		struct uev_log *l = ctx->logs;
+
+		ctx->logs = l->next;
+		l->next = NULL;
+		if (!l->stopped)
+			l->w->u.lg.l = NULL;
+
+		/* Calling back, freed when the callback returns */
+		if (l->delivering) {
+			l->stopped = 1;
+			continue;
+		}
+		log_free(l);
+	}
+	ctx->logq = 0;
+}
+
+/**
+ * Create a durable append log
+ * @param ctx  A valid libuEv context
+ * @param w    Pointer to an uev_t watcher
+ * @param fd   Regular file, opened for writing by the application
+ *
+ * Records appended with uev_log_append() are written at the end of the
+ * file, with fdatasync() semantics, by the file I/O engine, see
+ * uev_file_backend().  All records appended while one write is in
+ * flight go in the next write, so the batch size follows the rate of
+ * records times the time it takes the storage to sync.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_log_init(uev_ctx_t *ctx, uev_t *w, int fd)
+{
+	struct uev_log *l;
+	struct stat st;
+
+	if (!ctx || !w || fd < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (fstat(fd, &st))
+		return -1;
+
+	l = calloc(1, sizeof(*l));
+	if (!l)
+		return -1;
+
+	if (uev_file_init(ctx, w, fd)) {
+		free(l);
+		return -1;
+	}
+
+	l->ctx = ctx;
+	l->w   = w;
+	l->off = st.st_size;
+	l->next   = ctx->logs;
+	ctx->logs = l;
+	w->u.lg.l = l;
+
+	return 0;
+}
+
+/**
+ * Append a record to a log
+ * @param w    Log watcher, from uev_log_init()
+ * @param rec  Record, copied
+ * @param len  Length of @param rec
+ * @param cb   Durability callback, called with the offset of the record
+ * @param arg  Optional callback argument
+ *
+ * @param cb is called from the event loop when the record is on disk,
+ * in the order records were appended.  Should a write fail, @param cb
+ * is called with -1 and errno set, for this and all following records.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error,
+ * %ENOBUFS if more than %UEV_LOG_MAX bytes are waiting.
+ */
+int uev_log_append(uev_t *w, const void *rec, size_t len, uev_log_cb_t *cb, void *arg)
+{
+	struct uev_batch *b;
+	struct uev_log *l;
+
+	if (!w || !w->u.lg.l || w->type != UEV_FILE_TYPE || !rec || !len || !cb) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	l = w->u.lg.l;
+	if (l->err) {
+		errno = l->err;
+		return -1;
+	}
+
+	b = &l->b[l->fill];
+	if (b->len + len > UEV_LOG_MAX) {
+		errno = ENOBUFS;
+		return -1;
+	}
+
+	if (b->len + len > b->size) {
+		size_t size = b->size ? b->size : LOG_BATCH;
+		char *buf;
+
+		while (size < b->len + len)
+			size *= 2;
+
+		buf = realloc(b->buf, size);
+		if (!buf)
+			return -1;
+
+		b->buf  = buf;
+		b->size = size;
+	}
+
+	if (b->num == b->max) {
+		size_t max = b->max ? b->max * 2 : 64;
+		struct uev_rec *r;
+
+		r = realloc(b->rec, max * sizeof(*r));
+		if (!r)
+			return -1;
+
+		b->rec = r;
+		b->max = max;
+	}
+
+	b->rec[b->num].cb  = cb;
+	b->rec[b->num].arg = arg;
+	b->rec[b->num].pos = b->len;
+	memcpy(b->buf + b->len, rec, len);
+	b->len += len;
+	b->num++;
+
+	if (seal(l)) {
+		b->len -= len;
+		b->num--;
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Stop a log
+ * @param w  Log watcher, from uev_log_init()
+ *
+ * Records not yet on disk are dropped, without calling back.  A write
+ * in flight completes in the background.  The descriptor is left to the
+ * application.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_log_stop(uev_t *w)
+{
+	struct uev_log *l;
+
+	if (!w || !w->u.lg.l || w->type != UEV_FILE_TYPE) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	l = w->u.lg.l;
+	w->u.lg.l = NULL;
+
+	dequeue(l);
+
+	/* Write in flight, or calling back */
+	l->stopped = 1;
+	if (l->busy || l->delivering)
+		return 0;
+	log_free(l);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,228 @@
+/* libuEv - Micro event loop library
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "uev.h"
+
+#define UNUSED(arg) arg __attribute__ ((unused))
+
+/* Clients each keep one record in flight, like requests waiting to commit */
+static int backend = -1, clients = 32;
+static long records = 10000, appended, committed, failed;
+static size_t size = 128;
+static double latency;
+static char *rec;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double blocking(int fd)
+{
+	double start, t;
+	long i;
+
+	start = now();
+	for (i = 0; i < records; i++) {
+		t = now();
+		if (write(fd, rec, size) != (ssize_t)size || fdatasync(fd))
+			failed++;
+		latency += now() - t;
+	}
+
+	return now() - start;
+}
+
+static void append(uev_t *w, double *t);
+
+static void durable_cb(uev_t *w, void *arg, off_t off)
+{
+	double *t = arg;
+
+	if (off < 0)
+		failed++;
+	latency += now() - *t;
+	committed++;
+
+	append(w, t);
+}
+
+static void append(uev_t *w, double *t)
+{
+	if (appended >= records)
+		return;
+
+	*t = now();
+	if (uev_log_append(w, rec, size, durable_cb, t)) {
+		perror("uev_log_append");
+		exit(1);
+	}
+	appended++;
+}
+
+static double async(int fd)
+{
+	double start, *t;
+	uev_ctx_t ctx;
+	uev_t w;
+	int i;
+
+	uev_init(&ctx);
+	backend = uev_file_backend(&ctx, backend);
+	if (backend < 0) {
+		perror("uev_file_backend");
+		exit(1);
+	}
+	if (uev_log_init(&ctx, &w, fd)) {
+		perror("uev_log_init");
+		exit(1);
+	}
+
+	t = calloc(clients, sizeof(*t));
+	if (!t) {
+		perror("calloc");
+		exit(1);
+	}
+
+	start = now();
+	for (i = 0; i < clients; i++)
+		append(&w, &t[i]);
+	uev_run(&ctx, 0);
+	start = now() - start;
+
+	uev_exit(&ctx);
+	free(t);
+
+	return start;
+}
+
+static int usage(int rc)
+{
+	fprintf(stderr,
+		"Usage: logbench [-bhtu] [-c CLIENTS] [-f FILE] [-n RECORDS] [-s BYTES]\n"
+		"  -b          Inline write() and fdatasync() per record, the default is uev_log_append()\n"
+		"  -c CLIENTS  Number of records in flight, default 32\n"
+		"  -f FILE     Log file, truncated, default logbench.dat\n"
+		"  -n RECORDS  Number of records, default 10000\n"
+		"  -s BYTES    Record size, default 128\n"
+		"  -t          Force thread pool backend\n"
+		"  -u          Force io_uring backend\n");
+	return rc;
+}
+
+int main(int argc, char **argv)
+{
+	const char *file = "logbench.dat", *mode;
+	double sec;
+	int c, fd;
+
+	while ((c = getopt(argc, argv, "bc:f:hn:s:tu")) != -1) {
+		switch (c) {
+		case 'b':
+			backend = -2;
+			break;
+
+		case 'c':
+			clients = atoi(optarg);
+			break;
+
+		case 'f':
+			file = optarg;
+			break;
+
+		case 'h':
+			return usage(0);
+
+		case 'n':
+			records = atol(optarg);
+			break;
+
+		case 's':
+			size = atol(optarg);
+			break;
+
+		case 't':
+			backend = UEV_FILE_THREADS;
+			break;
+
+		case 'u':
+			backend = UEV_FILE_URING;
+			break;
+
+		default:
+			return usage(1);
+		}
+	}
+
+	if (clients < 1 || records < 1 || size < 1)
+		return usage(1);
+
+	rec = malloc(size);
+	if (!rec) {
+		perror("malloc");
+		return 1;
+	}
+	memset(rec, 'x', size);
+	rec[size - 1] = '\n';
+
+	fd = open(file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		perror("open");
+		return 1;
+	}
+
+	if (backend == -2) {
+		mode = "blocking";
+		clients = 1;
+		sec = blocking(fd);
+	} else {
+		if (backend < 0)
+			backend = UEV_FILE_AUTO;
+		sec = async(fd);
+		mode = backend == UEV_FILE_URING ? "io_uring" : "threads";
+	}
+	close(fd);
+	free(rec);
+
+	printf("%-8s clients %-4d %10.0f records/s %8.3f ms latency %6ld errors\n", mode,
+	       clients, records / sec, latency / records * 1000, failed);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
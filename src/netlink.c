@@ -0,0 +1,175 @@
+/* libuEv - Micro event loop library
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <string.h>		/* memset() */
+#include <sys/socket.h>
+#include <linux/netlink.h>
+
+#include "uev.h"
+
+
+/* Kernel dropped messages, e.g. route flood, app must resync its state */
+static void resync_cb(uev_t *w, void *arg, int events)
+{
+	if (w->u.nl.resync)
+		w->u.nl.resync(w, arg, events);
+	else
+		w->u.nl.cb(w, arg, UEV_ERROR, NULL);
+}
+
+/* Walk all messages of one datagram, in place, without copying */
+static int walk(uev_t *w, void *arg, int events, void *buf, int len)
+{
+	struct nlmsghdr *nlh;
+
+	for (nlh = buf; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+		if (nlh->nlmsg_type == NLMSG_NOOP)
+			continue;
+
+		if (nlh->nlmsg_type == NLMSG_OVERRUN)
+			return 1;
+
+		w->u.nl.cb(w, arg, events, nlh);
+
+		/* Callback may have stopped us, or the event loop */
+		if (!_uev_is_active(w) || !w->ctx->running)
+			break;
+	}
+
+	return 0;
+}
+
+static void netlink_cb(uev_t *w, void *arg, int events)
+{
+	char buf[UEV_NETLINK_VLEN][UEV_NETLINK_BUFSZ];
+	struct mmsghdr msg[UEV_NETLINK_VLEN];
+	struct iovec iov[UEV_NETLINK_VLEN];
+	int i, num, overrun = 0;
+
+	if (events & UEV_ERROR) {
+		socklen_t len = sizeof(int);
+		int err = 0;
+
+		/* Reading SO_ERROR also clears it */
+		if (!getsockopt(w->fd, SOL_SOCKET, SO_ERROR, &err, &len) && err == ENOBUFS) {
+			uev_io_start(w);
+			resync_cb(w, arg, UEV_READ);
+			return;
+		}
+
+		w->u.nl.cb(w, arg, events, NULL);
+		return;
+	}
+
+	if (events & UEV_HUP) {
+		w->u.nl.cb(w, arg, events, NULL);
+		return;
+	}
+
+	memset(msg, 0, sizeof(msg));
+	for (i = 0; i < UEV_NETLINK_VLEN; i++) {
+		iov[i].iov_base = buf[i];
+		iov[i].iov_len  = sizeof(buf[i]);
+		msg[i].msg_hdr.msg_iov    = &iov[i];
+		msg[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	num = recvmmsg(w->fd, msg, UEV_NETLINK_VLEN, MSG_DONTWAIT, NULL);
+	if (num < 0) {
+		if (errno == EAGAIN || errno == EINTR)
+			return;
+
+		if (errno == ENOBUFS) {
+			resync_cb(w, arg, UEV_READ);
+			return;
+		}
+
+		w->u.nl.cb(w, arg, UEV_ERROR, NULL);
+		return;
+	}
+
+	for (i = 0; i < num; i++) {
+		/* A truncated datagram means lost messages */
+		if (msg[i].msg_hdr.msg_flags & MSG_TRUNC)
+			overrun = 1;
+
+		if (walk(w, arg, events, buf[i], msg[i].msg_len))
+			overrun = 1;
+
+		if (!_uev_is_active(w) || !w->ctx->running)
+			return;
+	}
+
+	if (overrun)
+		resync_cb(w, arg, UEV_READ);
+}
+
+/* Private to libuEv, do not use directly! */
+int _uev_netlink_owns(uev_t *w)
+{
+	return w && w->cb == netlink_cb;
+}
+
+/**
+ * Create a netlink watcher
+ * @param ctx     A valid libuEv context
+ * @param w       Pointer to an uev_t watcher
+ * @param cb      Netlink callback, called once per received message
+ * @param resync  Optional callback for when the kernel has dropped messages
+ * @param arg     Optional callback argument
+ * @param fd      Non-blocking netlink socket, already bound to its groups
+ *
+ * Each wakeup receives up to %UEV_NETLINK_VLEN datagrams in one call to
+ * recvmmsg() and walks all multipart messages in place.  This way a
+ * flood of, e.g., route updates is absorbed in batches.
+ *
+ * When the socket receive buffer overruns, the kernel reports %ENOBUFS.
+ * The watcher is then restarted and @param resync is called, where the
+ * application should re-dump its state.  Without @param resync, @param
+ * cb is called with %UEV_ERROR and a NULL message instead.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_netlink_init(uev_ctx_t *ctx, uev_t *w, uev_netlink_cb_t *cb, uev_cb_t *resync, void *arg, int fd)
+{
+	if (fd < 0 || !cb) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (_uev_watcher_init(ctx, w, UEV_IO_TYPE, netlink_cb, arg, fd, UEV_READ))
+		return -1;
+
+	w->u.nl.cb     = cb;
+	w->u.nl.resync = resync;
+
+	return _uev_watcher_start(w);
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
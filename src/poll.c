@@ -0,0 +1,245 @@
+/* libuEv - Micro event loop library
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>		/* realloc(), free() */
+#include <sys/epoll.h>
+#include <sys/stat.h>
+#include <unistd.h>		/* STDIN_FILENO, close() */
+
+#include "uev.h"
+
+/* Only these epoll events are also poll() events, with the same values */
+#define POLL_MASK (EPOLLIN | EPOLLPRI | EPOLLOUT | EPOLLERR | EPOLLHUP | EPOLLRDHUP)
+
+
+/* Too many watchers for poll(), or edge triggered, move to epoll for good */
+static int migrate(uev_ctx_t *ctx)
+{
+	int fd, i;
+
+	fd = epoll_create1(EPOLL_CLOEXEC);
+	if (fd < 0)
+		return -1;
+
+	for (i = 0; i < ctx->npfd; i++) {
+		struct epoll_event ev;
+		uev_t *w = ctx->pw[i];
+
+		/* A disabled one-shot watcher stays disabled */
+		ev.events   = ctx->pfd[i].fd < 0 ? 0 : ctx->pfd[i].events;
+		ev.events  |= w->events & (EPOLLET | EPOLLONESHOT);
+		ev.data.ptr = w;
+		if (epoll_ctl(fd, EPOLL_CTL_ADD, w->fd, &ev) < 0) {
+			close(fd);
+			return -1;
+		}
+		w->idx = -1;
+	}
+
+	_uev_poll_free(ctx);
+	ctx->fd      = fd;
+	ctx->backend = UEV_BACKEND_EPOLL;
+
+	return 0;
+}
+
+static int add(uev_t *w, uint32_t events)
+{
+	uev_ctx_t *ctx = w->ctx;
+
+#ifndef UEV_DISABLE_STDIN_WORKAROUND
+	/* epoll refuses regular files, keep `application < file.txt` working */
+	if (w->fd == STDIN_FILENO) {
+		struct stat st;
+
+		if (!fstat(w->fd, &st) && (S_ISREG(st.st_mode) || S_ISDIR(st.st_mode))) {
+			errno = EPERM;
+			return -1;
+		}
+	}
+#endif
+
+	if (ctx->npfd == ctx->pfdsize) {
+		int size = ctx->pfdsize ? ctx->pfdsize * 2 : 8;
+		struct pollfd *pfd;
+		uev_t **pw;
+
+		pfd = realloc(ctx->pfd, size * sizeof(*pfd));
+		if (!pfd)
+			return -1;
+		ctx->pfd = pfd;
+
+		pw = realloc(ctx->pw, size * sizeof(*pw));
+		if (!pw)
+			return -1;
+		ctx->pw = pw;
+
+		ctx->pfdsize = size;
+	}
+
+	w->idx = ctx->npfd++;
+	ctx->pfd[w->idx].fd      = w->fd;
+	ctx->pfd[w->idx].events  = events & POLL_MASK;
+	ctx->pfd[w->idx].revents = 0;
+	ctx->pw[w->idx] = w;
+
+	return 0;
+}
+
+/* Keep the array dense, move the last watcher into the hole */
+static int del(uev_t *w)
+{
+	uev_ctx_t *ctx = w->ctx;
+	int last = ctx->npfd - 1;
+
+	if (w->idx < 0 || w->idx > last || ctx->pw[w->idx] != w) {
+		errno = ENOENT;
+		return -1;
+	}
+
+	if (w->idx != last) {
+		ctx->pfd[w->idx] = ctx->pfd[last];
+		ctx->pw[w->idx]  = ctx->pw[last];
+		ctx->pw[w->idx]->idx = w->idx;
+	}
+	ctx->npfd--;
+	w->idx = -1;
+
+	return 0;
+}
+
+static int mod(uev_t *w, uint32_t events)
+{
+	uev_ctx_t *ctx = w->ctx;
+
+	if (w->idx < 0 || w->idx >= ctx->npfd || ctx->pw[w->idx] != w) {
+		errno = ENOENT;
+		return -1;
+	}
+
+	/* Also re-enables a one-shot watcher */
+	ctx->pfd[w->idx].fd     = w->fd;
+	ctx->pfd[w->idx].events = events & POLL_MASK;
+
+	return 0;
+}
+
+/* Private to libuEv, do not use directly! */
+int _uev_poll_ctl(uev_t *w, int op, uint32_t events)
+{
+	uev_ctx_t *ctx = w->ctx;
+	struct epoll_event ev;
+
+	switch (op) {
+	case EPOLL_CTL_ADD:
+		if (!ctx->automatic) {
+			if (events & EPOLLET) {
+				errno = EINVAL;
+				return -1;
+			}
+			return add(w, events);
+		}
+
+		if (ctx->npfd < UEV_POLL_MAX && !(events & EPOLLET))
+			return add(w, events);
+
+		if (migrate(ctx))
+			return -1;
+
+		ev.events   = events;
+		ev.data.ptr = w;
+		return epoll_ctl(ctx->fd, EPOLL_CTL_ADD, w->fd, &ev);
+
+	case EPOLL_CTL_DEL:
+		return del(w);
+
+	case EPOLL_CTL_MOD:
+		return mod(w, events);
+	}
+
+	errno = EINVAL;
+	return -1;
+}
+
+/* Private to libuEv, do not use directly! */
+int _uev_poll_wait(uev_ctx_t *ctx, struct epoll_event *ee, int max, int timeout)
+{
+	int i, n, num = 0, start;
+
+	n = poll(ctx->pfd, ctx->npfd, timeout);
+	if (n <= 0)
+		return n;
+
+	/* Take turns, in case more than max are ready */
+	start = ctx->pnext < ctx->npfd ? ctx->pnext : 0;
+	for (i = 0; i < ctx->npfd && num < max && n > 0; i++) {
+		int idx = (start + i) % ctx->npfd;
+		struct pollfd *pfd = &ctx->pfd[idx];
+		uev_t *w;
+
+		if (!pfd->revents)
+			continue;
+
+		/* Closed without stopping the watcher, report as error */
+		if (pfd->revents & POLLNVAL)
+			pfd->revents = (pfd->revents & ~POLLNVAL) | EPOLLERR;
+
+		n--;
+		w = ctx->pw[idx];
+		ee[num].events   = pfd->revents;
+		ee[num].data.ptr = w;
+		num++;
+
+		pfd->revents = 0;
+		if (w->events & EPOLLONESHOT)
+			pfd->fd = -1;
+	}
+	ctx->pnext = (start + i) % (ctx->npfd ? ctx->npfd : 1);
+
+	return num;
+}
+
+/* Private to libuEv, do not use directly! */
+void _uev_poll_free(uev_ctx_t *ctx)
+{
+	free(ctx->pfd);
+	free(ctx->pw);
+	ctx->pfd     = NULL;
+	ctx->pw      = NULL;
+	ctx->npfd    = 0;
+	ctx->pfdsize = 0;
+	ctx->pnext   = 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
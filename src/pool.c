@@ -0,0 +1,369 @@
+/* libuEv - Micro event loop library
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <stdlib.h>		/* malloc(), free() */
+#include <string.h>		/* memcpy(), memset() */
+#include <sys/socket.h>		/* recvmsg(), SO_TIMESTAMPNS */
+#include <unistd.h>		/* read() */
+
+#include "uev.h"
+
+/* Smallest size class, each following class is four times larger */
+#define POOL_MIN_SIZE 512
+
+
+static int size2class(size_t size)
+{
+	size_t sz = POOL_MIN_SIZE;
+	int class = 0;
+
+	while (sz < size && class < UEV_POOL_CLASSES - 1) {
+		sz <<= 2;
+		class++;
+	}
+
+	return sz < size ? -1 : class;
+}
+
+/* Private to libuEv, do not use directly! */
+void _uev_pool_free(uev_ctx_t *ctx)
+{
+	int i;
+
+	for (i = 0; i < UEV_POOL_CLASSES; i++) {
+		while (ctx->pool[i]) {
+			uev_buf_t *buf = ctx->pool[i];
+
+			ctx->pool[i] = buf->next;
+			free(buf);
+		}
+		ctx->pooled[i] = 0;
+	}
+
+	free(ctx->delay);
+	ctx->delay = NULL;
+}
+
+/**
+ * Borrow a buffer from the context's receive buffer pool
+ * @param ctx   A valid libuEv context
+ * @param size  Min. size of buffer, rounded up to the nearest size class
+ *
+ * @return A buffer, with @param len set to zero, or NULL with @param
+ * errno set on error.
+ */
+uev_buf_t *uev_buf_get(uev_ctx_t *ctx, size_t size)
+{
+	uev_buf_t *buf;
+	int class;
+
+	if (!ctx) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	class = size2class(size);
+	if (class < 0) {
+		errno = ERANGE;
+		return NULL;
+	}
+
+	buf = ctx->pool[class];
+	if (buf) {
+		ctx->pool[class] = buf->next;
+		ctx->pooled[class]--;
+	} else {
+		size_t sz = (size_t)POOL_MIN_SIZE << (2 * class);
+
+		/* Header and data in one allocation */
+		buf = malloc(sizeof(*buf) + sz);
+		if (!buf)
+			return NULL;
+
+		buf->data  = (char *)(buf + 1);
+		buf->size  = sz;
+		buf->class = class;
+	}
+
+	buf->next = NULL;
+	buf->len  = 0;
+	buf->keep = 0;
+	buf->stamp.tv_sec  = 0;
+	buf->stamp.tv_nsec = 0;
+
+	return buf;
+}
+
+/**
+ * Keep a buffer passed to a receive callback
+ * @param buf  Buffer to keep
+ *
+ * Call from the receive callback to take ownership of @param buf.  The
+ * buffer must later be returned with uev_buf_put().
+ */
+void uev_buf_keep(uev_buf_t *buf)
+{
+	if (buf)
+		buf->keep = 1;
+}
+
+/**
+ * Return a buffer to the context's receive buffer pool
+ * @param ctx  The libuEv context the buffer was borrowed from
+ * @param buf  Buffer to return
+ *
+ * At most %UEV_POOL_MAX_FREE free buffers are kept per size class, the
+ * rest are freed.  So memory use follows the number of active, not the
+ * total number of connections.
+ */
+void uev_buf_put(uev_ctx_t *ctx, uev_buf_t *buf)
+{
+	if (!buf)
+		return;
+
+	/* Also after uev_exit(), when the pool has been released */
+	if (!ctx || !ctx->backend || ctx->pooled[buf->class] >= UEV_POOL_MAX_FREE) {
+		free(buf);
+		return;
+	}
+
+	buf->next = ctx->pool[buf->class];
+	ctx->pool[buf->class] = buf;
+	ctx->pooled[buf->class]++;
+}
+
+/* Read, with the kernel's receive timestamp, see uev_recv_timestamp() */
+static ssize_t stamped(uev_t *w, uev_buf_t *buf)
+{
+	union {
+		char            buf[CMSG_SPACE(sizeof(struct timespec))];
+		struct cmsghdr  align;
+	} ctl;
+	struct iovec iov = { buf->data, w->u.rb.size };
+	struct msghdr msg = {
+		.msg_iov        = &iov,
+		.msg_iovlen     = 1,
+		.msg_control    = ctl.buf,
+		.msg_controllen = sizeof(ctl.buf),
+	};
+	struct cmsghdr *cmsg;
+	ssize_t len;
+
+	len = recvmsg(w->fd, &msg, 0);
+	if (len <= 0)
+		return len;
+
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+			memcpy(&buf->stamp, CMSG_DATA(cmsg), sizeof(buf->stamp));
+	}
+
+	return len;
+}
+
+/* Kernel receive to callback delay, in log2 microsecond buckets */
+static void delay(uev_ctx_t *ctx, const struct timespec *stamp)
+{
+	struct uev_delay *d = ctx->delay;
+	struct timespec now;
+	int64_t usec;
+	int i = 0;
+
+	if (!d || !stamp->tv_sec)
+		return;
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	usec = (int64_t)(now.tv_sec - stamp->tv_sec) * 1000000 + (now.tv_nsec - stamp->tv_nsec) / 1000;
+	if (usec < 0)
+		usec = 0;	/* Wall clock stepped back */
+
+	while (i < UEV_DELAY_BUCKETS - 1 && usec >= (int64_t)1 << i)
+		i++;
+
+	d->hist[i]++;
+	d->count++;
+	d->total += usec;
+	if ((uint64_t)usec > d->max)
+		d->max = usec;
+}
+
+/* Borrow a buffer only when there is data to read, at most the size asked for */
+static void recv_cb(uev_t *w, void *arg, int events)
+{
+	uev_buf_t *buf;
+	ssize_t len;
+
+	if (events & UEV_ERROR) {
+		w->u.rb.cb(w, arg, events, NULL);
+		return;
+	}
+
+	buf = uev_buf_get(w->ctx, w->u.rb.size);
+	if (!buf) {
+		w->u.rb.cb(w, arg, UEV_ERROR, NULL);
+		return;
+	}
+
+	if (w->u.rb.stamp)
+		len = stamped(w, buf);
+	else
+		len = read(w->fd, buf->data, w->u.rb.size);
+	if (len <= 0) {
+		uev_buf_put(w->ctx, buf);
+		if (len < 0 && (errno == EAGAIN || errno == EINTR))
+			return;
+
+		w->u.rb.cb(w, arg, len ? UEV_ERROR : events | UEV_HUP, NULL);
+		return;
+	}
+
+	buf->len = len;
+	_uev_limit_count(w, UEV_LIMIT_BYTES, len);
+	if (w->u.rb.stamp)
+		delay(w->ctx, &buf->stamp);
+	w->u.rb.cb(w, arg, events, buf);
+	if (!buf->keep)
+		uev_buf_put(w->ctx, buf);
+}
+
+/* Private to libuEv, do not use directly! */
+int _uev_recv_owns(uev_t *w)
+{
+	return w && w->cb == recv_cb;
+}
+
+/**
+ * Create a receive watcher using pooled buffers
+ * @param ctx   A valid libuEv context
+ * @param w     Pointer to an uev_t watcher
+ * @param cb    Receive callback, called with a buffer of data
+ * @param arg   Optional callback argument
+ * @param fd    Non-blocking descriptor to read from
+ * @param size  Max. number of bytes to read per wakeup
+ *
+ * Instead of each connection holding a dedicated receive buffer, one is
+ * borrowed from the context's pool only when @param fd is readable.  It
+ * is returned to the pool when @param cb returns, unless @param cb has
+ * called uev_buf_keep().  Use uev_io_start() and uev_io_stop() as for
+ * other I/O watchers.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_recv_init(uev_ctx_t *ctx, uev_t *w, uev_recv_cb_t *cb, void *arg, int fd, size_t size)
+{
+	if (fd < 0 || !cb || !size) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (size2class(size) < 0) {
+		errno = ERANGE;
+		return -1;
+	}
+
+	if (_uev_watcher_init(ctx, w, UEV_IO_TYPE, recv_cb, arg, fd, UEV_READ))
+		return -1;
+
+	w->u.rb.cb    = cb;
+	w->u.rb.size  = size;
+	w->u.rb.stamp = 0;
+
+	return _uev_watcher_start(w);
+}
+
+/**
+ * Kernel receive timestamps for a receive watcher
+ * @param w       Receive watcher, from uev_recv_init()
+ * @param enable  Non-zero to enable, zero to disable
+ *
+ * Sets %SO_TIMESTAMPNS on the socket and reads with recvmsg(), so each
+ * buffer passed to the callback has @param stamp set to the time the
+ * data arrived in the kernel, %CLOCK_REALTIME.  For stream sockets it
+ * is the time of the most recent data read.  The delay from then until
+ * the callback is called is recorded in the context's histogram, see
+ * uev_recv_delay().
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error, e.g.
+ * %ENOTSOCK for pipes.
+ */
+int uev_recv_timestamp(uev_t *w, int enable)
+{
+	int val = !!enable;
+
+	if (!w || w->cb != recv_cb) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (setsockopt(w->fd, SOL_SOCKET, SO_TIMESTAMPNS, &val, sizeof(val)))
+		return -1;
+
+	if (val && !w->ctx->delay) {
+		w->ctx->delay = calloc(1, sizeof(struct uev_delay));
+		if (!w->ctx->delay)
+			return -1;
+	}
+
+	w->u.rb.stamp = val;
+
+	return 0;
+}
+
+/**
+ * Get kernel receive to callback delays
+ * @param ctx    A valid libuEv context
+ * @param d      Histogram to fill in
+ * @param reset  Non-zero to start over after reading
+ *
+ * Covers all receive watchers in @param ctx with timestamps enabled by
+ * uev_recv_timestamp().  The delay includes time spent waiting in the
+ * socket's receive queue and in other callbacks before this one.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_recv_delay(uev_ctx_t *ctx, uev_delay_t *d, int reset)
+{
+	if (!ctx || !d) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (!ctx->delay) {
+		memset(d, 0, sizeof(*d));
+		return 0;
+	}
+
+	memcpy(d, ctx->delay, sizeof(*d));
+	if (reset)
+		memset(ctx->delay, 0, sizeof(*ctx->delay));
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
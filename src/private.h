@@ -26,25 +26,113 @@
 #define LIBUEV_PRIVATE_H_
 
 #include <stdio.h>
+#include <time.h>
 #include <sys/epoll.h>
+#include <sys/socket.h>	       /* socklen_t */
+#include <netinet/in.h>	       /* struct in_addr, in6_addr */
 #include "queue.h"	       /* OpenBSD queue.h > old GLIBC version */
 
-/* I/O, timer, or signal watcher */
+/* Forward declaration, see <linux/netlink.h> */
+struct nlmsghdr;
+struct uev_buf;
+struct uev_aio;
+struct uev_bufring;
+struct uev_limiter;
+struct uev_rl;
+struct uev_tail;
+struct uev_tailer;
+struct uev_frame;
+struct uev_connector;
+struct uev_dns;
+struct uev_handoff;
+struct uev_delay;
+struct uev_spawn;
+struct uev_log;
+struct uev_fibers;
+struct uev_scratch;
+struct pollfd;
+
+/* Receive buffer pool size classes: 512, 2k, 8k, 32k, 128k */
+#define UEV_POOL_CLASSES 5
+
+/* Event loop backend, zero when closed */
+#define UEV_BACKEND_EPOLL 1
+#define UEV_BACKEND_POLL  2
+
+/* I/O, timer, signal, file, or ring receive watcher */
 typedef enum {
 	UEV_IO_TYPE = 1,
 	UEV_SIGNAL_TYPE,
 	UEV_TIMER_TYPE,
 	UEV_CRON_TYPE,
+	UEV_FILE_TYPE,
+	UEV_RING_TYPE,
+	UEV_TAIL_TYPE,
 } uev_type_t;
 
 /* Event mask, used internally only. */
 #define UEV_EVENT_MASK  (UEV_ERROR | UEV_READ | UEV_WRITE | UEV_PRI | UEV_HUP | UEV_RDHUP | UEV_EDGE | UEV_ONESHOT)
 
+/* Output queue for uev_io_write(), allocated on first use */
+struct uev_oq {
+	char           *buf;
+	size_t          len;
+	size_t          size;
+	int             hold;    /* -1: disabled, 0: end of iteration, or msec */
+	int             queued;  /* On context flush list */
+	int             blocked; /* Waiting for EPOLLOUT to flush remainder */
+	struct timespec since;   /* When the oldest queued byte was written */
+	LIST_ENTRY(uev) link;
+};
+
+/* Zero-copy send request, waiting for completion from the kernel */
+struct uev_zc_req {
+	void           *buf;
+	size_t          len;
+	void          (*cb)(struct uev *, void *, void *, size_t);
+	void           *arg;
+	uint32_t        id;      /* Kernel id, unless copied */
+	int             copied;
+	int             done;
+};
+
+/* Zero-copy send tracking for uev_io_send_zc(), allocated on first use */
+struct uev_zc {
+	int             enabled; /* SO_ZEROCOPY set and kernel did not copy */
+	uint32_t        next;    /* Kernel id of next zero-copy send */
+	size_t          num;
+	size_t          size;
+	struct uev_zc_req *req;
+};
+
 /* Main libuEv context type */
 typedef struct {
 	int             running;
-	int             fd;     /* For epoll() */
+	int             backend;
+	int             fd;     /* For epoll(), -1 with poll() backend */
 	LIST_HEAD(,uev) watchers;
+	LIST_HEAD(,uev) flushq; /* I/O watchers with coalesced output */
+	struct uev_buf *pool[UEV_POOL_CLASSES]; /* Free receive buffers */
+	unsigned int    pooled[UEV_POOL_CLASSES];
+	struct uev_delay *delay; /* Receive timestamp delays, histogram */
+	struct uev_aio *aio;    /* Asynchronous file I/O, io_uring */
+	struct uev_bufring *br; /* Provided buffers for ring receive */
+	struct uev_limiter *lim; /* Rate limited I/O watchers, paused */
+	struct uev_tailer *tail; /* Tail watchers, shared inotify */
+	struct uev_connector *conn; /* Connects and idle connection pool */
+	int             handoff; /* Handoff channels with output pending */
+	struct uev_log *logs;   /* Append logs, group commit */
+	int             logq;   /* Logs with a batch to write */
+	struct uev_fibers *fib; /* Fibers, running and pooled */
+	struct uev_scratch *scratch; /* Arena, reset every iteration */
+
+	/* poll() backend, dense array of descriptors, watcher per entry */
+	struct pollfd  *pfd;
+	struct uev    **pw;
+	int             npfd, pfdsize;
+	int             pnext;  /* Where to start looking for events */
+	int             automatic; /* Move to epoll() when outgrown */
+	int             lazy;   /* Watchers added to epoll at first uev_run() */
 	uint32_t        workaround; /* For workarounds, e.g. redirected stdin */
 } uev_ctx_t;
 
@@ -75,8 +163,98 @@ struct uev;
 			int timeout;				\
 			int period;				\
 		} t;						\
+								\
+		/* Input device watchers, batched callback */	\
+		struct {					\
+			void (*cb)(struct uev *, void *, int,	\
+				   void *, size_t);		\
+			int proto;				\
+		} in;						\
+								\
+		/* Netlink watchers, called per message */	\
+		struct {					\
+			void (*cb)(struct uev *, void *, int,	\
+				   struct nlmsghdr *);		\
+			void (*resync)(struct uev *, void *, int); \
+		} nl;						\
+								\
+		/* Receive watchers, pooled buffer callback */	\
+		struct {					\
+			void (*cb)(struct uev *, void *, int,	\
+				   struct uev_buf *);		\
+			size_t size;				\
+			int stamp;	/* Kernel timestamps */	\
+		} rb;						\
+								\
+		/* Ring receive watchers, io_uring multishot */	\
+		struct {					\
+			void (*cb)(struct uev *, void *, int,	\
+				   int, size_t);		\
+			int slot;				\
+		} rr;						\
+								\
+		/* Tail watchers, batches of complete lines */	\
+		struct {					\
+			void (*cb)(struct uev *, void *, int,	\
+				   const char *, size_t);	\
+			struct uev_tail *t;			\
+		} tl;						\
+								\
+		/* Frame watchers, length prefixed messages */	\
+		struct {					\
+			void (*cb)(struct uev *, void *, int,	\
+				   struct uev_buf *);		\
+			struct uev_frame *f;			\
+			int hdrlen;				\
+			unsigned int max;			\
+		} fr;						\
+								\
+		/* Connect watchers, connect in progress */	\
+		struct {					\
+			void (*cb)(struct uev *, void *, int,	\
+				   int);				\
+			uint64_t due;				\
+			int err;				\
+			int pos;	/* In timeout heap, or -1 */	\
+		} cn;						\
+								\
+		/* DNS resolvers, queries and answer cache */	\
+		struct {					\
+			struct uev_dns *r;			\
+		} dn;						\
+								\
+		/* Handoff channels, descriptors to a peer */	\
+		struct {					\
+			void (*cb)(struct uev *, void *, int,	\
+				   int);			\
+			struct uev_handoff *h;			\
+		} ho;						\
+								\
+		/* Spawned children, exit and stdio pipes */	\
+		struct {					\
+			void (*cb)(struct uev *, void *, int,	\
+				   int, const char *, size_t); \
+			struct uev_spawn *s;			\
+			int pid;				\
+			int status;				\
+		} sp;						\
+								\
+		/* Append logs, on a file watcher */		\
+		struct {					\
+			struct uev_log *l;			\
+		} lg;						\
 	} u;							\
 								\
+	/* I/O watchers, queued output for uev_io_write() */	\
+	struct uev_oq  *oq;					\
+	struct uev_zc  *zc;					\
+	struct uev_rl  *rl;	/* Rate limit, token bucket */	\
+	int             lowat;	/* uev_io_lowat() limit */	\
+	int             lowait;	/* Edge triggered, waiting */	\
+								\
+	/* Index in pollfd array, with poll() backend */	\
+	int             idx;					\
+								\
 	/* Watcher type */					\
 	uev_type_t
 
@@ -89,6 +267,94 @@ int _uev_watcher_stop  (struct uev *w);
 int _uev_watcher_active(struct uev *w);
 int _uev_watcher_rearm (struct uev *w);
 
+/* Internal API for the poll() backend, same ops as epoll_ctl() */
+int _uev_poll_ctl      (struct uev *w, int op, uint32_t events);
+int _uev_poll_wait     (uev_ctx_t *ctx, struct epoll_event *ee, int max, int timeout);
+void _uev_poll_free    (uev_ctx_t *ctx);
+
+/* Internal API for coalesced I/O watcher output */
+int _uev_io_flush      (struct uev *w);
+void _uev_io_flush_all (uev_ctx_t *ctx);
+void _uev_io_free      (struct uev *w);
+void _uev_io_release   (struct uev *w);
+int _uev_io_end        (struct uev *w);
+int _uev_io_zc_reap    (struct uev *w);
+void _uev_io_zc_free   (struct uev *w);
+
+/* Internal API for the receive buffer pool */
+int _uev_recv_owns     (struct uev *w);
+void _uev_pool_free    (uev_ctx_t *ctx);
+
+/* Internal API for input device and netlink watchers */
+int _uev_input_owns    (struct uev *w);
+int _uev_netlink_owns  (struct uev *w);
+
+/* Internal API for the scratch arena */
+void _uev_scratch_reset(uev_ctx_t *ctx);
+void _uev_scratch_free (uev_ctx_t *ctx);
+
+/* Internal API for asynchronous file I/O */
+void _uev_file_submit  (uev_ctx_t *ctx);
+void _uev_file_free    (uev_ctx_t *ctx);
+int _uev_file_owns     (struct uev *w);
+int _uev_file_hold     (uev_ctx_t *ctx, int delta);
+int _uev_file_write_dsync(struct uev *w, const void *buf, size_t len, off_t off,
+			  void (*cb)(struct uev *, void *, void *, ssize_t), void *arg);
+
+/* Internal API for rate limited I/O watchers */
+void _uev_limit_tick   (uev_ctx_t *ctx);
+int _uev_limit_paused  (struct uev *w);
+int _uev_limit_owns    (struct uev *w);
+void _uev_limit_count  (struct uev *w, int unit, size_t num);
+void _uev_limit_pause  (struct uev *w);
+void _uev_limit_resume (struct uev *w);
+void _uev_limit_free   (struct uev *w);
+void _uev_limit_exit   (uev_ctx_t *ctx);
+
+/* Internal API for tail watchers */
+int _uev_tail_owns     (struct uev *w);
+void _uev_tail_free    (uev_ctx_t *ctx);
+
+/* Internal API for frame watchers */
+int _uev_frame_owns    (struct uev *w);
+void _uev_frame_free   (struct uev *w);
+
+/* Internal API for outbound connects */
+int _uev_conn_owns     (struct uev *w);
+void _uev_conn_exit    (uev_ctx_t *ctx);
+
+/* Internal API for DNS resolvers */
+int _uev_dns_owns      (struct uev *w);
+void _uev_dns_exit     (uev_ctx_t *ctx);
+
+/* Internal API for descriptor handoff channels */
+int _uev_handoff_owns  (struct uev *w);
+void _uev_handoff_flush(uev_ctx_t *ctx);
+void _uev_handoff_pause(struct uev *w);
+void _uev_handoff_resume(struct uev *w);
+void _uev_handoff_free (struct uev *w);
+
+/* Internal API for spawned children */
+int _uev_spawn_owns    (struct uev *w);
+void _uev_spawn_exit   (uev_ctx_t *ctx);
+
+/* Internal API for append logs */
+void _uev_log_submit   (uev_ctx_t *ctx);
+void _uev_log_exit     (uev_ctx_t *ctx);
+
+/* Internal API for fibers */
+int _uev_fiber_owns    (struct uev *w);
+void _uev_fiber_reap   (uev_ctx_t *ctx);
+void _uev_fiber_exit   (uev_ctx_t *ctx);
+
+/* Internal API for io_uring, shared with ring receive watchers */
+int _uev_uring_fd      (uev_ctx_t *ctx);
+int _uev_uring_recv    (uev_ctx_t *ctx, int fd, uint64_t ud, int cancel);
+void _uev_uring_hold   (uev_ctx_t *ctx, int delta);
+void _uev_ring_recv_done(uev_ctx_t *ctx, uint64_t ud, int res, unsigned int flags);
+void _uev_ring_flush   (uev_ctx_t *ctx);
+void _uev_ring_free    (uev_ctx_t *ctx);
+
 #endif /* LIBUEV_PRIVATE_H_ */
 
 /**
@@ -0,0 +1,487 @@
+/* libuEv - Micro event loop library
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <stdint.h>		/* UINT32_MAX */
+#include <stdlib.h>		/* calloc(), realloc(), free() */
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+
+#include "uev.h"
+
+/* Multishot receive state, per watcher slot */
+#define SLOT_ARMED   1
+#define SLOT_STARVED 2	/* Ended with ENOBUFS, re-armed when buffers return */
+
+#define SLOT2UD(slot) (((uint64_t)(slot) << 1) | 1)
+#define UD2SLOT(ud)   ((int)((ud) >> 1))
+
+/*
+ * The kernel refers to a watcher by slot, the slot is only released on
+ * the final completion.  So a stopped watcher can be reused, or freed,
+ * while its receive is being cancelled.
+ */
+struct slot {
+	uev_t          *w;
+	int             state;
+	int             next;	/* Free list */
+};
+
+/* Provided buffer ring, shared by all ring receive watchers in a context */
+struct uev_bufring {
+	struct io_uring_buf_ring *ring;
+	size_t          ring_len;
+	char           *mem;
+	size_t          size;
+	unsigned int    num;
+	uint16_t        tail;
+	unsigned int    added;	/* Given back since last published */
+	unsigned char  *kept;
+	unsigned int    nkept;
+
+	struct slot    *slot;
+	int             nslots;
+	int             free;
+	int             starved;
+};
+
+
+static void give(struct uev_bufring *b, int bid)
+{
+	struct io_uring_buf *buf = &b->ring->bufs[b->tail & (b->num - 1)];
+
+	buf->addr = (uintptr_t)(b->mem + (size_t)bid * b->size);
+	buf->len  = b->size;
+	buf->bid  = bid;
+	b->tail++;
+	b->added++;
+}
+
+static int slot_get(struct uev_bufring *b)
+{
+	int i;
+
+	if (b->free < 0) {
+		int num = b->nslots ? b->nslots * 2 : 64;
+		struct slot *slot;
+
+		slot = realloc(b->slot, num * sizeof(*slot));
+		if (!slot)
+			return -1;
+
+		for (i = num - 1; i >= b->nslots; i--) {
+			slot[i].w     = NULL;
+			slot[i].state = 0;
+			slot[i].next  = b->free;
+			b->free = i;
+		}
+		b->slot   = slot;
+		b->nslots = num;
+	}
+
+	i = b->free;
+	b->free = b->slot[i].next;
+
+	return i;
+}
+
+static void slot_put(struct uev_bufring *b, int i)
+{
+	b->slot[i].w     = NULL;
+	b->slot[i].state = 0;
+	b->slot[i].next  = b->free;
+	b->free = i;
+}
+
+static int arm(uev_t *w)
+{
+	struct uev_bufring *b = w->ctx->br;
+	int i = w->u.rr.slot;
+
+	if (_uev_uring_recv(w->ctx, w->fd, SLOT2UD(i), 0))
+		return -1;
+	b->slot[i].state = SLOT_ARMED;
+
+	return 0;
+}
+
+/* Watcher done, drop its hold on the event loop */
+static void release(uev_ctx_t *ctx, int i)
+{
+	slot_put(ctx->br, i);
+	_uev_uring_hold(ctx, -1);
+}
+
+/* Private to libuEv, do not use directly! */
+void _uev_ring_recv_done(uev_ctx_t *ctx, uint64_t ud, int res, unsigned int flags)
+{
+	struct uev_bufring *b = ctx->br;
+	int i = UD2SLOT(ud), bid = -1;
+	uev_t *w;
+
+	if (!b || i >= b->nslots)
+		return;
+
+	w = b->slot[i].w;
+	if (flags & IORING_CQE_F_BUFFER)
+		bid = flags >> IORING_CQE_BUFFER_SHIFT;
+
+	if (bid >= 0) {
+		if (w && res > 0) {
+			w->u.rr.cb(w, w->arg, UEV_READ, bid, res);
+
+			/* Callback may have called uev_exit() or stopped w */
+			if (ctx->br != b)
+				return;
+			w = b->slot[i].w;
+		}
+
+		if (!b->kept[bid])
+			give(b, bid);
+	}
+
+	if (flags & IORING_CQE_F_MORE)
+		return;
+
+	/* Multishot receive has ended, stopped watchers are done now */
+	b->slot[i].state = 0;
+	if (!w) {
+		release(ctx, i);
+		return;
+	}
+
+	/* Out of buffers, wait for some to be given back */
+	if (res == -ENOBUFS) {
+		b->slot[i].state = SLOT_STARVED;
+		b->starved++;
+		return;
+	}
+
+	/* Ended by the kernel, e.g. on CQ overflow, just continue */
+	if (res > 0 && !arm(w))
+		return;
+
+	w->active = 0;
+	release(ctx, i);
+
+	errno = res < 0 ? -res : errno;
+	w->u.rr.cb(w, w->arg, res ? UEV_ERROR : UEV_HUP, -1, 0);
+}
+
+/* Private to libuEv, do not use directly! */
+void _uev_ring_flush(uev_ctx_t *ctx)
+{
+	struct uev_bufring *b = ctx->br;
+	int i;
+
+	if (!b)
+		return;
+
+	if (b->added) {
+		__atomic_store_n(&b->ring->tail, b->tail, __ATOMIC_RELEASE);
+		b->added = 0;
+	}
+
+	/* Starvation is rare, a scan is cheaper than tracking it */
+	if (!b->starved || b->nkept == b->num)
+		return;
+
+	for (i = 0; i < b->nslots && b->starved; i++) {
+		uev_t *w = b->slot[i].w;
+
+		if (b->slot[i].state != SLOT_STARVED)
+			continue;
+
+		b->slot[i].state = 0;
+		b->starved--;
+		if (arm(w)) {
+			w->active = 0;
+			release(ctx, i);
+			w->u.rr.cb(w, w->arg, UEV_ERROR, -1, 0);
+			if (ctx->br != b)
+				return;
+		}
+	}
+}
+
+/* Private to libuEv, do not use directly! */
+void _uev_ring_free(uev_ctx_t *ctx)
+{
+	struct uev_bufring *b = ctx->br;
+	int i;
+
+	if (!b)
+		return;
+
+	/* Called after the ring is closed, nothing is in flight */
+	for (i = 0; i < b->nslots; i++) {
+		if (b->slot[i].w)
+			b->slot[i].w->active = 0;
+	}
+
+	ctx->br = NULL;
+	munmap(b->ring, b->ring_len);
+	free(b->slot);
+	free(b->kept);
+	free(b->mem);
+	free(b);
+}
+
+/**
+ * Set up the provided buffer ring for ring receive watchers
+ * @param ctx   A valid libuEv context
+ * @param num   Number of buffers, a power of two, max 32768
+ * @param size  Size of each buffer
+ *
+ * Optional, call before the first uev_ring_recv_init() to override the
+ * default of %UEV_BUFRING_NUM buffers of %UEV_BUFRING_SIZE bytes.  The
+ * buffers are shared by all watchers, the kernel picks one only when
+ * data arrives on a socket.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_bufring_init(uev_ctx_t *ctx, unsigned int num, size_t size)
+{
+	struct io_uring_buf_reg reg = { 0 };
+	struct uev_bufring *b;
+	long pgsz = sysconf(_SC_PAGESIZE);
+	unsigned int i;
+	int fd;
+
+	if (!ctx || !ctx->backend || !num || num > 32768 || (num & (num - 1)) || !size || size > UINT32_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (ctx->br) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	fd = _uev_uring_fd(ctx);
+	if (fd < 0)
+		return -1;
+
+	b = calloc(1, sizeof(*b));
+	if (!b)
+		return -1;
+
+	b->num  = num;
+	b->size = size;
+	b->free = -1;
+	b->ring_len = (num * sizeof(struct io_uring_buf) + pgsz - 1) & ~(pgsz - 1);
+	b->ring = mmap(NULL, b->ring_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (b->ring == MAP_FAILED)
+		goto fail;
+
+	b->mem  = malloc(num * size);
+	b->kept = calloc(num, 1);
+	if (!b->mem || !b->kept)
+		goto fail_ring;
+
+	/* Buffer group zero, kernel 5.19 */
+	reg.ring_addr    = (uintptr_t)b->ring;
+	reg.ring_entries = num;
+	reg.bgid         = 0;
+	if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PBUF_RING, &reg, 1))
+		goto fail_ring;
+
+	for (i = 0; i < num; i++)
+		give(b, i);
+
+	ctx->br = b;
+	_uev_ring_flush(ctx);
+
+	return 0;
+
+fail_ring:
+	munmap(b->ring, b->ring_len);
+fail:
+	free(b->kept);
+	free(b->mem);
+	free(b);
+	return -1;
+}
+
+/**
+ * Get provided buffer data
+ * @param ctx  A valid libuEv context
+ * @param bid  Buffer id, from a ring receive callback
+ *
+ * @return Pointer to buffer, or NULL with @param errno set on error.
+ */
+void *uev_bufring_data(uev_ctx_t *ctx, int bid)
+{
+	if (!ctx || !ctx->br || bid < 0 || (unsigned int)bid >= ctx->br->num) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	return ctx->br->mem + (size_t)bid * ctx->br->size;
+}
+
+/**
+ * Keep a provided buffer passed to a ring receive callback
+ * @param ctx  A valid libuEv context
+ * @param bid  Buffer id, from a ring receive callback
+ *
+ * The buffer must later be given back with uev_bufring_put().  While
+ * kept it cannot be used for receiving, when all buffers are kept the
+ * ring receive watchers wait until one is given back.
+ */
+void uev_bufring_keep(uev_ctx_t *ctx, int bid)
+{
+	struct uev_bufring *b;
+
+	if (!uev_bufring_data(ctx, bid))
+		return;
+
+	b = ctx->br;
+	if (!b->kept[bid]) {
+		b->kept[bid] = 1;
+		b->nkept++;
+	}
+}
+
+/**
+ * Give a kept buffer back to the kernel
+ * @param ctx  A valid libuEv context
+ * @param bid  Buffer id, from uev_bufring_keep()
+ */
+void uev_bufring_put(uev_ctx_t *ctx, int bid)
+{
+	struct uev_bufring *b;
+
+	if (!uev_bufring_data(ctx, bid))
+		return;
+
+	b = ctx->br;
+	if (!b->kept[bid])
+		return;
+
+	b->kept[bid] = 0;
+	b->nkept--;
+	give(b, bid);
+
+	/* Not called back from a completion batch, publish now */
+	_uev_ring_flush(ctx);
+}
+
+/**
+ * Create a completion-based receive watcher, using io_uring
+ * @param ctx  A valid libuEv context
+ * @param w    Pointer to an uev_t watcher
+ * @param cb   Receive callback, called with a buffer id and length
+ * @param arg  Optional callback argument
+ * @param fd   Connected socket
+ *
+ * Instead of waiting for @param fd to be readable and then calling
+ * read(), a multishot receive is armed once and the kernel completes it
+ * with data in a buffer from the context's provided buffer ring.  The
+ * buffers are shared by all watchers, so idle sockets hold no memory.
+ * Buffers are given back to the kernel in one batch per wakeup.
+ *
+ * Requires kernel 6.0, or later.  Fails with ENOSYS when io_uring is
+ * not available, use uev_recv_init() then.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_ring_recv_init(uev_ctx_t *ctx, uev_t *w, uev_ring_recv_cb_t *cb, void *arg, int fd)
+{
+	int i;
+
+	if (fd < 0 || !cb) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (_uev_watcher_init(ctx, w, UEV_RING_TYPE, NULL, arg, fd, UEV_READ))
+		return -1;
+
+	if (!ctx->br && uev_bufring_init(ctx, UEV_BUFRING_NUM, UEV_BUFRING_SIZE))
+		return -1;
+
+	i = slot_get(ctx->br);
+	if (i < 0)
+		return -1;
+
+	ctx->br->slot[i].w = w;
+	w->u.rr.cb   = cb;
+	w->u.rr.slot = i;
+	if (arm(w)) {
+		slot_put(ctx->br, i);
+		return -1;
+	}
+
+	w->active = 1;
+	_uev_uring_hold(ctx, 1);
+
+	return 0;
+}
+
+/**
+ * Stop a ring receive watcher
+ * @param w  Watcher to stop
+ *
+ * The receive is cancelled asynchronously, data already received is not
+ * passed to the callback.  Note: buffers kept by the callback must still
+ * be given back with uev_bufring_put().
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_ring_recv_stop(uev_t *w)
+{
+	struct uev_bufring *b;
+	int i;
+
+	if (!w) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (!_uev_is_active(w))
+		return 0;
+
+	b = w->ctx->br;
+	i = w->u.rr.slot;
+	w->active = 0;
+	b->slot[i].w = NULL;
+
+	if (b->slot[i].state == SLOT_STARVED) {
+		b->starved--;
+		release(w->ctx, i);
+		return 0;
+	}
+
+	/* The final completion releases the slot */
+	return _uev_uring_recv(w->ctx, w->fd, SLOT2UD(i), 1);
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,221 @@
+/* libuEv - Scratch arena, reset every loop iteration
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdlib.h>		/* malloc(), free() */
+#include <string.h>		/* memcpy(), memset() */
+
+#include "uev.h"
+
+#ifdef __SANITIZE_ADDRESS__
+#include <sanitizer/asan_interface.h>
+#else
+#define ASAN_POISON_MEMORY_REGION(addr, size)   ((void)(addr), (void)(size))
+#define ASAN_UNPOISON_MEMORY_REGION(addr, size) ((void)(addr), (void)(size))
+#endif
+
+/* All allocations are aligned for any type */
+#define ALIGN 16
+
+/* Poison patterns with --enable-scratch-debug, freed and fresh memory */
+#define POISON_FREE 0xdb
+#define POISON_NEW  0xa5
+
+struct uev_chunk {
+	struct uev_chunk *next;
+	size_t          size;
+	size_t          used;
+	char            data[] __attribute__ ((aligned(ALIGN)));
+};
+
+/* Current chunk first, older ones only until the next reset */
+struct uev_scratch {
+	struct uev_chunk *head;
+	size_t          total;	/* Size of all chunks */
+};
+
+static struct uev_chunk *chunk(struct uev_scratch *s, size_t size)
+{
+	struct uev_chunk *c;
+
+	c = malloc(sizeof(*c) + size);
+	if (!c)
+		return NULL;
+
+	c->size = size;
+	c->used = 0;
+	ASAN_POISON_MEMORY_REGION(c->data, size);
+
+	c->next  = s->head;
+	s->head  = c;
+	s->total += size;
+
+	return c;
+}
+
+static void chunks_free(struct uev_scratch *s)
+{
+	while (s->head) {
+		struct uev_chunk *c = s->head;
+
+		s->head = c->next;
+		ASAN_UNPOISON_MEMORY_REGION(c->data, c->size);
+		free(c);
+	}
+	s->total = 0;
+}
+
+/*
+ * Private to libuEv, do not use directly!  Before the loop waits.  An
+ * iteration that needed more than one chunk leaves one chunk of the
+ * same total size, so the next one does not have to call malloc().
+ */
+void _uev_scratch_reset(uev_ctx_t *ctx)
+{
+	struct uev_scratch *s = ctx->scratch;
+	size_t total;
+
+	if (!s || !s->head || (!s->head->used && !s->head->next))
+		return;
+
+	if (s->head->next) {
+		total = s->total;
+		chunks_free(s);
+		chunk(s, total);	/* Or try again on the next call */
+		return;
+	}
+
+#ifdef UEV_SCRATCH_DEBUG
+	memset(s->head->data, POISON_FREE, s->head->used);
+#endif
+	ASAN_POISON_MEMORY_REGION(s->head->data, s->head->used);
+	s->head->used = 0;
+}
+
+/* Private to libuEv, do not use directly! */
+void _uev_scratch_free(uev_ctx_t *ctx)
+{
+	struct uev_scratch *s = ctx->scratch;
+
+	if (!s)
+		return;
+
+	chunks_free(s);
+	free(s);
+	ctx->scratch = NULL;
+}
+
+/**
+ * Allocate temporary memory from the context's scratch arena
+ * @param ctx   A valid libuEv context
+ * @param size  Number of bytes
+ *
+ * Memory is valid until the event loop next waits for events, i.e.,
+ * for the rest of the current callback and the ones after it in the
+ * same loop iteration.  It is then reclaimed all at once, there is no
+ * free.  Use uev_scratch_keep() for anything that must live longer.
+ * With uev_poll() memory is valid until the next call.  Everything is
+ * freed by uev_exit().
+ *
+ * @return Pointer to @param size bytes, aligned for any type, or %NULL
+ * with @param errno set on error.
+ */
+void *uev_scratch(uev_ctx_t *ctx, size_t size)
+{
+	struct uev_scratch *s;
+	struct uev_chunk *c;
+	void *ptr;
+
+	if (!ctx || !ctx->backend || !size || size > (size_t)-1 / 2) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	s = ctx->scratch;
+	if (!s) {
+		s = calloc(1, sizeof(*s));
+		if (!s)
+			return NULL;
+		ctx->scratch = s;
+	}
+
+	size = (size + ALIGN - 1) & ~(size_t)(ALIGN - 1);
+	c = s->head;
+	if (!c || c->used + size > c->size) {
+		size_t next = UEV_SCRATCH_SIZE;
+
+		if (c && c->size * 2 > next)
+			next = c->size * 2;
+		if (size > next)
+			next = size;
+
+		c = chunk(s, next);
+		if (!c)
+			return NULL;
+	}
+
+	ptr = c->data + c->used;
+	c->used += size;
+
+	ASAN_UNPOISON_MEMORY_REGION(ptr, size);
+#ifdef UEV_SCRATCH_DEBUG
+	memset(ptr, POISON_NEW, size);
+#endif
+
+	return ptr;
+}
+
+/**
+ * Keep scratch memory past the current loop iteration
+ * @param ptr   Memory from uev_scratch(), or part of it
+ * @param size  Number of bytes to keep
+ *
+ * Copies @param size bytes from @param ptr to memory that lives until
+ * the application calls free() on it.
+ *
+ * @return Pointer to the copy, or %NULL with @param errno set on error.
+ */
+void *uev_scratch_keep(const void *ptr, size_t size)
+{
+	void *copy;
+
+	if (!ptr || !size) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	copy = malloc(size);
+	if (!copy)
+		return NULL;
+
+	return memcpy(copy, ptr, size);
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
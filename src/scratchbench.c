@@ -0,0 +1,152 @@
+/* libuEv - Micro event loop library
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "uev.h"
+
+#define UNUSED(arg) arg __attribute__ ((unused))
+
+/* Temporary objects per event, sizes like a parsed request */
+static const size_t sizes[] = { 64, 256, 32, 1024, 128, 48, 512, 96 };
+
+static long total = 1000000, served;
+static int allocs = 16, heap;
+static double spent;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void cb(uev_t *w, void *UNUSED(arg), int UNUSED(events))
+{
+	void *obj[256];
+	int i, n = 0;
+	double start;
+
+	start = now();
+	/* Served once per loop iteration, the eventfd is always readable */
+	for (i = 0; i < allocs; i++) {
+		size_t size = sizes[i % (sizeof(sizes) / sizeof(sizes[0]))];
+		char *p;
+
+		p = heap ? malloc(size) : uev_scratch(w->ctx, size);
+		if (!p) {
+			perror("alloc");
+			exit(1);
+		}
+		memset(p, i, 16);
+		if (n < 256)
+			obj[n++] = p;
+	}
+
+	if (heap) {
+		for (i = 0; i < n; i++)
+			free(obj[i]);
+	}
+	spent += now() - start;
+
+	if (++served == total)
+		uev_exit(w->ctx);
+}
+
+static int usage(int rc)
+{
+	fprintf(stderr,
+		"Usage: scratchbench [-hm] [-a ALLOCS] [-n EVENTS]\n"
+		"  -a ALLOCS  Temporary allocations per event, max 256, default 16\n"
+		"  -h         This help text\n"
+		"  -m         Use malloc() and free(), the default is uev_scratch()\n"
+		"  -n EVENTS  Number of events, default 1000000\n");
+	return rc;
+}
+
+int main(int argc, char **argv)
+{
+	uev_ctx_t ctx;
+	double sec;
+	uev_t w;
+	int c, fd;
+
+	while ((c = getopt(argc, argv, "a:hmn:")) != -1) {
+		switch (c) {
+		case 'a':
+			allocs = atoi(optarg);
+			break;
+
+		case 'h':
+			return usage(0);
+
+		case 'm':
+			heap = 1;
+			break;
+
+		case 'n':
+			total = atol(optarg);
+			break;
+
+		default:
+			return usage(1);
+		}
+	}
+
+	if (allocs < 0 || allocs > 256 || total < 1)
+		return usage(1);
+
+	fd = eventfd(1, EFD_NONBLOCK);
+	if (fd < 0) {
+		perror("eventfd");
+		return 1;
+	}
+
+	uev_init(&ctx);
+	uev_io_init(&ctx, &w, cb, NULL, fd, UEV_READ);
+
+	sec = now();
+	uev_run(&ctx, 0);
+	sec = now() - sec;
+	close(fd);
+
+	/* Allocator cost, measured in the callback, apart from the loop */
+	printf("%-7s allocs %-3d %10.0f events/s %8.1f ns/event in callback %6.1f ns/alloc\n",
+	       heap ? "malloc" : "scratch", allocs, served / sec, spent * 1e9 / served,
+	       allocs ? spent * 1e9 / served / allocs : 0);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
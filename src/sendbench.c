@@ -0,0 +1,300 @@
+/* Bulk send benchmark, regular send() vs MSG_ZEROCOPY
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "uev.h"
+
+#define UNUSED(arg) arg __attribute__ ((unused))
+#define NUM_BUFS 8
+
+static int zerocopy, port = 5201, wakeups;
+static size_t chunk = 256 * 1024, rsize = 1024 * 1024, lowat;
+static long long total = 4096LL * 1024 * 1024, sent;
+static char *addr = "127.0.0.1";
+static char *bufs[NUM_BUFS];
+static int busy[NUM_BUFS], head;
+static uev_t writer;
+
+static void done_cb(uev_t *w, void *UNUSED(arg), void *buf, size_t UNUSED(len))
+{
+	int i;
+
+	for (i = 0; i < NUM_BUFS; i++) {
+		if (bufs[i] == buf)
+			busy[i] = 0;
+	}
+
+	/* Buffers available again, resume sending */
+	if (!(w->events & UEV_WRITE) && sent < total)
+		uev_io_set(w, w->fd, UEV_WRITE);
+}
+
+static void write_cb(uev_t *w, void *UNUSED(arg), int events)
+{
+	ssize_t num;
+
+	wakeups++;
+	if (events & (UEV_ERROR | UEV_HUP)) {
+		uev_exit(w->ctx);
+		return;
+	}
+
+	while (sent < total) {
+		if (busy[head]) {
+			/* All buffers owned by the kernel, wait for completions */
+			uev_io_set(w, w->fd, UEV_NONE);
+			return;
+		}
+
+		/* Completion may be called before uev_io_send_zc() returns */
+		if (zerocopy) {
+			busy[head] = 1;
+			num = uev_io_send_zc(w, bufs[head], chunk, done_cb, NULL);
+		} else {
+			num = send(w->fd, bufs[head], chunk, MSG_DONTWAIT);
+		}
+		if (num < 0) {
+			busy[head] = 0;
+			return;	/* EAGAIN */
+		}
+
+		head = (head + 1) % NUM_BUFS;
+		sent += num;
+	}
+
+	uev_exit(w->ctx);
+}
+
+static int drain(int sd)
+{
+	static char buf[1024 * 1024];
+
+	while (read(sd, buf, rsize < sizeof(buf) ? rsize : sizeof(buf)) > 0)
+		;
+
+	return 0;
+}
+
+static int reader(void)
+{
+	struct sockaddr_in sin = { .sin_family = AF_INET };
+	int sd;
+
+	sin.sin_port = htons(port);
+	inet_pton(AF_INET, addr, &sin.sin_addr);
+
+	sd = socket(AF_INET, SOCK_STREAM, 0);
+	while (connect(sd, (struct sockaddr *)&sin, sizeof(sin)))
+		usleep(10000);
+
+	return drain(sd);
+}
+
+static int stream(int sd, const char *type)
+{
+	struct timeval start, end;
+	struct rusage ru;
+	uev_ctx_t ctx;
+	double sec, cpu;
+	int i;
+
+	for (i = 0; i < NUM_BUFS; i++) {
+		bufs[i] = malloc(chunk);
+		memset(bufs[i], 'a' + i, chunk);
+	}
+
+	uev_init(&ctx);
+	uev_io_init(&ctx, &writer, write_cb, NULL, sd, UEV_WRITE);
+	if (lowat && uev_io_lowat(&writer, lowat)) {
+		perror("uev_io_lowat");
+		return 1;
+	}
+
+	gettimeofday(&start, NULL);
+	uev_run(&ctx, 0);
+	gettimeofday(&end, NULL);
+	close(sd);
+
+	getrusage(RUSAGE_SELF, &ru);
+	timersub(&end, &start, &end);
+	sec = end.tv_sec + end.tv_usec / 1e6;
+	cpu = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+	printf("%-4s %-8s %8zu %8zu lowat %10.1f MB/s %8.2f s CPU %8.2f ms CPU/GB %8.1f wakeups/MB\n",
+	       type, zerocopy ? "zerocopy" : "copy", chunk, lowat, sent / sec / 1e6, cpu,
+	       cpu * 1e3 / (sent / 1e9), wakeups / (sent / 1e6));
+
+	return 0;
+}
+
+static int server(void)
+{
+	struct sockaddr_in sin = { .sin_family = AF_INET };
+	int lsd, sd, on = 1;
+
+	sin.sin_port = htons(port);
+	inet_pton(AF_INET, addr, &sin.sin_addr);
+
+	lsd = socket(AF_INET, SOCK_STREAM, 0);
+	setsockopt(lsd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	if (bind(lsd, (struct sockaddr *)&sin, sizeof(sin)) || listen(lsd, 1)) {
+		perror("bind");
+		return 1;
+	}
+
+	sd = accept4(lsd, NULL, NULL, SOCK_NONBLOCK);
+	if (sd < 0) {
+		perror("accept");
+		return 1;
+	}
+
+	return stream(sd, "tcp");
+}
+
+/* Reader and writer over a UNIX socket pair, send queue tracked in user space */
+static int local(void)
+{
+	pid_t pid;
+	int sv[2];
+	int rc;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv)) {
+		perror("socketpair");
+		return 1;
+	}
+
+	pid = fork();
+	if (!pid) {
+		close(sv[0]);
+		return drain(sv[1]);
+	}
+
+	close(sv[1]);
+	fcntl(sv[0], F_SETFL, O_NONBLOCK);
+	rc = stream(sv[0], "unix");
+	waitpid(pid, NULL, 0);
+
+	return rc;
+}
+
+static int usage(int rc)
+{
+	fprintf(stderr,
+		"Usage: sendbench [-hruwz] [-a ADDR] [-b BYTES] [-l BYTES] [-p PORT] [-n MB] [-s BYTES]\n"
+		"  -a ADDR   Address to listen on/connect to, default 127.0.0.1\n"
+		"  -b BYTES  Size of each read in the reader, default 1048576\n"
+		"  -l BYTES  Writable threshold, uev_io_lowat(), default off\n"
+		"  -n MB     Total MiB to send, default 4096\n"
+		"  -p PORT   Port number, default 5201\n"
+		"  -r        Reader only, e.g. in another network namespace\n"
+		"  -s BYTES  Size of each send, default 262144\n"
+		"  -u        Send over a UNIX socket pair instead of TCP\n"
+		"  -w        Writer only, wait for a reader to connect\n"
+		"  -z        Use uev_io_send_zc(), MSG_ZEROCOPY\n");
+	return rc;
+}
+
+int main(int argc, char **argv)
+{
+	int c, mode = 0;
+	pid_t pid;
+
+	while ((c = getopt(argc, argv, "a:b:hl:n:p:rs:uwz")) != -1) {
+		switch (c) {
+		case 'a':
+			addr = optarg;
+			break;
+
+		case 'b':
+			rsize = atol(optarg);
+			break;
+
+		case 'h':
+			return usage(0);
+
+		case 'l':
+			lowat = atol(optarg);
+			break;
+
+		case 'n':
+			total = atoll(optarg) * 1024 * 1024;
+			break;
+
+		case 'p':
+			port = atoi(optarg);
+			break;
+
+		case 'r':
+		case 'u':
+		case 'w':
+			mode = c;
+			break;
+
+		case 's':
+			chunk = atol(optarg);
+			break;
+
+		case 'z':
+			zerocopy = 1;
+			break;
+
+		default:
+			return usage(1);
+		}
+	}
+
+	if (mode == 'r')
+		return reader();
+	if (mode == 'u')
+		return local();
+	if (mode == 'w')
+		return server();
+
+	pid = fork();
+	if (!pid)
+		return reader();
+
+	c = server();
+	waitpid(pid, NULL, 0);
+
+	return c;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,420 @@
+/* libuEv - Spawn child processes, stdio pipes and exit as watchers
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>		/* F_SETPIPE_SZ, O_NONBLOCK */
+#include <signal.h>
+#include <spawn.h>
+#include <stdlib.h>		/* calloc(), free() */
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "uev.h"
+
+#define UNUSED(arg) arg __attribute__ ((unused))
+
+extern char **environ;
+
+/* Output pipes and child, each counted in @open until done */
+struct uev_spawn {
+	uev_t           out[2];	/* stdout, stderr */
+	int             in;	/* Write end of stdin, for the application */
+	int             open;
+};
+
+static void finish(uev_t *w, struct uev_spawn *s)
+{
+	if (--s->open > 0)
+		return;
+
+	free(s);
+	w->u.sp.s = NULL;
+	w->u.sp.cb(w, w->arg, UEV_HUP, -1, NULL, 0);
+}
+
+static void output_cb(uev_t *p, void *arg, int events)
+{
+	uev_t *w = arg;
+	struct uev_spawn *s = w->u.sp.s;
+	int fd = p == &s->out[0] ? STDOUT_FILENO : STDERR_FILENO;
+	ssize_t len;
+
+	/* After a hangup the watcher is already stopped, read what is left */
+	while (1) {
+		uev_buf_t *buf = uev_buf_get(p->ctx, UEV_SPAWN_BUFSIZE);
+
+		len = -1;
+		if (buf && !(events & UEV_ERROR))
+			len = read(p->fd, buf->data, buf->size);
+		if (len <= 0) {
+			uev_buf_put(p->ctx, buf);
+			break;
+		}
+
+		w->u.sp.cb(w, w->arg, UEV_READ, fd, buf->data, len);
+		uev_buf_put(p->ctx, buf);
+
+		/* Stopped by the callback, or more next time */
+		if (w->u.sp.s != s || _uev_is_active(p))
+			return;
+	}
+
+	if (len < 0 && (errno == EAGAIN || errno == EINTR) && _uev_is_active(p))
+		return;
+
+	/* EOF, or error, this pipe is done */
+	uev_io_stop(p);
+	close(p->fd);
+	p->fd = -1;
+	finish(w, s);
+}
+
+/* The child has exited, output may still be on its way */
+static void spawn_cb(uev_t *w, void *UNUSED(arg), int UNUSED(events))
+{
+	int status;
+	pid_t pid;
+
+	pid = waitpid(w->u.sp.pid, &status, WNOHANG);
+	if (!pid)
+		return;
+
+	/* Reaped already, e.g. by a SIGCHLD handler, if -1 */
+	_uev_watcher_stop(w);
+	close(w->fd);
+	w->fd = -1;
+	w->u.sp.status = pid > 0 ? status : -1;
+
+	finish(w, w->u.sp.s);
+}
+
+/* Parent's end of a pipe for @child_fd, non-blocking, child's end CLOEXEC */
+static int plumb(posix_spawn_file_actions_t *fa, int child_fd, int *parent)
+{
+	int fds[2], mine, theirs, size = UEV_SPAWN_BUFSIZE;
+
+	if (pipe2(fds, O_CLOEXEC))
+		return -1;
+
+	mine   = child_fd == STDIN_FILENO ? fds[1] : fds[0];
+	theirs = child_fd == STDIN_FILENO ? fds[0] : fds[1];
+
+	/* Best effort, fewer and larger reads */
+	if (child_fd != STDIN_FILENO)
+		fcntl(mine, F_SETPIPE_SZ, size);
+
+	if (fcntl(mine, F_SETFL, O_NONBLOCK) || posix_spawn_file_actions_adddup2(fa, theirs, child_fd)) {
+		close(mine);
+		close(theirs);
+		return -1;
+	}
+
+	/* Closed in the parent after the spawn */
+	*parent = mine;
+	return theirs;
+}
+
+/* Private to libuEv, do not use directly! */
+int _uev_spawn_owns(uev_t *w)
+{
+	return w && (w->cb == spawn_cb || w->cb == output_cb);
+}
+
+/* Private to libuEv, do not use directly! */
+void _uev_spawn_exit(uev_ctx_t *ctx)
+{
+	uev_t *w;
+
+	do {
+		LIST_FOREACH(w, &ctx->watchers, link) {
+			if (w->cb == output_cb) {
+				w = w->arg;
+				break;
+			}
+			if (w->cb == spawn_cb)
+				break;
+		}
+	} while (w && !uev_spawn_stop(w));
+}
+
+/**
+ * Spawn a child process
+ * @param ctx    A valid libuEv context
+ * @param w      Pointer to an uev_t watcher
+ * @param cb     Output and exit callback
+ * @param arg    Optional callback argument
+ * @param argv   Program and arguments, NULL terminated
+ * @param envp   Environment, NULL terminated, or NULL to inherit
+ * @param flags  Mask of %UEV_SPAWN_STDIN, %UEV_SPAWN_STDOUT,
+ *               %UEV_SPAWN_STDERR, and %UEV_SPAWN_PATH, or zero
+ *
+ * Starts @param argv[0] with posix_spawn(), which uses vfork() semantics
+ * instead of copying the page tables of the parent, so the cost does
+ * not grow with the size of the parent process.  The child's signal
+ * mask and dispositions are reset, and all descriptors above stderr are
+ * closed in the child, with close_range() when the C library supports
+ * it, otherwise only those with %FD_CLOEXEC set.
+ *
+ * With %UEV_SPAWN_STDOUT and %UEV_SPAWN_STDERR the child's output is
+ * read from pipes in up to %UEV_SPAWN_BUFSIZE at a time and passed to
+ * @param cb with %UEV_READ and @param fd 1 or 2.  Otherwise they are
+ * inherited.  With %UEV_SPAWN_STDIN, see uev_spawn_stdin(), otherwise
+ * stdin is /dev/null.
+ *
+ * Exit is watched with a pidfd, Linux 5.3, and the child reaped.  When
+ * it has exited and all output has been delivered @param cb is called
+ * with %UEV_HUP and @param fd -1, see uev_spawn_status().
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error, e.g.
+ * %ENOENT if the program is not found.
+ */
+int uev_spawn(uev_ctx_t *ctx, uev_t *w, uev_spawn_cb_t *cb, void *arg,
+	      char *const argv[], char *const envp[], int flags)
+{
+	posix_spawn_file_actions_t fa;
+	posix_spawnattr_t attr;
+	struct uev_spawn *s;
+	int child[3] = { -1, -1, -1 };
+	int parent[3] = { -1, -1, -1 };
+	int i, err = 0, pidfd = -1;
+	sigset_t set;
+	pid_t pid;
+
+	if (!ctx || !w || !cb || !argv || !argv[0] ||
+	    (flags & ~(UEV_SPAWN_STDIN | UEV_SPAWN_STDOUT | UEV_SPAWN_STDERR | UEV_SPAWN_PATH))) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	s = calloc(1, sizeof(*s));
+	if (!s)
+		return -1;
+
+	posix_spawn_file_actions_init(&fa);
+	posix_spawnattr_init(&attr);
+
+	sigemptyset(&set);
+	posix_spawnattr_setsigmask(&attr, &set);
+	sigfillset(&set);
+	posix_spawnattr_setsigdefault(&attr, &set);
+	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+	for (i = 0; i < 3 && !err; i++) {
+		int flag = i == 0 ? UEV_SPAWN_STDIN : i == 1 ? UEV_SPAWN_STDOUT : UEV_SPAWN_STDERR;
+
+		if (flags & flag) {
+			child[i] = plumb(&fa, i, &parent[i]);
+			if (child[i] < 0)
+				err = errno;
+		} else if (i == 0) {
+			err = posix_spawn_file_actions_addopen(&fa, 0, "/dev/null", O_RDONLY, 0);
+		}
+	}
+#ifdef HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP
+	if (!err)
+		err = posix_spawn_file_actions_addclosefrom_np(&fa, 3);
+#endif
+
+	if (!err) {
+		if (flags & UEV_SPAWN_PATH)
+			err = posix_spawnp(&pid, argv[0], &fa, &attr, argv, envp ? envp : environ);
+		else
+			err = posix_spawn(&pid, argv[0], &fa, &attr, argv, envp ? envp : environ);
+	}
+
+	posix_spawn_file_actions_destroy(&fa);
+	posix_spawnattr_destroy(&attr);
+	for (i = 0; i < 3; i++) {
+		if (child[i] >= 0)
+			close(child[i]);
+	}
+
+	if (!err) {
+		pidfd = syscall(__NR_pidfd_open, pid, 0);
+		if (pidfd < 0) {
+			/* Cannot watch it, do not leave it behind */
+			err = errno;
+			kill(pid, SIGKILL);
+			waitpid(pid, NULL, 0);
+		}
+	}
+
+	if (err) {
+		for (i = 0; i < 3; i++) {
+			if (parent[i] >= 0)
+				close(parent[i]);
+		}
+		free(s);
+		errno = err;
+		return -1;
+	}
+
+	_uev_watcher_init(ctx, w, UEV_IO_TYPE, spawn_cb, arg, pidfd, UEV_READ);
+	w->u.sp.cb     = cb;
+	w->u.sp.s      = s;
+	w->u.sp.pid    = pid;
+	w->u.sp.status = -1;
+	s->in          = parent[0];
+	s->out[0].fd   = -1;
+	s->out[1].fd   = -1;
+	s->open        = 1;	/* The child */
+
+	if (_uev_watcher_start(w))
+		err = errno;
+
+	for (i = 1; i < 3 && !err; i++) {
+		if (parent[i] < 0)
+			continue;
+
+		/* Owned by the output watcher from here on */
+		s->out[i - 1].fd = parent[i];
+		if (uev_io_init(ctx, &s->out[i - 1], output_cb, w, parent[i], UEV_READ))
+			err = errno;
+		else
+			s->open++;
+	}
+
+	if (err) {
+		if (parent[0] >= 0)
+			close(parent[0]);
+		uev_spawn_kill(w, SIGKILL);
+		waitpid(pid, NULL, 0);
+		uev_spawn_stop(w);
+		errno = err;
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Write end of a spawned child's stdin
+ * @param w  Spawn watcher, from uev_spawn() with %UEV_SPAWN_STDIN
+ *
+ * The descriptor is non-blocking, and owned by the application, which
+ * closes it to signal end of input to the child.  Use an I/O watcher for
+ * %UEV_WRITE to feed the child more than the pipe can hold.
+ *
+ * @return Descriptor, or -1 with @param errno set on error.
+ */
+int uev_spawn_stdin(uev_t *w)
+{
+	if (!w || w->cb != spawn_cb || !w->u.sp.s || w->u.sp.s->in < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return w->u.sp.s->in;
+}
+
+/**
+ * Send a signal to a spawned child
+ * @param w      Spawn watcher, from uev_spawn()
+ * @param signo  Signal to send
+ *
+ * Uses the pidfd, so it can never reach another process that happens to
+ * have reused the PID.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error, %ESRCH
+ * if the child has already exited.
+ */
+int uev_spawn_kill(uev_t *w, int signo)
+{
+	if (!w || w->cb != spawn_cb) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (w->fd < 0) {
+		errno = ESRCH;
+		return -1;
+	}
+
+	return syscall(__NR_pidfd_send_signal, w->fd, signo, NULL, 0);
+}
+
+/**
+ * Exit status of a spawned child
+ * @param w  Spawn watcher, from uev_spawn()
+ *
+ * @return Wait status, use WIFEXITED() et al., or -1 if the child has
+ * not been reaped.
+ */
+int uev_spawn_status(uev_t *w)
+{
+	if (!w || w->cb != spawn_cb)
+		return -1;
+
+	return w->u.sp.status;
+}
+
+/**
+ * Stop watching a spawned child
+ * @param w  Spawn watcher, from uev_spawn()
+ *
+ * Closes the output pipes and the pidfd, without calling back.  The child
+ * is neither signaled nor reaped, see uev_spawn_kill().  The write end
+ * of stdin is left to the application.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_spawn_stop(uev_t *w)
+{
+	struct uev_spawn *s;
+	int i;
+
+	if (!w || w->cb != spawn_cb) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	s = w->u.sp.s;
+	if (s) {
+		for (i = 0; i < 2; i++) {
+			if (s->out[i].fd < 0)
+				continue;
+			uev_io_stop(&s->out[i]);
+			close(s->out[i].fd);
+		}
+		free(s);
+		w->u.sp.s = NULL;
+	}
+
+	if (w->fd >= 0) {
+		_uev_watcher_stop(w);
+		close(w->fd);
+		w->fd = -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,167 @@
+/* Spawn benchmark, uev_spawn() vs. fork() and exec() from a large process
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "uev.h"
+
+#define UNUSED(arg) arg __attribute__ ((unused))
+
+static int total = 2000, flags, done;
+static size_t mbytes = 512;
+static char *argv_true[] = { "/bin/true", NULL };
+
+static void spawn_cb(uev_t *w, void *UNUSED(arg), int events, int UNUSED(fd),
+		     const char *UNUSED(buf), size_t UNUSED(len))
+{
+	if (!(events & UEV_HUP))
+		return;
+
+	if (++done == total) {
+		uev_exit(w->ctx);
+		return;
+	}
+
+	if (uev_spawn(w->ctx, w, spawn_cb, NULL, argv_true, NULL, flags)) {
+		perror("uev_spawn");
+		uev_exit(w->ctx);
+	}
+}
+
+static double elapsed(struct timeval *start)
+{
+	struct timeval end;
+
+	gettimeofday(&end, NULL);
+	timersub(&end, start, &end);
+
+	return end.tv_sec + end.tv_usec / 1e6;
+}
+
+static void spawn(void)
+{
+	struct timeval start;
+	uev_ctx_t ctx;
+	uev_t w;
+	double sec;
+
+	done = 0;
+	gettimeofday(&start, NULL);
+	uev_init(&ctx);
+	if (uev_spawn(&ctx, &w, spawn_cb, NULL, argv_true, NULL, flags)) {
+		perror("uev_spawn");
+		return;
+	}
+	uev_run(&ctx, 0);
+	sec = elapsed(&start);
+
+	printf("uev_spawn  %6zu MB %8.0f spawns/s %8.1f us/spawn\n", mbytes, done / sec, sec * 1e6 / done);
+}
+
+static void forkexec(void)
+{
+	struct timeval start;
+	double sec;
+	int i;
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < total; i++) {
+		pid_t pid = fork();
+
+		if (!pid) {
+			execv(argv_true[0], argv_true);
+			_exit(127);
+		}
+		waitpid(pid, NULL, 0);
+	}
+	sec = elapsed(&start);
+
+	printf("fork+exec  %6zu MB %8.0f spawns/s %8.1f us/spawn\n", mbytes, total / sec, sec * 1e6 / total);
+}
+
+static int usage(int rc)
+{
+	fprintf(stderr,
+		"Usage: spawnbench [-ho] [-m MB] [-n NUM]\n"
+		"  -m MB   Memory touched by the parent before spawning, default 512\n"
+		"  -n NUM  Number of children, one at a time, default 2000\n"
+		"  -o      Read stdout of children from a pipe, uev_spawn() only\n");
+	return rc;
+}
+
+int main(int argc, char **argv)
+{
+	char *mem;
+	int c;
+
+	while ((c = getopt(argc, argv, "hm:n:o")) != -1) {
+		switch (c) {
+		case 'h':
+			return usage(0);
+
+		case 'm':
+			mbytes = atol(optarg);
+			break;
+
+		case 'n':
+			total = atoi(optarg);
+			break;
+
+		case 'o':
+			flags |= UEV_SPAWN_STDOUT;
+			break;
+
+		default:
+			return usage(1);
+		}
+	}
+
+	if (total < 1)
+		return usage(1);
+
+	/* A large parent, fork() copies its page tables */
+	mem = malloc(mbytes * 1024 * 1024 + 1);
+	if (!mem) {
+		perror("malloc");
+		return 1;
+	}
+	memset(mem, 1, mbytes * 1024 * 1024);
+
+	spawn();
+	forkexec();
+	free(mem);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,559 @@
+/* libuEv - Micro event loop library
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>		/* open() */
+#include <limits.h>		/* NAME_MAX */
+#include <stdlib.h>		/* malloc(), realloc(), free() */
+#include <string.h>		/* memchr(), memrchr(), strdup() */
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>		/* pread(), close() */
+
+#include "uev.h"
+
+#define FILE_MASK (IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF)
+#define DIR_MASK  (IN_CREATE | IN_MOVED_TO)
+
+/* Max. number of batches read from one file per wakeup */
+#define BATCHES   16
+
+#define UNUSED(arg) arg __attribute__ ((unused))
+
+/* Followed file, one per tail watcher */
+struct uev_tail {
+	uev_t          *w;
+	char           *path;
+	const char     *name;	/* Basename of @path, for directory events */
+	int             fd;	/* Current file, or -1 while waiting for it */
+	off_t           off;	/* Next byte to read */
+	dev_t           dev;
+	ino_t           ino;
+	int             wd;	/* Watch on the file */
+	int             dwd;	/* Watch on the directory, for rotation */
+	int             more;	/* Not read to end of file, see kick_cb() */
+	char           *carry;	/* Partial line from last read */
+	size_t          clen;
+	size_t          csize;
+	struct uev_tail *next;	/* On context list */
+};
+
+/* One inotify instance and read buffer for all tail watchers in a context */
+struct uev_tailer {
+	uev_t           w;
+	uev_t           kick;	/* Continue reading files with more data */
+	int             fd;
+	char           *buf;
+	unsigned int    gen;	/* Changed when a tail watcher is stopped */
+	struct uev_tail *list;
+};
+
+static void kick_cb(uev_t *w, void *arg, int events);
+
+/* Call back with lines, returns non-zero if the watcher was stopped */
+static int emit(struct uev_tailer *tl, struct uev_tail *t, const char *lines, size_t len)
+{
+	uev_ctx_t *ctx = t->w->ctx;
+	unsigned int gen = tl->gen;
+
+	t->w->u.tl.cb(t->w, t->w->arg, UEV_READ, lines, len);
+
+	/* Callback may have stopped this or another watcher, or uev_exit() */
+	return ctx->tail != tl || tl->gen != gen;
+}
+
+/* Read the rest on the next loop iteration, after other events */
+static void later(struct uev_tailer *tl, struct uev_tail *t)
+{
+	t->more = 1;
+	if (uev_timer_active(&tl->kick))
+		uev_timer_set(&tl->kick, 1, 0);
+	else
+		uev_timer_init(tl->w.ctx, &tl->kick, kick_cb, tl, 1, 0);
+}
+
+/*
+ * Read new data, in %UEV_TAIL_BUFSIZE batches, and deliver complete
+ * lines.  The partial line at the end is carried over to the next read.
+ * After @max batches the rest is read on the next loop iteration, with
+ * @max zero everything is read to end of file.  Returns non-zero if a
+ * callback stopped a watcher.
+ */
+static int drain(struct uev_tailer *tl, struct uev_tail *t, int max)
+{
+	int i;
+
+	t->more = 0;
+	for (i = 0; t->fd >= 0; i++) {
+		size_t len = t->clen;
+		ssize_t num;
+		char *end;
+
+		if (max && i == max) {
+			later(tl, t);
+			return 0;
+		}
+
+		/* A line longer than the buffer is split */
+		if (len == UEV_TAIL_BUFSIZE) {
+			t->clen = 0;
+			if (emit(tl, t, t->carry, len))
+				return 1;
+			len = 0;
+		}
+
+		memcpy(tl->buf, t->carry, len);
+		num = pread(t->fd, tl->buf + len, UEV_TAIL_BUFSIZE - len, t->off);
+		if (num <= 0)
+			return 0;
+
+		t->off += num;
+		len    += num;
+
+		/* Everything up to and including the last newline */
+		t->clen = 0;
+		end = memrchr(tl->buf, '\n', len);
+		if (end) {
+			size_t n = end - tl->buf + 1;
+
+			if (emit(tl, t, tl->buf, n))
+				return 1;
+
+			memmove(tl->buf, tl->buf + n, len - n);
+			len -= n;
+		}
+
+		if (len > t->csize) {
+			char *carry = realloc(t->carry, len);
+
+			if (!carry)
+				return 0;
+			t->carry = carry;
+			t->csize = len;
+		}
+		memcpy(t->carry, tl->buf, len);
+		t->clen = len;
+	}
+
+	return 0;
+}
+
+/* Remove watch, unless another tail watcher uses the same one */
+static void unwatch(struct uev_tailer *tl, struct uev_tail *t, int wd)
+{
+	struct uev_tail *o;
+
+	if (wd < 0)
+		return;
+
+	for (o = tl->list; o; o = o->next) {
+		if (o != t && (o->wd == wd || o->dwd == wd))
+			return;
+	}
+
+	inotify_rm_watch(tl->fd, wd);
+}
+
+/* Open, or reopen after rotation, the file at @t->path */
+static void reopen(struct uev_tailer *tl, struct uev_tail *t, int end)
+{
+	struct stat st;
+
+	unwatch(tl, t, t->wd);
+	t->wd = -1;
+	if (t->fd >= 0)
+		close(t->fd);
+
+	t->off  = 0;
+	t->clen = 0;
+	t->fd   = open(t->path, O_RDONLY | O_CLOEXEC);
+	t->w->fd = t->fd;
+	if (t->fd < 0)
+		return;		/* Wait for it to be created */
+
+	if (fstat(t->fd, &st)) {
+		close(t->fd);
+		t->fd = t->w->fd = -1;
+		return;
+	}
+
+	t->dev = st.st_dev;
+	t->ino = st.st_ino;
+	if (end)
+		t->off = st.st_size;
+
+	t->wd = inotify_add_watch(tl->fd, t->path, FILE_MASK);
+}
+
+/* A new file at the path, not the one we follow? */
+static int replaced(struct uev_tail *t)
+{
+	struct stat st;
+
+	if (stat(t->path, &st))
+		return 0;
+
+	return t->fd < 0 || st.st_dev != t->dev || st.st_ino != t->ino;
+}
+
+static int truncated(struct uev_tail *t)
+{
+	struct stat st;
+
+	if (t->fd < 0 || fstat(t->fd, &st))
+		return 0;
+
+	return st.st_size < t->off;
+}
+
+/*
+ * Deliver what is left of the old file, then follow the new one.  The
+ * old file is read to the end at once, it cannot be reopened later.
+ */
+static int rotate(struct uev_tailer *tl, struct uev_tail *t)
+{
+	if (drain(tl, t, 0))
+		return 1;
+
+	/* Last line of the old file, even without newline */
+	if (t->clen) {
+		size_t len = t->clen;
+
+		t->clen = 0;
+		if (emit(tl, t, t->carry, len))
+			return 1;
+	}
+
+	reopen(tl, t, 0);
+
+	return drain(tl, t, BATCHES);
+}
+
+/* Handle one event for one tail watcher, non-zero if a watcher was stopped */
+static int handle(struct uev_tailer *tl, struct uev_tail *t, struct inotify_event *ev)
+{
+	/* Queue overflow, check all files */
+	if (ev->mask & IN_Q_OVERFLOW) {
+		if (replaced(t))
+			return rotate(tl, t);
+		return drain(tl, t, BATCHES);
+	}
+
+	if (t->wd >= 0 && ev->wd == t->wd) {
+		/* Renamed or removed, rotate when a new file shows up */
+		if (replaced(t))
+			return rotate(tl, t);
+
+		if (truncated(t)) {
+			t->off  = 0;
+			t->clen = 0;
+		}
+
+		return drain(tl, t, BATCHES);
+	}
+
+	if (ev->wd == t->dwd && ev->len && !strcmp(ev->name, t->name)) {
+		if (replaced(t))
+			return rotate(tl, t);
+	}
+
+	return 0;
+}
+
+static void inotify_cb(uev_t *w, void *arg, int events)
+{
+	char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	struct uev_tailer *tl = arg;
+	uev_ctx_t *ctx = w->ctx;
+	ssize_t len;
+
+	if (events & UEV_ERROR) {
+		uev_io_start(w);
+		return;
+	}
+
+	while ((len = read(tl->fd, buf, sizeof(buf))) > 0) {
+		char *ptr = buf;
+
+		while (ptr < buf + len) {
+			struct inotify_event *ev = (struct inotify_event *)ptr;
+			struct uev_tail *t;
+
+			/*
+			 * Start over if a callback stopped a watcher, handling
+			 * an event twice only finds nothing new to read.
+			 */
+		again:
+			for (t = tl->list; t; t = t->next) {
+				if (!handle(tl, t, ev))
+					continue;
+				if (ctx->tail != tl)
+					return;
+				goto again;
+			}
+
+			ptr += sizeof(*ev) + ev->len;
+		}
+	}
+}
+
+static void kick_cb(uev_t *w, void *arg, int UNUSED(events))
+{
+	struct uev_tailer *tl = arg;
+	uev_ctx_t *ctx = w->ctx;
+	struct uev_tail *t;
+
+again:
+	for (t = tl->list; t; t = t->next) {
+		if (!t->more || !drain(tl, t, BATCHES))
+			continue;
+		if (ctx->tail != tl)
+			return;
+		goto again;
+	}
+}
+
+/* Nothing left to follow, let uev_run() return */
+static void tailer_idle(struct uev_tailer *tl)
+{
+	if (tl->list)
+		return;
+
+	uev_io_stop(&tl->w);
+	uev_timer_stop(&tl->kick);
+}
+
+static struct uev_tailer *tailer(uev_ctx_t *ctx)
+{
+	struct uev_tailer *tl;
+
+	if (ctx->tail) {
+		tl = ctx->tail;
+
+		/* Stopped with the last tail watcher, see uev_tail_stop() */
+		if (!uev_io_active(&tl->w) && uev_io_start(&tl->w))
+			return NULL;
+
+		return tl;
+	}
+
+	tl = calloc(1, sizeof(*tl));
+	if (!tl)
+		return NULL;
+
+	tl->buf = malloc(UEV_TAIL_BUFSIZE);
+	if (!tl->buf)
+		goto fail;
+
+	tl->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (tl->fd < 0)
+		goto fail;
+
+	if (uev_io_init(ctx, &tl->w, inotify_cb, tl, tl->fd, UEV_READ)) {
+		close(tl->fd);
+		goto fail;
+	}
+
+	ctx->tail = tl;
+
+	return tl;
+fail:
+	free(tl->buf);
+	free(tl);
+	return NULL;
+}
+
+/* Called with @t removed from the list */
+static void tail_free(struct uev_tailer *tl, struct uev_tail *t)
+{
+	unwatch(tl, t, t->wd);
+	unwatch(tl, t, t->dwd);
+	if (t->fd >= 0)
+		close(t->fd);
+
+	t->w->u.tl.t = NULL;
+	t->w->active = 0;
+	t->w->fd     = -1;
+	free(t->carry);
+	free(t->path);
+	free(t);
+	tl->gen++;
+}
+
+/* Private to libuEv, do not use directly! */
+int _uev_tail_owns(uev_t *w)
+{
+	return w->cb == inotify_cb || w->cb == kick_cb;
+}
+
+/* Private to libuEv, do not use directly! */
+void _uev_tail_free(uev_ctx_t *ctx)
+{
+	struct uev_tailer *tl = ctx->tail;
+
+	if (!tl)
+		return;
+
+	/* Watches are removed with the inotify descriptor */
+	ctx->tail = NULL;
+	close(tl->fd);
+	tl->fd = -1;
+	while (tl->list) {
+		struct uev_tail *t = tl->list;
+
+		tl->list = t->next;
+		tail_free(tl, t);
+	}
+
+	uev_io_stop(&tl->w);
+	uev_timer_stop(&tl->kick);
+	free(tl->buf);
+	free(tl);
+}
+
+/**
+ * Follow a growing file, like tail -F
+ * @param ctx    A valid libuEv context
+ * @param w      Pointer to an uev_t watcher
+ * @param cb     Callback, called with batches of complete lines
+ * @param arg    Optional callback argument
+ * @param path   File to follow, need not exist yet
+ * @param flags  Zero to start at the end of the file, or %UEV_TAIL_BEGIN
+ *
+ * New data is read in batches of up to %UEV_TAIL_BUFSIZE bytes when
+ * inotify reports the file modified, and @cb is called with everything
+ * up to and including the last newline.  A partial line is held back
+ * until it is complete, unless it does not fit in the buffer.
+ *
+ * When the file is rotated, i.e. renamed or removed and a new file
+ * created at @path, the rest of the old file is delivered, then the new
+ * one is read from the beginning.  A truncated file is also read from
+ * the beginning again.  One inotify descriptor is shared by all tail
+ * watchers in a context.
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_tail_init(uev_ctx_t *ctx, uev_t *w, uev_tail_cb_t *cb, void *arg, const char *path, int flags)
+{
+	struct uev_tailer *tl;
+	struct uev_tail *t;
+	char *dir, *slash;
+	int err;
+
+	if (!ctx || !w || !cb || !path || (flags & ~UEV_TAIL_BEGIN)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	tl = tailer(ctx);
+	if (!tl)
+		return -1;
+
+	if (_uev_watcher_init(ctx, w, UEV_TAIL_TYPE, NULL, arg, -1, UEV_READ))
+		goto idle;
+
+	t = calloc(1, sizeof(*t));
+	if (!t)
+		goto idle;
+
+	t->path = strdup(path);
+	if (!t->path) {
+		free(t);
+		goto idle;
+	}
+
+	slash   = strrchr(t->path, '/');
+	t->name = slash ? slash + 1 : t->path;
+	t->w    = w;
+	t->fd   = -1;
+	t->wd   = -1;
+
+	/* Rotation is seen as a new file in the directory */
+	dir = slash ? strndup(t->path, slash == t->path ? 1 : slash - t->path) : strdup(".");
+	if (!dir)
+		goto fail;
+	t->dwd = inotify_add_watch(tl->fd, dir, DIR_MASK);
+	free(dir);
+	if (t->dwd < 0)
+		goto fail;
+
+	w->u.tl.cb = cb;
+	w->u.tl.t  = t;
+	w->active  = 1;
+
+	t->next  = tl->list;
+	tl->list = t;
+
+	/* Existing content is read on the next loop iteration */
+	reopen(tl, t, !(flags & UEV_TAIL_BEGIN));
+	later(tl, t);
+
+	return 0;
+fail:
+	free(t->path);
+	free(t);
+idle:
+	err = errno;
+	tailer_idle(tl);
+	errno = err;
+	return -1;
+}
+
+/**
+ * Stop following a file
+ * @param w  Tail watcher to stop
+ *
+ * @return POSIX OK(0) or non-zero with @param errno set on error.
+ */
+int uev_tail_stop(uev_t *w)
+{
+	struct uev_tailer *tl;
+	struct uev_tail **tp;
+
+	if (!w || w->type != UEV_TAIL_TYPE) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (!w->u.tl.t)
+		return 0;
+
+	tl = w->ctx->tail;
+	for (tp = &tl->list; *tp; tp = &(*tp)->next) {
+		if (*tp == w->u.tl.t) {
+			*tp = w->u.tl.t->next;
+			break;
+		}
+	}
+	tail_free(tl, w->u.tl.t);
+	tailer_idle(tl);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,167 @@
+/* libuEv - Micro event loop library
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "uev.h"
+
+#define UNUSED(arg) arg __attribute__ ((unused))
+#define LINE  100
+
+static long total, received, lines;
+
+static void tail_cb(uev_t *w, void *UNUSED(arg), int UNUSED(events), const char *buf, size_t len)
+{
+	const char *end = buf + len;
+
+	/* Split into lines, like a log shipper would */
+	while ((buf = memchr(buf, '\n', end - buf))) {
+		lines++;
+		buf++;
+	}
+
+	received += len;
+	if (received >= total)
+		uev_exit(w->ctx);
+}
+
+/* Append @total bytes, in writes of @chunk bytes with LINE byte lines */
+static void writer(const char *file, long chunk)
+{
+	char *buf;
+	long i;
+	int fd;
+
+	buf = malloc(chunk);
+	for (i = 0; i < chunk; i++)
+		buf[i] = (i % LINE) == LINE - 1 ? '\n' : 'x';
+
+	fd = open(file, O_WRONLY | O_APPEND);
+	for (i = 0; i < total; i += chunk)
+		write(fd, buf, chunk);
+	close(fd);
+	exit(0);
+}
+
+static int usage(int rc)
+{
+	fprintf(stderr,
+		"Usage: tailbench [-hr] [-c KB] [-f FILE] [-s MB]\n"
+		"  -c KB     Size of each write, default 1024\n"
+		"  -f FILE   File to append to, truncated, default tailbench.log\n"
+		"  -r        Write all data first, then read it with UEV_TAIL_BEGIN\n"
+		"  -s MB     Amount of data to append, default 4096\n");
+	return rc;
+}
+
+int main(int argc, char **argv)
+{
+	const char *file = "tailbench.log";
+	struct timeval start, end;
+	long chunk = 1024 * 1024;
+	uev_ctx_t ctx;
+	uev_t w;
+	pid_t pid;
+	double sec;
+	int c, fd, first = 0;
+
+	total = 4096L * 1024 * 1024;
+	while ((c = getopt(argc, argv, "c:f:hrs:")) != -1) {
+		switch (c) {
+		case 'c':
+			chunk = atol(optarg) * 1024;
+			break;
+
+		case 'f':
+			file = optarg;
+			break;
+
+		case 'h':
+			return usage(0);
+
+		case 'r':
+			first = 1;
+			break;
+
+		case 's':
+			total = atol(optarg) * 1024 * 1024;
+			break;
+
+		default:
+			return usage(1);
+		}
+	}
+
+	/* Whole lines per write */
+	chunk = chunk / LINE * LINE;
+	total = total / chunk * chunk;
+
+	fd = open(file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		perror("open");
+		return 1;
+	}
+	close(fd);
+
+	uev_init(&ctx);
+	if (!first)
+		uev_tail_init(&ctx, &w, tail_cb, NULL, file, 0);
+
+	gettimeofday(&start, NULL);
+	pid = fork();
+	if (!pid)
+		writer(file, chunk);
+
+	/* Only time reading */
+	if (first) {
+		waitpid(pid, NULL, 0);
+		uev_tail_init(&ctx, &w, tail_cb, NULL, file, UEV_TAIL_BEGIN);
+		gettimeofday(&start, NULL);
+	}
+
+	uev_run(&ctx, 0);
+	gettimeofday(&end, NULL);
+	waitpid(pid, NULL, 0);
+	unlink(file);
+
+	timersub(&end, &start, &end);
+	sec = end.tv_sec + end.tv_usec / 1e6;
+	printf("%ld MiB, %ld lines in %.2f sec, %.0f MiB/s, %.1f M lines/s\n",
+	       received >> 20, lines, sec, (received >> 20) / sec, lines / sec / 1e6);
+
+	return received != total;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
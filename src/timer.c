@@ -171,7 +171,7 @@ int uev_timer_start(uev_t *w)
 int uev_timer_stop(uev_t *w)
 {
 	/* Check if already stopped in uev_run() after cb() or _init() */
-	if (!_uev_watcher_active(w))
+	if (!_uev_is_active(w))
 		return 0;
 
 	/* Stop kernel timer */
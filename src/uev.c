@@ -22,8 +22,14 @@
  * THE SOFTWARE.
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <errno.h>
 #include <fcntl.h>		/* O_CLOEXEC */
+#include <linux/sockios.h>	/* SIOCOUTQ */
+#include <limits.h>		/* INT_MAX */
 #include <string.h>		/* memset() */
 #include <sys/epoll.h>
 #include <sys/ioctl.h>
@@ -52,6 +58,7 @@ static int _init(uev_ctx_t *ctx, int close_old)
 	return 0;
 }
 
+#ifndef UEV_DISABLE_STDIN_WORKAROUND
 /* Used by file i/o workaround when epoll => EPERM */
 static int has_data(int fd)
 {
@@ -67,6 +74,89 @@ static int has_data(int fd)
 
 	return 0;
 }
+#endif
+
+/* Events to ask the kernel for, on top of what the user wants */
+static uint32_t interest(uev_t *w)
+{
+	uint32_t events = w->events | EPOLLRDHUP;
+
+	/* Coalesced output waiting for the descriptor to be writable */
+	if (w->oq && w->oq->blocked)
+		events |= EPOLLOUT;
+
+	/* Rate limited, until the token bucket has refilled */
+	if (w->rl && _uev_limit_paused(w))
+		events &= ~EPOLLIN;
+
+	/* Waiting for send buffer space, only wake up when it changes */
+	if (w->lowait)
+		events |= EPOLLET;
+
+	return events;
+}
+
+/* Add, modify, or remove watcher in backend */
+static int ctl(uev_t *w, int op, struct epoll_event *ev)
+{
+	if (w->ctx->backend == UEV_BACKEND_POLL)
+		return _uev_poll_ctl(w, op, ev ? ev->events : 0);
+
+	/* Deferred until first uev_run(), see populate() */
+	if (w->ctx->lazy)
+		return 0;
+
+	return epoll_ctl(w->ctx->fd, op, w->fd, ev);
+}
+
+/*
+ * Add all watchers started before the first uev_run() to epoll.  A
+ * watcher that cannot be added is stopped and its callback called with
+ * %UEV_ERROR, same as any other watcher error.  The callback may start
+ * and stop other watchers, so the scan restarts after each error, with
+ * already added watchers skipped by the kernel with EEXIST.
+ */
+static void populate(uev_ctx_t *ctx)
+{
+	struct epoll_event ev;
+	uev_t *w;
+
+	ctx->lazy = 0;
+again:
+	LIST_FOREACH(w, &ctx->watchers, link) {
+		if (w->active != 1)
+			continue;
+
+		ev.events   = interest(w);
+		ev.data.ptr = w;
+		if (!epoll_ctl(ctx->fd, EPOLL_CTL_ADD, w->fd, &ev) || errno == EEXIST)
+			continue;
+
+#ifndef UEV_DISABLE_STDIN_WORKAROUND
+		if (errno == EPERM && w->type == UEV_IO_TYPE &&
+		    w->events == UEV_READ && w->fd == STDIN_FILENO) {
+			ctx->workaround = 1;
+			w->active = -1;
+			continue;
+		}
+#endif
+
+		w->active = 0;
+		LIST_REMOVE(w, link);
+		if (w->cb)
+			w->cb(w, w->arg, UEV_ERROR);
+		goto again;
+	}
+}
+
+/* Wait for events from backend */
+static int backend_wait(uev_ctx_t *ctx, struct epoll_event *ee, int max, int timeout)
+{
+	if (ctx->backend == UEV_BACKEND_POLL)
+		return _uev_poll_wait(ctx, ee, max, timeout);
+
+	return epoll_wait(ctx->fd, ee, max, timeout);
+}
 
 /* Private to libuEv, do not use directly! */
 int _uev_watcher_init(uev_ctx_t *ctx, uev_t *w, uev_type_t type, uev_cb_t *cb, void *arg, int fd, int events)
@@ -83,6 +173,12 @@ int _uev_watcher_init(uev_ctx_t *ctx, uev_t *w, uev_type_t type, uev_cb_t *cb, v
 	w->cb     = cb;
 	w->arg    = arg;
 	w->events = events;
+	w->oq     = NULL;
+	w->zc     = NULL;
+	w->rl     = NULL;
+	w->lowat  = 0;
+	w->lowait = 0;
+	w->idx    = -1;
 
 	return 0;
 }
@@ -97,12 +193,15 @@ int _uev_watcher_start(uev_t *w)
 		return -1;
 	}
 
-	if (_uev_watcher_active(w))
+	if (_uev_is_active(w))
 		return 0;
 
-	ev.events   = w->events | EPOLLRDHUP;
+	ev.events   = interest(w);
 	ev.data.ptr = w;
-	if (epoll_ctl(w->ctx->fd, EPOLL_CTL_ADD, w->fd, &ev) < 0) {
+	if (ctl(w, EPOLL_CTL_ADD, &ev) < 0) {
+#ifdef UEV_DISABLE_STDIN_WORKAROUND
+		return -1;
+#else
 		if (errno != EPERM)
 			return -1;
 
@@ -116,6 +215,7 @@ int _uev_watcher_start(uev_t *w)
 
 		w->ctx->workaround = 1;
 		w->active = -1;
+#endif
 	} else {
 		w->active = 1;
 	}
@@ -134,7 +234,7 @@ int _uev_watcher_stop(uev_t *w)
 		return -1;
 	}
 
-	if (!_uev_watcher_active(w))
+	if (!_uev_is_active(w))
 		return 0;
 
 	w->active = 0;
@@ -143,7 +243,7 @@ int _uev_watcher_stop(uev_t *w)
 	LIST_REMOVE(w, link);
 
 	/* Remove from kernel */
-	if (epoll_ctl(w->ctx->fd, EPOLL_CTL_DEL, w->fd, NULL) < 0)
+	if (ctl(w, EPOLL_CTL_DEL, NULL) < 0)
 		return -1;
 
 	return 0;
@@ -152,10 +252,7 @@ int _uev_watcher_stop(uev_t *w)
 /* Private to libuEv, do not use directly! */
 int _uev_watcher_active(uev_t *w)
 {
-	if (!w)
-		return 0;
-
-	return w->active > 0;
+	return _uev_is_active(w);
 }
 
 /* Private to libuEv, do not use directly! */
@@ -168,9 +265,9 @@ int _uev_watcher_rearm(uev_t *w)
 		return -1;
 	}
 
-	ev.events   = w->events | EPOLLRDHUP;
+	ev.events   = interest(w);
 	ev.data.ptr = w;
-	if (epoll_ctl(w->ctx->fd, EPOLL_CTL_MOD, w->fd, &ev) < 0)
+	if (ctl(w, EPOLL_CTL_MOD, &ev) < 0)
 		return -1;
 
 	return 0;
@@ -184,13 +281,50 @@ int _uev_watcher_rearm(uev_t *w)
  */
 int uev_init(uev_ctx_t *ctx)
 {
-	if (!ctx) {
+	return uev_init1(ctx, 0);
+}
+
+/**
+ * Create an event loop context, with flags
+ * @param ctx    Pointer to an uev_ctx_t context to be initialized
+ * @param flags  Zero for epoll, or one of %UEV_INIT_POLL, %UEV_INIT_AUTO,
+ *               or %UEV_INIT_LAZY
+ *
+ * For processes that only watch a handful of descriptors, a plain poll()
+ * is cheaper than epoll: no epoll descriptor, and no system call when a
+ * watcher is started, stopped, or changed.  With %UEV_INIT_AUTO the
+ * context moves to epoll for good when more than %UEV_POLL_MAX watchers
+ * are active, or when a watcher asks for %UEV_EDGE.  Edge triggered
+ * watchers are not supported with %UEV_INIT_POLL.
+ *
+ * With %UEV_INIT_LAZY watchers started before the first uev_run() are
+ * only added to epoll when it starts, in one pass.  Errors, e.g. a bad
+ * descriptor, are then reported to the watcher's callback with
+ * %UEV_ERROR instead of being returned by the init function.  The flag
+ * has no effect with the poll() backend.
+ *
+ * @return POSIX OK(0) on success, or non-zero on error.
+ */
+int uev_init1(uev_ctx_t *ctx, int flags)
+{
+	if (!ctx || (flags & ~(UEV_INIT_POLL | UEV_INIT_AUTO | UEV_INIT_LAZY))) {
 		errno = EINVAL;
 		return -1;
 	}
 
 	memset(ctx, 0, sizeof(*ctx));
 	LIST_INIT(&ctx->watchers);
+	LIST_INIT(&ctx->flushq);
+
+	if (flags & (UEV_INIT_POLL | UEV_INIT_AUTO)) {
+		ctx->fd        = -1;
+		ctx->backend   = UEV_BACKEND_POLL;
+		ctx->automatic = !(flags & UEV_INIT_POLL);
+		return 0;
+	}
+
+	ctx->backend = UEV_BACKEND_EPOLL;
+	ctx->lazy    = !!(flags & UEV_INIT_LAZY);
 
 	return _init(ctx, 0);
 }
@@ -199,6 +333,11 @@ int uev_init(uev_ctx_t *ctx)
  * Terminate the event loop
  * @param ctx  A valid libuEv context
  *
+ * All watchers are stopped.  Closing the epoll descriptor drops all of
+ * them from the kernel at once, so each watcher is only marked inactive,
+ * without an epoll_ctl() call per watcher.  Only descriptors owned by
+ * libuEv, i.e. those of timer, cron, and signal watchers, are closed.
+ *
  * @return POSIX OK(0) or non-zero with @param errno set on error.
  */
 int uev_exit(uev_ctx_t *ctx)
@@ -208,38 +347,288 @@ int uev_exit(uev_ctx_t *ctx)
 		return -1;
 	}
 
+	/* Descriptors of ours: connects, idle connections, resolvers, children */
+	_uev_conn_exit(ctx);
+	_uev_dns_exit(ctx);
+	_uev_spawn_exit(ctx);
+
 	while (!LIST_EMPTY(&ctx->watchers)) {
 		uev_t *w = LIST_FIRST(&ctx->watchers);
+		int active = _uev_is_active(w);
 
 		/* Remove from internal list */
 		LIST_REMOVE(w, link);
+		w->active = 0;
+		w->idx    = -1;
 
-		if (!_uev_watcher_active(w))
+		if (!active)
 			continue;
 
 		switch (w->type) {
 		case UEV_CRON_TYPE:
 		case UEV_TIMER_TYPE:
-			uev_timer_stop(w);
-			break;
-
 		case UEV_SIGNAL_TYPE:
-			uev_signal_stop(w);
+			close(w->fd);
+			w->fd = -1;
 			break;
 
 		case UEV_IO_TYPE:
-			uev_io_stop(w);
+			_uev_io_release(w);
+			break;
+
+		default:
 			break;
 		}
 	}
 
+	/* Paused watchers were released above */
+	_uev_limit_exit(ctx);
+	_uev_tail_free(ctx);
+	_uev_fiber_exit(ctx);
+
+	/* Waits for requests in flight, without calling back */
+	_uev_file_free(ctx);
+	_uev_log_exit(ctx);
+	_uev_ring_free(ctx);
+
 	ctx->running = 0;
-	close(ctx->fd);
+	ctx->backend = 0;
+	if (ctx->fd >= 0)
+		close(ctx->fd);
 	ctx->fd = -1;
+	_uev_poll_free(ctx);
+
+	/* Buffers kept by callbacks are freed when returned */
+	_uev_pool_free(ctx);
+	_uev_scratch_free(ctx);
+
+	return 0;
+}
+
+/* Start all dormant timers, and register any lazy watchers */
+static void start(uev_ctx_t *ctx)
+{
+	uev_t *w;
+
+	ctx->running = 1;
+
+	LIST_FOREACH(w, &ctx->watchers, link) {
+#ifndef UEV_DISABLE_CRON
+		if (UEV_CRON_TYPE == w->type)
+			uev_cron_set(w, w->u.c.when, w->u.c.interval);
+#endif
+		if (UEV_TIMER_TYPE == w->type)
+			uev_timer_set(w, w->u.t.timeout, w->u.t.period);
+	}
+
+	/* Register watchers started before the first uev_run() */
+	if (ctx->lazy)
+		populate(ctx);
+}
+
+#ifndef UEV_DISABLE_STDIN_WORKAROUND
+/*
+ * Handle special case: `application < file.txt`, stdin cannot be added
+ * to epoll so it is always readable until there is no more data.  Calls
+ * @fn for at most @max such watchers, returns the number of calls.
+ */
+static int workaround(uev_ctx_t *ctx, int max, void (*fn)(uev_t *, void *), void *data)
+{
+	int rerun = 0;
+	uev_t *w;
+
+	LIST_FOREACH(w, &ctx->watchers, link) {
+		if (rerun == max)
+			break;
+		if (w->active != -1 || !w->cb)
+			continue;
+
+		if (!has_data(w->fd)) {
+			w->active = 0;
+			LIST_REMOVE(w, link);
+		}
+
+		rerun++;
+		fn(w, data);
+	}
+
+	if (!rerun)
+		ctx->workaround = 0;
+
+	return rerun;
+}
+
+static void workaround_cb(uev_t *w, void *UNUSED(data))
+{
+	w->cb(w, w->arg, UEV_READ);
+}
+#endif
+
+/* Wait for events, after resetting scratch memory and submitting queued I/O */
+static int fetch(uev_ctx_t *ctx, struct epoll_event *ee, int max, int timeout)
+{
+	int nfds;
+
+	_uev_scratch_reset(ctx);
+	_uev_fiber_reap(ctx);
+	_uev_log_submit(ctx);
+	_uev_file_submit(ctx);
+
+	while ((nfds = backend_wait(ctx, ee, max, timeout)) < 0) {
+		if (!ctx->running)
+			return 0;
+
+		if (EINTR == errno)
+			continue; /* Signalled, try again */
+
+		/* Unrecoverable error, cleanup and exit with error. */
+		uev_exit(ctx);
+
+		return -2;
+	}
+
+	/* Cached loop time for rate limited watchers */
+	if (ctx->lim)
+		_uev_limit_tick(ctx);
+
+	return nfds;
+}
+
+/*
+ * Library side of an event: reap zero-copy completions, flush coalesced
+ * output, read timer expirations, and drain signals.  Returns zero if
+ * @events should be passed on to the watcher.
+ */
+static int prepare(uev_t *w, uint32_t *events)
+{
+	uint64_t exp;
+#ifndef UEV_DISABLE_SIGNAL
+	struct signalfd_siginfo fdsi;
+	ssize_t sz = sizeof(fdsi);
+#endif
+
+	switch (w->type) {
+	case UEV_IO_TYPE:
+		/* Zero-copy completions are signaled as errors */
+		if (w->zc && (*events & EPOLLERR) && _uev_io_zc_reap(w) > 0) {
+			*events &= ~EPOLLERR;
+			if (!*events)
+				return 1;
+		}
+
+		if (*events & (EPOLLHUP | EPOLLERR)) {
+			_uev_io_free(w);
+
+			/* Frame watchers deliver buffered frames first, then stop */
+			if (!_uev_frame_owns(w))
+				_uev_io_end(w);
+			break;
+		}
+
+		/* Coalesced output remainder, may not be for cb */
+		if (w->oq && w->oq->blocked && (*events & EPOLLOUT)) {
+			if (_uev_io_flush(w)) {
+				_uev_io_free(w);
+				_uev_io_end(w);
+				*events = UEV_ERROR;
+				break;
+			}
+
+			if (!(w->events & UEV_WRITE)) {
+				*events &= ~EPOLLOUT;
+				if (!*events)
+					return 1;
+			}
+		}
+
+		/* Writable threshold tracked in user space, uev_io_lowat() */
+		if (w->lowat && (*events & EPOLLOUT)) {
+			int queued;
+
+			if (!ioctl(w->fd, SIOCOUTQ, &queued) && queued >= w->lowat) {
+				*events &= ~EPOLLOUT;
+				if (!w->lowait) {
+					w->lowait = 1;
+					_uev_watcher_rearm(w);
+				}
+				if (!*events)
+					return 1;
+			} else if (w->lowait) {
+				w->lowait = 0;
+				_uev_watcher_rearm(w);
+			}
+		}
+		break;
+
+#ifndef UEV_DISABLE_SIGNAL
+	case UEV_SIGNAL_TYPE:
+		if (read(w->fd, &fdsi, sz) != sz) {
+			if (uev_signal_start(w)) {
+				uev_signal_stop(w);
+				*events = UEV_ERROR;
+			}
+		}
+		break;
+#endif
+
+	case UEV_TIMER_TYPE:
+		if (read(w->fd, &exp, sizeof(exp)) != sizeof(exp)) {
+			uev_timer_stop(w);
+			*events = UEV_ERROR;
+		}
+
+		if (!w->u.t.period)
+			w->u.t.timeout = 0;
+		break;
+
+#ifndef UEV_DISABLE_CRON
+	case UEV_CRON_TYPE:
+		if (read(w->fd, &exp, sizeof(exp)) != sizeof(exp)) {
+			*events = UEV_HUP;
+			if (errno != ECANCELED) {
+				uev_cron_stop(w);
+				*events = UEV_ERROR;
+			}
+		}
+
+		if (!w->u.c.interval)
+			w->u.c.when = 0;
+		else
+			w->u.c.when += w->u.c.interval;
+		break;
+#endif
+
+	default:
+		/* File and ring receive watchers are never in epoll */
+		return 1;
+	}
+
+	*events &= UEV_EVENT_MASK;
 
 	return 0;
 }
 
+/*
+ * Stop expired one-shot timers, unless restarted by the callback, and
+ * charge rate limited watchers for the event.
+ */
+static void settle(uev_t *w, int events)
+{
+	if (w->rl && (events & UEV_READ))
+		_uev_limit_count(w, UEV_LIMIT_EVENTS, 1);
+
+#ifndef UEV_DISABLE_CRON
+	if (UEV_CRON_TYPE == w->type) {
+		if (!w->u.c.when)
+			uev_timer_stop(w);
+	}
+#endif
+	if (UEV_TIMER_TYPE == w->type) {
+		if (!w->u.t.timeout)
+			uev_timer_stop(w);
+	}
+}
+
 /**
  * Start the event loop
  * @param ctx    A valid libuEv context
@@ -257,9 +646,8 @@ int uev_exit(uev_ctx_t *ctx)
 int uev_run(uev_ctx_t *ctx, int flags)
 {
 	int timeout = -1;
-	uev_t *w;
 
-        if (!ctx || ctx->fd < 0) {
+        if (!ctx || !ctx->backend) {
 		errno = EINVAL;
                 return -1;
 	}
@@ -268,121 +656,147 @@ int uev_run(uev_ctx_t *ctx, int flags)
 		timeout = 0;
 
 	/* Start the event loop */
-	ctx->running = 1;
-
-	/* Start all dormant timers */
-	LIST_FOREACH(w, &ctx->watchers, link) {
-		if (UEV_CRON_TYPE == w->type)
-			uev_cron_set(w, w->u.c.when, w->u.c.interval);
-		if (UEV_TIMER_TYPE == w->type)
-			uev_timer_set(w, w->u.t.timeout, w->u.t.period);
-	}
+	start(ctx);
 
 	while (ctx->running && !LIST_EMPTY(&ctx->watchers)) {
-		int i, nfds, rerun = 0;
+		int i, nfds;
 		struct epoll_event ee[UEV_MAX_EVENTS];
 
-		/* Handle special case: `application < file.txt` */
-		if (ctx->workaround) {
-			LIST_FOREACH(w, &ctx->watchers, link) {
-				if (w->active != -1 || !w->cb)
-					continue;
-
-				if (!has_data(w->fd)) {
-					w->active = 0;
-					LIST_REMOVE(w, link);
-				}
-
-				rerun++;
-				w->cb(w, w->arg, UEV_READ);
-			}
+#ifndef UEV_DISABLE_STDIN_WORKAROUND
+		if (ctx->workaround && workaround(ctx, INT_MAX, workaround_cb, NULL)) {
+			_uev_io_flush_all(ctx);
+			_uev_handoff_flush(ctx);
+			continue;
 		}
+#endif
 
-		if (rerun)
-			continue;
-		ctx->workaround = 0;
+		nfds = fetch(ctx, ee, UEV_MAX_EVENTS, timeout);
+		if (nfds < 0)
+			return nfds;
+
+		for (i = 0; ctx->running && i < nfds; i++) {
+			uev_t *w = (uev_t *)ee[i].data.ptr;
+			uint32_t events = ee[i].events;
+
+			if (prepare(w, &events))
+				continue;
 
-		while ((nfds = epoll_wait(ctx->fd, ee, UEV_MAX_EVENTS, timeout)) < 0) {
+			if (w->cb)
+				w->cb(w, w->arg, events);
+
+			/* The watcher may be gone after uev_exit() */
 			if (!ctx->running)
 				break;
 
-			if (EINTR == errno)
-				continue; /* Signalled, try again */
+			settle(w, events);
+		}
 
-			/* Unrecoverable error, cleanup and exit with error. */
-			uev_exit(ctx);
+		/* Write all output coalesced by callbacks in this iteration */
+		_uev_io_flush_all(ctx);
+		_uev_handoff_flush(ctx);
 
-			return -2;
-		}
+		if (flags & UEV_ONCE)
+			break;
+	}
 
-		for (i = 0; ctx->running && i < nfds; i++) {
-			uint64_t exp;
-			uint32_t events;
-			struct signalfd_siginfo fdsi;
-			ssize_t sz = sizeof(fdsi);
-
-			w = (uev_t *)ee[i].data.ptr;
-			events = ee[i].events;
-
-			switch (w->type) {
-			case UEV_IO_TYPE:
-				if (events & (EPOLLHUP | EPOLLERR))
-					uev_io_stop(w);
-				break;
+	return 0;
+}
 
-			case UEV_SIGNAL_TYPE:
-				if (read(w->fd, &fdsi, sz) != sz) {
-					if (uev_signal_start(w)) {
-						uev_signal_stop(w);
-						events = UEV_ERROR;
-					}
-				}
-				break;
+#ifndef UEV_DISABLE_STDIN_WORKAROUND
+static void workaround_out(uev_t *w, void *data)
+{
+	uev_event_t **out = data;
 
-			case UEV_TIMER_TYPE:
-				if (read(w->fd, &exp, sizeof(exp)) != sizeof(exp)) {
-					uev_timer_stop(w);
-					events = UEV_ERROR;
-				}
+	(*out)->w      = w;
+	(*out)->events = UEV_READ;
+	(*out)++;
+}
+#endif
 
-				if (!w->u.t.period)
-					w->u.t.timeout = 0;
-				break;
+/**
+ * Poll for ready watchers, without calling back
+ * @param ctx      A valid libuEv context
+ * @param out      Array of @max entries, filled in with watcher and events
+ * @param max      Size of @out, at most %UEV_MAX_EVENTS entries are used
+ * @param timeout  Max time to wait in milliseconds, or -1 to wait forever
+ *
+ * Pull mode alternative to uev_run(), for applications that want to sort
+ * or batch ready descriptors themselves.  The library side of each event
+ * is still done before it is returned: timer expirations are read and
+ * expired one-shot timers stopped, signals are drained, watchers with
+ * %UEV_HUP or %UEV_ERROR are stopped, and output queued with
+ * uev_io_write() is written before waiting.
+ *
+ * Only plain I/O, timer, cron, and signal watchers are returned in
+ * @out.  Watchers that read on the caller's behalf are dispatched to
+ * their callbacks from here instead, as in uev_run(), since a caller
+ * reading their descriptor would corrupt their state: frame, input,
+ * netlink, receive, handoff, connect, spawn, and tail watchers, fibers,
+ * and completions of asynchronous file I/O and ring receive watchers.
+ *
+ * @return Number of entries filled in @out, zero on timeout, or -1 with
+ * @param errno set on error.
+ */
+int uev_poll(uev_ctx_t *ctx, uev_event_t *out, int max, int timeout)
+{
+	struct epoll_event ee[UEV_MAX_EVENTS];
+	int i, n = 0, nfds;
 
-			case UEV_CRON_TYPE:
-				if (read(w->fd, &exp, sizeof(exp)) != sizeof(exp)) {
-					events = UEV_HUP;
-					if (errno != ECANCELED) {
-						uev_cron_stop(w);
-						events = UEV_ERROR;
-					}
-				}
+	if (!ctx || !ctx->backend || !out || max <= 0) {
+		errno = EINVAL;
+		return -1;
+	}
 
-				if (!w->u.c.interval)
-					w->u.c.when = 0;
-				else
-					w->u.c.when += w->u.c.interval;
-				break;
-			}
+	if (!ctx->running)
+		start(ctx);
 
-			if (w->cb)
-				w->cb(w, w->arg, events & UEV_EVENT_MASK);
+	/* Output written by the caller since last time */
+	_uev_io_flush_all(ctx);
+	_uev_handoff_flush(ctx);
 
-			if (UEV_CRON_TYPE == w->type) {
-				if (!w->u.c.when)
-					uev_timer_stop(w);
-			}
-			if (UEV_TIMER_TYPE == w->type) {
-				if (!w->u.t.timeout)
-					uev_timer_stop(w);
-			}
+#ifndef UEV_DISABLE_STDIN_WORKAROUND
+	if (ctx->workaround) {
+		uev_event_t *pos = out;
+
+		if (workaround(ctx, max, workaround_out, &pos))
+			return pos - out;
+	}
+#endif
+
+	if (max > UEV_MAX_EVENTS)
+		max = UEV_MAX_EVENTS;
+
+	nfds = fetch(ctx, ee, max, timeout);
+	if (nfds < 0)
+		return -1;
+
+	for (i = 0; ctx->backend && i < nfds; i++) {
+		uev_t *w = (uev_t *)ee[i].data.ptr;
+		uint32_t events = ee[i].events;
+
+		if (prepare(w, &events))
+			continue;
+
+		/* Library owned watchers, e.g. file I/O completions */
+		if (_uev_file_owns(w) || _uev_limit_owns(w) || _uev_tail_owns(w) ||
+		    _uev_conn_owns(w) || _uev_dns_owns(w) || _uev_handoff_owns(w) ||
+		    _uev_spawn_owns(w) || _uev_fiber_owns(w) || _uev_frame_owns(w) ||
+		    _uev_input_owns(w) || _uev_netlink_owns(w) || _uev_recv_owns(w)) {
+			w->cb(w, w->arg, events);
+			if (!ctx->backend)
+				break;
+
+			settle(w, events);
+			continue;
 		}
 
-		if (flags & UEV_ONCE)
-			break;
+		settle(w, events);
+		out[n].w      = w;
+		out[n].events = events;
+		n++;
 	}
 
-	return 0;
+	return n;
 }
 
 /**
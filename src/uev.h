@@ -27,8 +27,10 @@
 
 #include "private.h"
 
-/* Max. number of simulateneous events */
+/* Max. number of simulateneous events, see configure --with-max-events */
+#ifndef UEV_MAX_EVENTS
 #define UEV_MAX_EVENTS  10
+#endif
 
 /* I/O events, signal and timer revents are always UEV_READ */
 #define UEV_NONE        0
@@ -41,15 +43,114 @@
 #define UEV_EDGE        EPOLLET
 #define UEV_ONESHOT     EPOLLONESHOT
 
+/* Input device protocols, for uev_input_init() */
+#define UEV_INPUT_JOYSTICK 1	/* struct js_event from <linux/joystick.h> */
+#define UEV_INPUT_EVDEV    2	/* struct input_event from <linux/input.h> */
+
+/* Max. number of input device events read per wakeup */
+#define UEV_INPUT_BATCH 64
+
+/* Netlink receive batch, datagrams per recvmmsg() and size of each */
+#define UEV_NETLINK_VLEN  8
+#define UEV_NETLINK_BUFSZ 8192
+
+/* Max. bytes held in an I/O watcher's output queue before flushing */
+#define UEV_IO_COALESCE_MAX 65536
+
+/* Sends smaller than this are copied, zero-copy setup costs more */
+#define UEV_ZEROCOPY_MIN 16384
+
+/* Max. number of free buffers kept per receive buffer pool size class */
+#define UEV_POOL_MAX_FREE 256
+
+/* Receive delay histogram buckets, see uev_recv_delay(), the last from 4 s */
+#define UEV_DELAY_BUCKETS 24
+
+/* Max. frame payload for uev_frame_init(), the largest pool size class */
+#define UEV_FRAME_MAX    (128 * 1024)
+
+/* Max. idle connections kept per destination, see uev_connect_put() */
+#define UEV_KEEP_MAX     8
+
+/* DNS record types, for uev_dns_query() */
+#define UEV_DNS_A        1
+#define UEV_DNS_AAAA     28
+#define UEV_DNS_SRV      33
+
+/* Max. records per DNS answer, and answers cached per resolver */
+#define UEV_DNS_MAX_RR    32
+#define UEV_DNS_CACHE_MAX 1024
+
+/* Max. descriptors per handoff message, the kernel allows 253 */
+#define UEV_HANDOFF_BATCH 64
+
+/* Spawn flags, for uev_spawn() */
+#define UEV_SPAWN_STDIN  1	/* Pipe to stdin, see uev_spawn_stdin() */
+#define UEV_SPAWN_STDOUT 2	/* Output to callback, or inherited */
+#define UEV_SPAWN_STDERR 4
+#define UEV_SPAWN_PATH   8	/* Search PATH for the program */
+
+/* Max. bytes of a spawned child's output read per wakeup */
+#define UEV_SPAWN_BUFSIZE (128 * 1024)
+
+/* Asynchronous file I/O backends, for uev_file_backend() */
+#define UEV_FILE_AUTO    0
+#define UEV_FILE_URING   1
+#define UEV_FILE_THREADS 2
+
+/* Number of threads used for file I/O when io_uring is not available */
+#define UEV_FILE_WORKERS 4
+
+/* First chunk of the scratch arena, grows to what one iteration needs */
+#define UEV_SCRATCH_SIZE (64 * 1024)
+
+/* Default fiber stack, committed as it is used, with a guard page below */
+#define UEV_FIBER_STACK  (256 * 1024)
+
+/* Max. bytes appended to a log while the previous batch is written, 16 MiB */
+#define UEV_LOG_MAX      (16 * 1024 * 1024)
+
+/* Default provided buffer ring for ring receive watchers, 4 MiB */
+#define UEV_BUFRING_NUM  1024
+#define UEV_BUFRING_SIZE 4096
+
+/* Tail watchers read new data in batches of this size, 1 MiB */
+#define UEV_TAIL_BUFSIZE (1024 * 1024)
+
+/* Tail flags, for uev_tail_init() */
+#define UEV_TAIL_BEGIN  1	/* Read existing content, not only new */
+
+/* Init flags, for uev_init1() */
+#define UEV_INIT_POLL   1	/* Use poll(), for a handful of descriptors */
+#define UEV_INIT_AUTO   2	/* Start with poll(), move to epoll when outgrown */
+#define UEV_INIT_LAZY   4	/* Add watchers to epoll at first uev_run() */
+
+/* Max. number of watchers before %UEV_INIT_AUTO moves to epoll */
+#define UEV_POLL_MAX    8
+
+/* Rate limit units, for uev_io_limit() */
+#define UEV_LIMIT_EVENTS 1	/* Callbacks with %UEV_READ per second */
+#define UEV_LIMIT_BYTES  2	/* Bytes per second, see uev_io_charge() */
+
 /* Run flags */
 #define UEV_ONCE        1
 #define UEV_NONBLOCK    2
 
 /* Macros */
-#define uev_io_active(w)     _uev_watcher_active(w)
-#define uev_timer_active(w)  _uev_watcher_active(w)
-#define uev_cron_active(w)   _uev_watcher_active(w)
-#define uev_signal_active(w) _uev_watcher_active(w)
+#define uev_io_active(w)     _uev_is_active(w)
+#define uev_input_active(w)  _uev_is_active(w)
+#define uev_netlink_active(w) _uev_is_active(w)
+#define uev_recv_active(w)   _uev_is_active(w)
+#define uev_frame_active(w)  _uev_is_active(w)
+#define uev_connect_active(w) _uev_is_active(w)
+#define uev_dns_active(w)    _uev_is_active(w)
+#define uev_handoff_active(w) _uev_is_active(w)
+#define uev_spawn_active(w)  _uev_is_active(w)
+#define uev_ring_recv_active(w) _uev_is_active(w)
+#define uev_tail_active(w)   _uev_is_active(w)
+#define uev_timer_active(w)  _uev_is_active(w)
+#define uev_cron_active(w)   _uev_is_active(w)
+#define uev_signal_active(w) _uev_is_active(w)
 
 /* Event watcher */
 typedef struct uev {
@@ -62,6 +163,76 @@ typedef struct uev {
 	uev_ctx_t      *ctx;
 } uev_t;
 
+/*
+ * Fast path helper, inlined in the caller instead of a call into the
+ * shared library.
+ */
+static inline int _uev_is_active(uev_t *w)
+{
+	return w && w->active > 0;
+}
+
+/* Ready watcher, returned by uev_poll() */
+typedef struct uev_event {
+	uev_t          *w;
+	int             events;
+} uev_event_t;
+
+/* I/O watcher to register with uev_io_init_many() */
+typedef struct uev_io_spec {
+	uev_t          *w;
+	int             fd;
+	int             events;
+	void          (*cb)(uev_t *, void *, int);
+	void           *arg;
+} uev_io_spec_t;
+
+/* DNS resource record, see uev_dns_query() */
+typedef struct uev_dns_rr {
+	int             type;	/* UEV_DNS_A, UEV_DNS_AAAA, or UEV_DNS_SRV */
+	uint32_t        ttl;	/* Seconds, as received */
+	union {
+		struct in_addr  a;
+		struct in6_addr aaaa;
+		struct {
+			uint16_t prio;
+			uint16_t weight;
+			uint16_t port;
+			char     target[256];
+		} srv;
+	} u;
+} uev_dns_rr_t;
+
+/* Kernel receive to callback delays, see uev_recv_delay() */
+typedef struct uev_delay {
+	uint64_t        count;
+	uint64_t        total;	/* Sum of all delays, microseconds */
+	uint64_t        max;	/* Microseconds */
+	uint64_t        hist[UEV_DELAY_BUCKETS]; /* [0]: < 1 us, [i]: < 2^i us */
+} uev_delay_t;
+
+/* Outbound connect to start with uev_connect_many() */
+typedef struct uev_connect_spec {
+	uev_t          *w;
+	const struct sockaddr *sa;
+	socklen_t       len;
+	void          (*cb)(uev_t *, void *, int, int);
+	void           *arg;
+} uev_connect_spec_t;
+
+/* Receive buffer, borrowed from the context's pool */
+typedef struct uev_buf {
+	char           *data;
+	size_t          len;	/* Number of bytes read into @data */
+	size_t          size;	/* Capacity of @data */
+	struct timespec stamp;	/* Kernel receive time, see uev_recv_timestamp() */
+
+	/* Private data for libuEv internal engine */
+	struct uev_buf *next;
+	int             class;
+	int             keep;
+} uev_buf_t;
+
 /*
  * Generic callback for watchers, @events holds %UEV_READ and/or %UEV_WRITE
  * with optional %UEV_PRI (priority data available to read) and any of the
@@ -74,15 +245,175 @@ typedef struct uev {
  */
 typedef void (uev_cb_t)(uev_t *w, void *arg, int events);
 
+/*
+ * Input device callback, @batch holds @num compressed events, either an
+ * array of struct js_event or struct input_event depending on protocol.
+ * On %UEV_ERROR or %UEV_HUP @batch is NULL and @num is zero.
+ */
+typedef void (uev_input_cb_t)(uev_t *w, void *arg, int events, void *batch, size_t num);
+
+/*
+ * Netlink callback, called once per message in a received batch.  The
+ * @nlh points into the receive buffer, it is only valid in the callback.
+ * On %UEV_ERROR or %UEV_HUP @nlh is NULL.
+ */
+typedef void (uev_netlink_cb_t)(uev_t *w, void *arg, int events, struct nlmsghdr *nlh);
+
+/*
+ * Zero-copy send completion, called when the kernel no longer needs
+ * @buf, the application may then reuse or free it.
+ */
+typedef void (uev_zc_cb_t)(uev_t *w, void *arg, void *buf, size_t len);
+
+/*
+ * Receive callback, @buf holds data read from the descriptor.  The
+ * buffer is returned to the pool when the callback returns, unless
+ * uev_buf_keep() is called.  On %UEV_ERROR or %UEV_HUP @buf is NULL.
+ */
+typedef void (uev_recv_cb_t)(uev_t *w, void *arg, int events, uev_buf_t *buf);
+
+/*
+ * Connect callback, with %UEV_WRITE and the connected socket @sd, which
+ * then belongs to the application.  On %UEV_ERROR @sd is -1 and errno
+ * is set, e.g. %ECONNREFUSED or %ETIMEDOUT.
+ */
+typedef void (uev_connect_cb_t)(uev_t *w, void *arg, int events, int sd);
+
+/*
+ * DNS answer, @num records in @rr, only valid in the callback.  On error
+ * @rr is NULL, @num is -1, and errno is set, e.g. %ENOENT or %ETIMEDOUT.
+ */
+typedef void (uev_dns_cb_t)(uev_t *w, void *arg, const uev_dns_rr_t *rr, int num);
+
+/*
+ * Handoff callback, with %UEV_READ and a descriptor @sd from the peer,
+ * which then belongs to the application.  With %UEV_HUP or %UEV_ERROR
+ * the peer is gone and @sd is -1.
+ */
+typedef void (uev_handoff_cb_t)(uev_t *w, void *arg, int events, int sd);
+
+/*
+ * Spawn callback, with %UEV_READ and @len bytes of output in @buf from
+ * the child's stdout, @fd 1, or stderr, @fd 2.  When the child has exited
+ * and all output is read, with %UEV_HUP and @fd -1.
+ */
+typedef void (uev_spawn_cb_t)(uev_t *w, void *arg, int events, int fd, const char *buf, size_t len);
+
+/*
+ * File I/O completion, @res is the result of pread(), pwrite(), or
+ * fsync().  On error @res is -1 and errno is set.
+ */
+typedef void (uev_file_cb_t)(uev_t *w, void *arg, void *buf, ssize_t res);
+
+/*
+ * Log durability callback, the record appended with @arg is on disk at
+ * offset @off in the file.  On error @off is -1 and errno is set.
+ */
+typedef void (uev_log_cb_t)(uev_t *w, void *arg, off_t off);
+
+/* Fiber function, the fiber is done when it returns */
+typedef void (uev_fiber_fn_t)(uev_ctx_t *ctx, void *arg);
+
+/*
+ * Ring receive callback, @len bytes were received into the provided
+ * buffer @bid, see uev_bufring_data().  The buffer is given back to the
+ * kernel when the callback returns, unless uev_bufring_keep() is called.
+ * On %UEV_ERROR or %UEV_HUP @bid is -1, the watcher has been stopped.
+ */
+typedef void (uev_ring_recv_cb_t)(uev_t *w, void *arg, int events, int bid, size_t len);
+
+/*
+ * Tail callback, @lines holds @len bytes of one or more complete lines,
+ * each ending with a newline.  Only valid in the callback.  The last
+ * line of a rotated file, and lines longer than %UEV_TAIL_BUFSIZE, may
+ * be delivered without a newline.
+ */
+typedef void (uev_tail_cb_t)(uev_t *w, void *arg, int events, const char *lines, size_t len);
+
 /* Public interface */
 int uev_init           (uev_ctx_t *ctx);
+int uev_init1          (uev_ctx_t *ctx, int flags);
 int uev_exit           (uev_ctx_t *ctx);
 int uev_run            (uev_ctx_t *ctx, int flags);
+int uev_poll           (uev_ctx_t *ctx, uev_event_t *out, int max, int timeout);
 
 int uev_io_init        (uev_ctx_t *ctx, uev_t *w, uev_cb_t *cb, void *arg, int fd, int events);
+int uev_io_init_many   (uev_ctx_t *ctx, uev_io_spec_t *io, size_t num);
 int uev_io_set         (uev_t *w, int fd, int events);
 int uev_io_start       (uev_t *w);
 int uev_io_stop        (uev_t *w);
+int uev_io_write       (uev_t *w, const void *buf, size_t len);
+int uev_io_flush       (uev_t *w);
+size_t uev_io_pending  (uev_t *w);
+int uev_io_coalesce    (uev_t *w, int hold);
+ssize_t uev_io_send_zc (uev_t *w, void *buf, size_t len, uev_zc_cb_t *cb, void *arg);
+int uev_io_limit       (uev_t *w, int unit, unsigned int rate, unsigned int burst);
+int uev_io_charge      (uev_t *w, size_t num);
+int uev_io_lowat       (uev_t *w, size_t bytes);
+
+int uev_input_init     (uev_ctx_t *ctx, uev_t *w, uev_input_cb_t *cb, void *arg, int fd, int proto);
+int uev_netlink_init   (uev_ctx_t *ctx, uev_t *w, uev_netlink_cb_t *cb, uev_cb_t *resync, void *arg, int fd);
+int uev_recv_init      (uev_ctx_t *ctx, uev_t *w, uev_recv_cb_t *cb, void *arg, int fd, size_t size);
+int uev_recv_timestamp (uev_t *w, int enable);
+int uev_recv_delay     (uev_ctx_t *ctx, uev_delay_t *d, int reset);
+int uev_frame_init     (uev_ctx_t *ctx, uev_t *w, uev_recv_cb_t *cb, void *arg, int fd, int hdrlen, size_t max);
+int uev_frame_stop     (uev_t *w);
+
+int uev_connect        (uev_ctx_t *ctx, uev_t *w, uev_connect_cb_t *cb, void *arg,
+			const struct sockaddr *sa, socklen_t len, int timeout);
+int uev_connect_many   (uev_ctx_t *ctx, uev_connect_spec_t *c, size_t num, int timeout);
+int uev_connect_stop   (uev_t *w);
+int uev_connect_get    (uev_ctx_t *ctx, uev_t *w, uev_connect_cb_t *cb, void *arg,
+			const struct sockaddr *sa, socklen_t len, int timeout);
+int uev_connect_put    (uev_ctx_t *ctx, int sd, int idle);
+
+int uev_dns_init       (uev_ctx_t *ctx, uev_t *w, const struct sockaddr *server, socklen_t len);
+int uev_dns_query      (uev_t *w, const char *name, int type, int timeout, uev_dns_cb_t *cb, void *arg);
+int uev_dns_stop       (uev_t *w);
+
+int uev_handoff_init   (uev_ctx_t *ctx, uev_t *w, uev_handoff_cb_t *cb, void *arg, int sd);
+int uev_handoff_stop   (uev_t *w);
+int uev_handoff_send   (uev_ctx_t *ctx, int fd);
+int uev_handoff_load   (uev_t *w, unsigned int load);
+
+int uev_spawn          (uev_ctx_t *ctx, uev_t *w, uev_spawn_cb_t *cb, void *arg,
+			char *const argv[], char *const envp[], int flags);
+int uev_spawn_stdin    (uev_t *w);
+int uev_spawn_kill     (uev_t *w, int signo);
+int uev_spawn_status   (uev_t *w);
+int uev_spawn_stop     (uev_t *w);
+
+uev_buf_t *uev_buf_get (uev_ctx_t *ctx, size_t size);
+void uev_buf_keep      (uev_buf_t *buf);
+void uev_buf_put       (uev_ctx_t *ctx, uev_buf_t *buf);
+
+int uev_file_init      (uev_ctx_t *ctx, uev_t *w, int fd);
+int uev_file_backend   (uev_ctx_t *ctx, int backend);
+int uev_file_read      (uev_t *w, void *buf, size_t len, off_t off, uev_file_cb_t *cb, void *arg);
+int uev_file_write     (uev_t *w, const void *buf, size_t len, off_t off, uev_file_cb_t *cb, void *arg);
+int uev_file_fsync     (uev_t *w, uev_file_cb_t *cb, void *arg);
+
+int uev_log_init       (uev_ctx_t *ctx, uev_t *w, int fd);
+int uev_log_append     (uev_t *w, const void *rec, size_t len, uev_log_cb_t *cb, void *arg);
+int uev_log_stop       (uev_t *w);
+
+int uev_fiber_spawn    (uev_ctx_t *ctx, uev_fiber_fn_t *fn, void *arg, size_t stack);
+int uev_fiber_wait_io  (uev_ctx_t *ctx, int fd, int events);
+int uev_fiber_sleep    (uev_ctx_t *ctx, int ms);
+
+void *uev_scratch      (uev_ctx_t *ctx, size_t size);
+void *uev_scratch_keep (const void *ptr, size_t size);
+
+int uev_ring_recv_init (uev_ctx_t *ctx, uev_t *w, uev_ring_recv_cb_t *cb, void *arg, int fd);
+int uev_ring_recv_stop (uev_t *w);
+
+int uev_tail_init      (uev_ctx_t *ctx, uev_t *w, uev_tail_cb_t *cb, void *arg, const char *path, int flags);
+int uev_tail_stop      (uev_t *w);
+
+int uev_bufring_init   (uev_ctx_t *ctx, unsigned int num, size_t size);
+void *uev_bufring_data (uev_ctx_t *ctx, int bid);
+void uev_bufring_keep  (uev_ctx_t *ctx, int bid);
+void uev_bufring_put   (uev_ctx_t *ctx, int bid);
 
 int uev_timer_init     (uev_ctx_t *ctx, uev_t *w, uev_cb_t *cb, void *arg, int timeout, int period);
 int uev_timer_set      (uev_t *w, int timeout, int period);
@@ -0,0 +1,72 @@
+/* libuEv - Micro event loop library, amalgamated build
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * All of libuEv in one translation unit, for applications that compile
+ * the library into their binary.  With link-time optimization the event
+ * loop, the watcher internals, and the application's callbacks can then
+ * be inlined together, e.g.
+ *
+ *     cc -O2 -flto -I/path/to/libuev/src app.c uev_all.c -lpthread
+ *
+ * Define UEV_DISABLE_CRON, UEV_DISABLE_SIGNAL, and/or
+ * UEV_DISABLE_STDIN_WORKAROUND to leave out features, and UEV_MAX_EVENTS
+ * to change the number of events handled per iteration.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "uev.c"
+#include "poll.c"
+#include "io.c"
+#include "zerocopy.c"
+#include "pool.c"
+#include "scratch.c"
+#include "frame.c"
+#include "connect.c"
+#include "dns.c"
+#include "handoff.c"
+#include "spawn.c"
+#include "fiber.c"
+#include "limit.c"
+#include "file.c"
+#include "log.c"
+#include "ring.c"
+#include "tail.c"
+#include "input.c"
+#include "netlink.c"
+#include "timer.c"
+#ifndef UEV_DISABLE_SIGNAL
+#include "signal.c"
+#endif
+#ifndef UEV_DISABLE_CRON
+#include "cron.c"
+#endif
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,277 @@
+/* libuEv - Micro event loop library
+ *
+ * Copyright (c) 2026  agent <agent()local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <stdlib.h>		/* calloc(), realloc(), free() */
+#include <string.h>		/* memmove() */
+#include <sys/socket.h>
+#include <netinet/in.h>		/* IPPROTO_IP, IPPROTO_IPV6 */
+#include <linux/errqueue.h>	/* struct sock_extended_err */
+
+#include "uev.h"
+
+/* Missing defines in older GLIBC and kernel headers */
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+
+
+static struct uev_zc *zc_get(uev_t *w)
+{
+	int on = 1;
+
+	if (w->zc)
+		return w->zc;
+
+	w->zc = calloc(1, sizeof(struct uev_zc));
+	if (!w->zc)
+		return NULL;
+
+	/* E.g., AF_UNIX sockets do not support zero-copy, always copy */
+	if (!setsockopt(w->fd, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on)))
+		w->zc->enabled = 1;
+
+	return w->zc;
+}
+
+static struct uev_zc_req *zc_push(struct uev_zc *zc, void *buf, size_t len, uev_zc_cb_t *cb, void *arg)
+{
+	struct uev_zc_req *req;
+
+	if (zc->num == zc->size) {
+		size_t size = zc->size ? zc->size * 2 : 16;
+
+		req = realloc(zc->req, size * sizeof(*req));
+		if (!req)
+			return NULL;
+
+		zc->req  = req;
+		zc->size = size;
+	}
+
+	req = &zc->req[zc->num++];
+	req->buf    = buf;
+	req->len    = len;
+	req->cb     = cb;
+	req->arg    = arg;
+	req->id     = 0;
+	req->copied = 0;
+	req->done   = 0;
+
+	return req;
+}
+
+/* Call completion callbacks in send order, callbacks may send more */
+static void zc_pop(uev_t *w)
+{
+	struct uev_zc *zc = w->zc;
+
+	while (zc->num && zc->req[0].done) {
+		struct uev_zc_req req = zc->req[0];
+
+		zc->num--;
+		memmove(&zc->req[0], &zc->req[1], zc->num * sizeof(req));
+		if (req.cb)
+			req.cb(w, req.arg, req.buf, req.len);
+	}
+}
+
+/* Private to libuEv, do not use directly! */
+int _uev_io_zc_reap(uev_t *w)
+{
+	char control[CMSG_SPACE(sizeof(struct sock_extended_err)) * 4];
+	struct uev_zc *zc = w->zc;
+	int num = 0;
+
+	if (!zc)
+		return 0;
+
+	while (1) {
+		struct sock_extended_err *ee;
+		struct msghdr msg = { 0 };
+		struct cmsghdr *cm;
+
+		msg.msg_control    = control;
+		msg.msg_controllen = sizeof(control);
+		if (recvmsg(w->fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+			break;
+
+		for (cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+			uint32_t lo, hi;
+			size_t i;
+
+			if (!((cm->cmsg_level == SOL_IP   && cm->cmsg_type == IP_RECVERR) ||
+			      (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)))
+				continue;
+
+			ee = (struct sock_extended_err *)CMSG_DATA(cm);
+			if (ee->ee_errno != 0 || ee->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+				continue;
+
+			/* Kernel had to copy anyway, e.g. loopback, stop trying */
+			if (ee->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+				zc->enabled = 0;
+
+			/* Range of ids, inclusive, may wrap around */
+			lo = ee->ee_info;
+			hi = ee->ee_data;
+			for (i = 0; i < zc->num; i++) {
+				struct uev_zc_req *req = &zc->req[i];
+
+				if (!req->copied && req->id - lo <= hi - lo)
+					req->done = 1;
+			}
+			num++;
+		}
+	}
+
+	zc_pop(w);
+
+	return num;
+}
+
+/* Private to libuEv, do not use directly! */
+void _uev_io_zc_free(uev_t *w)
+{
+	struct uev_zc *zc;
+	size_t i;
+
+	if (!w || !w->zc)
+		return;
+
+	_uev_io_zc_reap(w);
+
+	/* Return ownership of whatever is left, we cannot track it anymore */
+	zc = w->zc;
+	w->zc = NULL;
+	for (i = 0; i < zc->num; i++) {
+		if (zc->req[i].cb)
+			zc->req[i].cb(w, zc->req[i].arg, zc->req[i].buf, zc->req[i].len);
+	}
+
+	free(zc->req);
+	free(zc);
+}
+
+/**
+ * Send data on a socket without copying it to the kernel
+ * @param w    Active I/O watcher for a connected socket
+ * @param buf  Data to send, must not be modified until @param cb is called
+ * @param len  Length of @param buf
+ * @param cb   Completion callback, called when @param buf is released
+ * @param arg  Optional completion callback argument
+ *
+ * Uses MSG_ZEROCOPY to pin the pages of @param buf instead of copying
+ * them.  Completions are read from the socket error queue by the event
+ * loop, without waking up the watcher callback, and @param cb is called
+ * in send order.  Like send(), fewer bytes than requested may be sent;
+ * @param cb then only covers the part that was sent.
+ *
+ * Sends shorter than %UEV_ZEROCOPY_MIN, sockets that do not support
+ * zero-copy, and sockets where the kernel reports it had to copy anyway,
+ * use a regular send() instead.  In that case @param cb is called before
+ * this function returns, unless earlier zero-copy requests on @param w
+ * are still pending.  Then it is deferred until those complete, so the
+ * callbacks are still called in send order.  The data has already been
+ * copied, but @param buf is not released to @param cb until then.
+ *
+ * When the watcher is stopped, @param cb is called for all outstanding
+ * requests.  Make sure the peer has received all data before stopping
+ * the watcher, the kernel may still reference the pages otherwise.
+ *
+ * @return Number of bytes sent, or -1 with @param errno set on error,
+ * e.g. %EAGAIN, in which case @param cb is not called.
+ */
+ssize_t uev_io_send_zc(uev_t *w, void *buf, size_t len, uev_zc_cb_t *cb, void *arg)
+{
+	struct uev_zc *zc;
+	ssize_t num;
+
+	if (!w || !buf || !len || w->type != UEV_IO_TYPE || !_uev_is_active(w)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	zc = zc_get(w);
+	if (!zc)
+		return -1;
+
+	if (zc->enabled && len >= UEV_ZEROCOPY_MIN) {
+		struct uev_zc_req *req;
+
+		/* Make room first, a send cannot be undone */
+		req = zc_push(zc, buf, len, cb, arg);
+		if (!req)
+			return -1;
+
+		num = send(w->fd, buf, len, MSG_ZEROCOPY | MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (num >= 0) {
+			req->id  = zc->next++;
+			req->len = num;
+			return num;
+		}
+
+		/* Failed sends do not consume a kernel id */
+		zc->num--;
+		if (errno != ENOBUFS)
+			return -1;
+		/* Out of optmem for notifications, copy this one */
+	}
+
+	num = send(w->fd, buf, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+	if (num < 0)
+		return -1;
+
+	/* Complete in send order, after any pending zero-copy requests */
+	if (zc->num) {
+		struct uev_zc_req *req;
+
+		req = zc_push(zc, buf, num, cb, arg);
+		if (req) {
+			req->copied = 1;
+			req->done   = 1;
+			return num;
+		}
+	}
+
+	if (cb)
+		cb(w, arg, buf, num);
+
+	return num;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
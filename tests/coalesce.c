@@ -0,0 +1,113 @@
+/* Verify coalescing of I/O watcher output per event loop iteration */
+#include "check.h"
+#include <fcntl.h>
+#include <sys/socket.h>
+
+static int sd[2], trig[2];
+static int calls;
+static uev_t sock;
+
+static void sock_cb(uev_t *w, void *UNUSED(arg), int events)
+{
+	if (UEV_ERROR == events) {
+		fprintf(stderr, "socket watcher failed, restarting ...\n");
+		uev_io_start(w);
+		return;
+	}
+
+	calls++;
+}
+
+static void trig_cb(uev_t *w, void *UNUSED(arg), int UNUSED(events))
+{
+	char buf[8];
+
+	read(w->fd, buf, sizeof(buf));
+
+	uev_io_write(&sock, "foo", 3);
+	uev_io_write(&sock, "bar", 3);
+	uev_io_write(&sock, "baz", 3);
+
+	/* Nothing sent yet, held until end of iteration */
+	fail_unless(recv(sd[1], buf, sizeof(buf), MSG_DONTWAIT) < 0);
+	fail_unless(uev_io_pending(&sock) == 9);
+}
+
+static int coalesce(void)
+{
+	char buf[16];
+	uev_t w;
+	uev_ctx_t ctx;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sd) || pipe2(trig, O_NONBLOCK))
+		return 1;
+
+	uev_init(&ctx);
+	uev_io_init(&ctx, &sock, sock_cb, NULL, sd[0], UEV_READ);
+	uev_io_init(&ctx, &w, trig_cb, NULL, trig[0], UEV_READ);
+
+	write(trig[1], "x", 1);
+	uev_run(&ctx, UEV_ONCE);
+
+	fail_unless(uev_io_pending(&sock) == 0);
+	fail_unless(recv(sd[1], buf, sizeof(buf), MSG_DONTWAIT) == 9);
+	fail_unless(!memcmp(buf, "foobarbaz", 9));
+
+	/* Opt-out, written immediately */
+	uev_io_coalesce(&sock, -1);
+	uev_io_write(&sock, "qux", 3);
+	fail_unless(recv(sd[1], buf, sizeof(buf), MSG_DONTWAIT) == 3);
+
+	uev_exit(&ctx);
+
+	return 0;
+}
+
+static int leftover(void)
+{
+	static char big[1024 * 1024];
+	size_t total = 0;
+	ssize_t num;
+	uev_ctx_t ctx;
+
+	uev_init(&ctx);
+	uev_io_init(&ctx, &sock, sock_cb, NULL, sd[0], UEV_READ);
+
+	/* More than the socket buffer, a remainder is left */
+	uev_io_write(&sock, big, sizeof(big));
+	fail_unless(uev_io_pending(&sock) > 0);
+
+	calls = 0;
+	while (total < sizeof(big)) {
+		num = recv(sd[1], big, sizeof(big), MSG_DONTWAIT);
+		if (num > 0)
+			total += num;
+
+		uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	}
+
+	/* Remainder written on EPOLLOUT, without waking up the callback */
+	fail_unless(uev_io_pending(&sock) == 0);
+	fail_unless(calls == 0);
+
+	uev_exit(&ctx);
+
+	return 0;
+}
+
+int main(void)
+{
+	int result = 0;
+
+	result += test(coalesce(), "Coalescing writes per iteration");
+	result += test(leftover(), "Flushing remainder when writable");
+
+	return result;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,306 @@
+/* Verify non-blocking connect, timeouts, and the keep-alive pool */
+#include "check.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+static int connected, failed, error, last = -1, want = 1, evicted;
+
+static void connect_cb(uev_t *w, void *UNUSED(arg), int events, int sd)
+{
+	if (events & UEV_ERROR) {
+		fail_unless(sd == -1);
+		error = errno;
+		failed++;
+	} else {
+		fail_unless(sd >= 0);
+		connected++;
+		last = sd;
+	}
+
+	if (connected + failed == want)
+		uev_exit(w->ctx);
+}
+
+/* Fills the accept queue, leaves the loop running */
+static void fill_cb(uev_t *UNUSED(w), void *UNUSED(arg), int UNUSED(events), int UNUSED(sd))
+{
+}
+
+static void exit_cb(uev_t *w, void *UNUSED(arg), int UNUSED(events))
+{
+	uev_exit(w->ctx);
+}
+
+static void evict_cb(uev_t *w, void *arg, int UNUSED(events))
+{
+	evicted = fcntl(*(int *)arg, F_GETFD) < 0 && errno == EBADF;
+	uev_exit(w->ctx);
+}
+
+static int listener(struct sockaddr_in *sin, int backlog)
+{
+	socklen_t len = sizeof(*sin);
+	int sd;
+
+	memset(sin, 0, sizeof(*sin));
+	sin->sin_family      = AF_INET;
+	sin->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	sd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	fail_unless(sd >= 0);
+	fail_unless(!bind(sd, (struct sockaddr *)sin, sizeof(*sin)));
+	fail_unless(!listen(sd, backlog));
+	fail_unless(!getsockname(sd, (struct sockaddr *)sin, &len));
+
+	return sd;
+}
+
+static void reset(void)
+{
+	connected = failed = error = 0;
+	last = -1;
+	want = 1;
+}
+
+static int basic(void)
+{
+	struct sockaddr_in sin;
+	uev_ctx_t ctx;
+	int lsd, sd;
+	uev_t w;
+
+	reset();
+	lsd = listener(&sin, 8);
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_connect(&ctx, &w, connect_cb, NULL, (struct sockaddr *)&sin, sizeof(sin), 1000));
+	uev_run(&ctx, 0);
+	fail_unless(connected == 1 && last >= 0);
+	fail_unless(!uev_connect_active(&w));
+
+	sd = accept(lsd, NULL, NULL);
+	fail_unless(sd >= 0);
+	close(sd);
+	close(last);
+
+	/* Nobody listening any more */
+	reset();
+	close(lsd);
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_connect(&ctx, &w, connect_cb, NULL, (struct sockaddr *)&sin, sizeof(sin), 1000));
+	uev_run(&ctx, 0);
+	fail_unless(failed == 1 && error == ECONNREFUSED);
+
+	return 0;
+}
+
+static int timeout(void)
+{
+	struct sockaddr_in sin;
+	uev_t w, extra[2];
+	uev_ctx_t ctx;
+	int lsd, i;
+
+	/* Fill up the accept queue, SYNs are then dropped */
+	reset();
+	lsd = listener(&sin, 0);
+	fail_unless(!uev_init(&ctx));
+	for (i = 0; i < 2; i++)
+		fail_unless(!uev_connect(&ctx, &extra[i], fill_cb, NULL, (struct sockaddr *)&sin, sizeof(sin), 0));
+	uev_run(&ctx, UEV_ONCE);
+	uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+
+	fail_unless(!uev_connect(&ctx, &w, connect_cb, NULL, (struct sockaddr *)&sin, sizeof(sin), 100));
+	uev_run(&ctx, 0);
+	fail_unless(failed == 1 && error == ETIMEDOUT);
+	close(lsd);
+
+	return 0;
+}
+
+static int order[2], norder;
+
+static void order_cb(uev_t *UNUSED(w), void *arg, int events, int UNUSED(sd))
+{
+	fail_unless(events & UEV_ERROR);
+	order[norder++] = (int)(intptr_t)arg;
+}
+
+/* Expire in timeout order, and the timer stops with the last connect */
+static int deadline(void)
+{
+	struct sockaddr_in sin;
+	uev_t w[2], extra[2];
+	uev_ctx_t ctx;
+	int lsd, i;
+	time_t start;
+
+	reset();
+	lsd = listener(&sin, 0);
+	fail_unless(!uev_init(&ctx));
+	for (i = 0; i < 2; i++)
+		fail_unless(!uev_connect(&ctx, &extra[i], fill_cb, NULL, (struct sockaddr *)&sin, sizeof(sin), 0));
+	uev_run(&ctx, UEV_ONCE);
+	uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	for (i = 0; i < 2; i++)
+		uev_connect_stop(&extra[i]);
+
+	fail_unless(!uev_connect(&ctx, &w[0], order_cb, (void *)0, (struct sockaddr *)&sin, sizeof(sin), 200));
+	fail_unless(!uev_connect(&ctx, &w[1], order_cb, (void *)1, (struct sockaddr *)&sin, sizeof(sin), 100));
+
+	/* Nothing else to wait for, returns after the last timeout */
+	start = time(NULL);
+	fail_unless(!uev_run(&ctx, 0));
+	fail_unless(time(NULL) - start <= 1);
+	fail_unless(norder == 2 && order[0] == 1 && order[1] == 0);
+	close(lsd);
+
+	/* Connected long before the timeout, the timer does not linger */
+	lsd = listener(&sin, 8);
+	fail_unless(!uev_connect(&ctx, &w[0], fill_cb, NULL, (struct sockaddr *)&sin, sizeof(sin), 10000));
+	start = time(NULL);
+	fail_unless(!uev_run(&ctx, 0));
+	fail_unless(time(NULL) - start <= 1);
+
+	uev_exit(&ctx);
+	close(lsd);
+
+	return 0;
+}
+
+static int many(void)
+{
+	uev_connect_spec_t c[3];
+	struct sockaddr_in sin;
+	uev_t w[3], stop;
+	uev_ctx_t ctx;
+	int lsd, i, timers = 0;
+	uev_t *t;
+
+	reset();
+	want = 3;
+	lsd = listener(&sin, 8);
+	fail_unless(!uev_init(&ctx));
+	for (i = 0; i < 3; i++) {
+		c[i].w   = &w[i];
+		c[i].sa  = (struct sockaddr *)&sin;
+		c[i].len = sizeof(sin);
+		c[i].cb  = connect_cb;
+		c[i].arg = NULL;
+	}
+
+	c[2].cb = NULL;
+	fail_unless(uev_connect_many(&ctx, c, 3, 1000) && errno == EINVAL);
+	c[2].cb = connect_cb;
+	fail_unless(!uev_connect_many(&ctx, c, 3, 1000));
+
+	/* One timer for all of them */
+	LIST_FOREACH(t, &ctx.watchers, link) {
+		if (t->type == UEV_TIMER_TYPE)
+			timers++;
+	}
+	fail_unless(timers == 1);
+
+	fail_unless(!uev_timer_init(&ctx, &stop, exit_cb, NULL, 1000, 0));
+	uev_run(&ctx, 0);
+	fail_unless(connected == 3);
+	close(lsd);
+
+	return 0;
+}
+
+static int pool(void)
+{
+	struct sockaddr_in sin;
+	uev_t w, stop;
+	uev_ctx_t ctx;
+	int lsd, sd, peer;
+
+	reset();
+	lsd = listener(&sin, 8);
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_connect_get(&ctx, &w, connect_cb, NULL, (struct sockaddr *)&sin, sizeof(sin), 1000));
+	uev_run(&ctx, 0);
+	fail_unless(connected == 1);
+	sd = last;
+	peer = accept(lsd, NULL, NULL);
+	fail_unless(peer >= 0);
+
+	/* Reused, no new connection to accept */
+	reset();
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_connect_put(&ctx, sd, 1000));
+	fail_unless(!uev_connect_get(&ctx, &w, connect_cb, NULL, (struct sockaddr *)&sin, sizeof(sin), 1000));
+	uev_run(&ctx, 0);
+	fail_unless(connected == 1 && last == sd);
+	fail_unless(accept(lsd, NULL, NULL) < 0 && errno == EAGAIN);
+
+	/* Closed by the peer while idle, a new connection is made */
+	reset();
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_connect_put(&ctx, sd, 1000));
+	close(peer);
+	fail_unless(!uev_connect_get(&ctx, &w, connect_cb, NULL, (struct sockaddr *)&sin, sizeof(sin), 1000));
+	uev_run(&ctx, 0);
+	fail_unless(connected == 1);
+	peer = accept(lsd, NULL, NULL);
+	fail_unless(peer >= 0);
+	close(peer);
+
+	/* Evicted when idle too long */
+	sd = last;
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_connect_put(&ctx, sd, 50));
+	fail_unless(!uev_timer_init(&ctx, &stop, evict_cb, &sd, 200, 0));
+	uev_run(&ctx, 0);
+	fail_unless(evicted);
+
+	close(lsd);
+
+	return 0;
+}
+
+static int cancel(void)
+{
+	struct sockaddr_in sin;
+	uev_t w, stop;
+	uev_ctx_t ctx;
+	int lsd;
+
+	reset();
+	lsd = listener(&sin, 8);
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_connect(&ctx, &w, connect_cb, NULL, (struct sockaddr *)&sin, sizeof(sin), 1000));
+	fail_unless(!uev_connect_stop(&w));
+	fail_unless(!uev_timer_init(&ctx, &stop, exit_cb, NULL, 100, 0));
+	uev_run(&ctx, 0);
+	fail_unless(connected == 0 && failed == 0);
+
+	uev_exit(&ctx);
+	close(lsd);
+
+	return 0;
+}
+
+int main(void)
+{
+	int result = 0;
+
+	result += test(basic(), "connect, connected and refused");
+	result += test(timeout(), "connect, timeout");
+	result += test(deadline(), "connect, timeouts in order");
+	result += test(many(), "connect, batch with one timer");
+	result += test(pool(), "connect, keep-alive pool reuse and eviction");
+	result += test(cancel(), "connect, cancel in progress");
+
+	return result;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
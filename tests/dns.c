@@ -0,0 +1,285 @@
+/* Verify DNS stub resolver against a fake name server on localhost */
+#include "check.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+static int served, done, error, num;
+static uev_dns_rr_t rr[4];
+
+/* Append name without compression */
+static size_t put_name(unsigned char *p, const char *name)
+{
+	size_t len = 0;
+
+	while (*name) {
+		const char *dot = strchr(name, '.');
+		size_t n = dot ? (size_t)(dot - name) : strlen(name);
+
+		p[len++] = n;
+		memcpy(&p[len], name, n);
+		len  += n;
+		name += n + (dot ? 1 : 0);
+	}
+	p[len++] = 0;
+
+	return len;
+}
+
+/* Resource record header, owner name is a pointer to the question */
+static size_t put_rr(unsigned char *p, int type, uint32_t ttl, size_t rdlen)
+{
+	unsigned char hdr[12] = { 0xc0, 12, type >> 8, type & 0xff, 0, 1,
+				  ttl >> 24, ttl >> 16, ttl >> 8, ttl, rdlen >> 8, rdlen & 0xff };
+
+	memcpy(p, hdr, sizeof(hdr));
+
+	return sizeof(hdr);
+}
+
+static void server_cb(uev_t *w, void *UNUSED(arg), int UNUSED(events))
+{
+	struct sockaddr_storage ss;
+	socklen_t sslen = sizeof(ss);
+	unsigned char buf[1500];
+	char name[256] = { 0 };
+	size_t off = 12, pos = 0, len;
+	int type, an = 0, ns = 0, rcode = 0;
+	ssize_t n;
+
+	n = recvfrom(w->fd, buf, sizeof(buf), 0, (struct sockaddr *)&ss, &sslen);
+	if (n < 12)
+		return;
+
+	while (buf[off]) {
+		memcpy(&name[pos], &buf[off + 1], buf[off]);
+		pos += buf[off];
+		name[pos++] = '.';
+		off += buf[off] + 1;
+	}
+	name[pos - 1] = 0;
+	type = (buf[off + 1] << 8) | buf[off + 2];
+	len  = off + 5;
+	served++;
+
+	if (!strcmp(name, "slow.example.com"))
+		return;
+
+	if (!strcmp(name, "www.example.com") && type == UEV_DNS_A) {
+		len += put_rr(&buf[len], UEV_DNS_A, 300, 4);
+		inet_pton(AF_INET, "192.0.2.1", &buf[len]);
+		len += 4;
+		an = 1;
+	} else if (!strcmp(name, "www.example.com") && type == UEV_DNS_AAAA) {
+		len += put_rr(&buf[len], UEV_DNS_AAAA, 300, 16);
+		inet_pton(AF_INET6, "2001:db8::1", &buf[len]);
+		len += 16;
+		an = 1;
+	} else if (!strcmp(name, "alias.example.com") && type == UEV_DNS_A) {
+		len += put_rr(&buf[len], 5, 300, 2);	/* CNAME, to itself */
+		buf[len++] = 0xc0;
+		buf[len++] = 12;
+		len += put_rr(&buf[len], UEV_DNS_A, 60, 4);
+		inet_pton(AF_INET, "192.0.2.3", &buf[len]);
+		len += 4;
+		an = 2;
+	} else if (!strcmp(name, "zero.example.com") && type == UEV_DNS_A) {
+		len += put_rr(&buf[len], UEV_DNS_A, 0, 4);
+		inet_pton(AF_INET, "192.0.2.2", &buf[len]);
+		len += 4;
+		an = 1;
+	} else if (!strcmp(name, "_sip._udp.example.com") && type == UEV_DNS_SRV) {
+		size_t rdlen = put_name(&buf[len + 12 + 6], "sip.example.com") + 6;
+
+		len += put_rr(&buf[len], UEV_DNS_SRV, 300, rdlen);
+		memcpy(&buf[len], "\x00\x0a\x00\x05\x13\xc4", 6);
+		len += rdlen;
+		an = 1;
+	} else {
+		/* NXDOMAIN, with SOA for negative caching */
+		rcode = 3;
+		len += put_rr(&buf[len], 6, 3600, 22);
+		memset(&buf[len], 0, 22);
+		buf[len + 21] = 60;
+		len += 22;
+		ns = 1;
+	}
+
+	buf[2] = 0x81;
+	buf[3] = 0x80 | rcode;
+	buf[7] = an;
+	buf[9] = ns;
+	buf[11] = 0;
+	sendto(w->fd, buf, len, 0, (struct sockaddr *)&ss, sslen);
+}
+
+static void answer_cb(uev_t *UNUSED(w), void *UNUSED(arg), const uev_dns_rr_t *r, int n)
+{
+	num = n;
+	if (n < 0) {
+		fail_unless(!r);
+		error = errno;
+	} else if (n) {
+		memcpy(rr, r, (n > 4 ? 4 : n) * sizeof(*r));
+	}
+	done++;
+}
+
+static void timeout_cb(uev_t *UNUSED(w), void *arg, const uev_dns_rr_t *UNUSED(r), int n)
+{
+	fail_unless(n == -1 && errno == ETIMEDOUT);
+	fail_unless(done == *(int *)arg);
+	done++;
+}
+
+/* Run until @n more answers */
+static void wait_for(uev_ctx_t *ctx, int n)
+{
+	int i;
+
+	n += done;
+	for (i = 0; i < 1000 && done < n; i++)
+		uev_run(ctx, UEV_ONCE);
+}
+
+static int setup(uev_ctx_t *ctx, uev_t *server, uev_t *dns)
+{
+	struct sockaddr_in sin = { .sin_family = AF_INET };
+	socklen_t len = sizeof(sin);
+	int sd;
+
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	sd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+	fail_unless(sd >= 0);
+	fail_unless(!bind(sd, (struct sockaddr *)&sin, sizeof(sin)));
+	fail_unless(!getsockname(sd, (struct sockaddr *)&sin, &len));
+
+	fail_unless(!uev_init(ctx));
+	fail_unless(!uev_io_init(ctx, server, server_cb, NULL, sd, UEV_READ));
+	fail_unless(!uev_dns_init(ctx, dns, (struct sockaddr *)&sin, sizeof(sin)));
+
+	served = done = 0;
+
+	return sd;
+}
+
+static int records(void)
+{
+	struct in6_addr a6;
+	uev_t server, dns;
+	uev_ctx_t ctx;
+	int sd;
+
+	sd = setup(&ctx, &server, &dns);
+	fail_unless(uev_dns_query(&dns, "www.example.com", 15, 1000, answer_cb, NULL) && errno == EINVAL);
+	fail_unless(uev_dns_query(&dns, "www..example.com", UEV_DNS_A, 1000, answer_cb, NULL) && errno == EINVAL);
+
+	fail_unless(!uev_dns_query(&dns, "WWW.Example.com.", UEV_DNS_A, 1000, answer_cb, NULL));
+	wait_for(&ctx, 1);
+	fail_unless(num == 1 && rr[0].type == UEV_DNS_A && rr[0].ttl == 300);
+	fail_unless(rr[0].u.a.s_addr == inet_addr("192.0.2.1"));
+
+	fail_unless(!uev_dns_query(&dns, "www.example.com", UEV_DNS_AAAA, 1000, answer_cb, NULL));
+	wait_for(&ctx, 1);
+	inet_pton(AF_INET6, "2001:db8::1", &a6);
+	fail_unless(num == 1 && !memcmp(&rr[0].u.aaaa, &a6, sizeof(a6)));
+
+	fail_unless(!uev_dns_query(&dns, "alias.example.com", UEV_DNS_A, 1000, answer_cb, NULL));
+	wait_for(&ctx, 1);
+	fail_unless(num == 1 && rr[0].u.a.s_addr == inet_addr("192.0.2.3"));
+
+	fail_unless(!uev_dns_query(&dns, "_sip._udp.example.com", UEV_DNS_SRV, 1000, answer_cb, NULL));
+	wait_for(&ctx, 1);
+	fail_unless(num == 1 && rr[0].u.srv.prio == 10 && rr[0].u.srv.weight == 5);
+	fail_unless(rr[0].u.srv.port == 5060 && !strcmp(rr[0].u.srv.target, "sip.example.com"));
+
+	uev_exit(&ctx);
+	close(sd);
+
+	return 0;
+}
+
+static int cache(void)
+{
+	uev_t server, dns;
+	uev_ctx_t ctx;
+	int sd, i;
+
+	sd = setup(&ctx, &server, &dns);
+
+	/* Coalesced into one query */
+	for (i = 0; i < 3; i++)
+		fail_unless(!uev_dns_query(&dns, "www.example.com", UEV_DNS_A, 1000, answer_cb, NULL));
+	wait_for(&ctx, 3);
+	fail_unless(done == 3 && served == 1);
+
+	/* Cached, answered right away */
+	fail_unless(!uev_dns_query(&dns, "www.example.com", UEV_DNS_A, 1000, answer_cb, NULL));
+	fail_unless(done == 4 && served == 1 && num == 1);
+
+	/* Zero TTL, never cached */
+	for (i = 0; i < 2; i++) {
+		fail_unless(!uev_dns_query(&dns, "zero.example.com", UEV_DNS_A, 1000, answer_cb, NULL));
+		wait_for(&ctx, 1);
+		fail_unless(num == 1 && rr[0].u.a.s_addr == inet_addr("192.0.2.2"));
+	}
+	fail_unless(served == 3);
+
+	/* Negative caching */
+	fail_unless(!uev_dns_query(&dns, "gone.example.com", UEV_DNS_A, 1000, answer_cb, NULL));
+	wait_for(&ctx, 1);
+	fail_unless(num == -1 && error == ENOENT && served == 4);
+	error = 0;
+	fail_unless(!uev_dns_query(&dns, "gone.example.com", UEV_DNS_A, 1000, answer_cb, NULL));
+	fail_unless(num == -1 && error == ENOENT && served == 4);
+
+	uev_exit(&ctx);
+	close(sd);
+
+	return 0;
+}
+
+static int timeout(void)
+{
+	static int first = 0, second = 1;
+	uev_t server, dns;
+	uev_ctx_t ctx;
+	int sd;
+
+	sd = setup(&ctx, &server, &dns);
+
+	/* Same query, each waiter with its own timeout */
+	fail_unless(!uev_dns_query(&dns, "slow.example.com", UEV_DNS_A, 300, timeout_cb, &second));
+	fail_unless(!uev_dns_query(&dns, "slow.example.com", UEV_DNS_A, 100, timeout_cb, &first));
+	wait_for(&ctx, 2);
+	fail_unless(done == 2 && served == 1);
+
+	/* Stopped with a query in flight, no callback */
+	fail_unless(!uev_dns_query(&dns, "slow.example.com", UEV_DNS_A, 100, timeout_cb, &first));
+	fail_unless(!uev_dns_stop(&dns));
+	fail_unless(uev_dns_query(&dns, "www.example.com", UEV_DNS_A, 100, answer_cb, NULL) && errno == EINVAL);
+
+	uev_exit(&ctx);
+	close(sd);
+
+	return 0;
+}
+
+int main(void)
+{
+	int result = 0;
+
+	result += test(records(), "dns, A, AAAA, CNAME, and SRV records");
+	result += test(cache(), "dns, coalescing, TTL and negative caching");
+	result += test(timeout(), "dns, per-query timeouts");
+
+	return result;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
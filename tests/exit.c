@@ -0,0 +1,66 @@
+/* Verify uev_exit() stops all watchers, closing only libuEv descriptors */
+#include "check.h"
+#include <errno.h>
+#include <fcntl.h>
+
+static void cb(uev_t *UNUSED(w), void *UNUSED(arg), int UNUSED(events))
+{
+}
+
+static void exit_cb(uev_t *w, void *UNUSED(arg), int UNUSED(events))
+{
+	uev_exit(w->ctx);
+}
+
+static int teardown(int flags)
+{
+	uev_ctx_t ctx;
+	uev_t io, timer, stop;
+	int fd[2], tfd;
+
+	fail_unless(!uev_init1(&ctx, flags));
+	fail_unless(!pipe(fd));
+	fail_unless(!uev_io_init(&ctx, &io, cb, NULL, fd[0], UEV_READ));
+	fail_unless(!uev_timer_init(&ctx, &timer, cb, NULL, 10000, 0));
+	fail_unless(!uev_timer_init(&ctx, &stop, exit_cb, NULL, 10, 0));
+	tfd = timer.fd;
+
+	fail_unless(!uev_run(&ctx, 0));
+	fail_unless(!uev_io_active(&io));
+	fail_unless(!uev_timer_active(&timer));
+	fail_unless(!uev_timer_active(&stop));
+	fail_unless(LIST_EMPTY(&ctx.watchers));
+
+	/* Application descriptors are left open, timerfd is closed */
+	fail_unless(fcntl(fd[0], F_GETFD) != -1);
+	fail_unless(fcntl(tfd, F_GETFD) == -1 && errno == EBADF);
+	fail_unless(timer.fd == -1);
+
+	/* Watchers can be reused in a new context */
+	fail_unless(!uev_init1(&ctx, flags));
+	fail_unless(!uev_io_init(&ctx, &io, cb, NULL, fd[0], UEV_READ));
+	fail_unless(uev_io_active(&io));
+	fail_unless(!uev_exit(&ctx));
+
+	close(fd[0]);
+	close(fd[1]);
+
+	return 0;
+}
+
+int main(void)
+{
+	int result = 0;
+
+	result += test(teardown(0), "uev_exit() with epoll");
+	result += test(teardown(UEV_INIT_POLL), "uev_exit() with poll()");
+
+	return result;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
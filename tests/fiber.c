@@ -0,0 +1,136 @@
+/* Verify fibers, waiting for I/O and timers, nesting, and uev_exit() */
+#include "check.h"
+#include <errno.h>
+#include <sys/socket.h>
+#include <time.h>
+
+#define ROUNDS 1000
+
+static int sv[2], pings, pongs, slept, nested, finished;
+
+static void ping(uev_ctx_t *ctx, void *UNUSED(arg))
+{
+	char c;
+	int i;
+
+	for (i = 0; i < ROUNDS; i++) {
+		fail_unless(write(sv[0], "p", 1) == 1);
+		fail_unless(uev_fiber_wait_io(ctx, sv[0], UEV_READ) == UEV_READ);
+		fail_unless(read(sv[0], &c, 1) == 1 && c == 'P');
+		pings++;
+	}
+	finished++;
+}
+
+static void pong(uev_ctx_t *ctx, void *UNUSED(arg))
+{
+	char c;
+	int i;
+
+	for (i = 0; i < ROUNDS; i++) {
+		fail_unless(uev_fiber_wait_io(ctx, sv[1], UEV_READ) == UEV_READ);
+		fail_unless(read(sv[1], &c, 1) == 1 && c == 'p');
+		fail_unless(write(sv[1], "P", 1) == 1);
+		pongs++;
+	}
+	finished++;
+}
+
+static void inner(uev_ctx_t *UNUSED(ctx), void *arg)
+{
+	int *depth = arg;
+
+	/* Runs at once, on its own stack */
+	nested = *depth + 1;
+}
+
+static void sleeper(uev_ctx_t *ctx, void *UNUSED(arg))
+{
+	int depth = 1;
+
+	fail_unless(!uev_fiber_sleep(ctx, 10));
+	fail_unless(!uev_fiber_spawn(ctx, inner, &depth, 0));
+	fail_unless(nested == 2);
+	fail_unless(!uev_fiber_sleep(ctx, 10));
+	slept++;
+	finished++;
+}
+
+static void quick(uev_ctx_t *UNUSED(ctx), void *UNUSED(arg))
+{
+	finished++;
+}
+
+static void exiter(uev_ctx_t *ctx, void *UNUSED(arg))
+{
+	fail_unless(!uev_fiber_sleep(ctx, 1));
+	uev_exit(ctx);
+
+	/* The context is gone */
+	fail_unless(uev_fiber_sleep(ctx, 1) == -1);
+	finished++;
+}
+
+static void waiter(uev_ctx_t *ctx, void *UNUSED(arg))
+{
+	uev_fiber_wait_io(ctx, sv[1], UEV_READ);
+	fail_unless(0);
+}
+
+static int fibers(void)
+{
+	struct timespec start, end;
+	uev_ctx_t ctx;
+	int i;
+
+	fail_unless(!socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+	uev_init(&ctx);
+
+	/* Only from a fiber */
+	fail_unless(uev_fiber_sleep(&ctx, 1) == -1 && errno == EINVAL);
+	fail_unless(uev_fiber_wait_io(&ctx, sv[0], UEV_READ) == -1 && errno == EINVAL);
+
+	/* Done before uev_run(), stacks are reused */
+	for (i = 0; i < 200; i++)
+		fail_unless(!uev_fiber_spawn(&ctx, quick, NULL, 0));
+	fail_unless(finished == 200);
+	finished = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	fail_unless(!uev_fiber_spawn(&ctx, pong, NULL, 0));
+	fail_unless(!uev_fiber_spawn(&ctx, ping, NULL, 64 * 1024));
+	fail_unless(!uev_fiber_spawn(&ctx, sleeper, NULL, 0));
+
+	/* Returns when no fiber is waiting */
+	fail_unless(!uev_run(&ctx, 0));
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	fail_unless(pings == ROUNDS && pongs == ROUNDS);
+	fail_unless(slept == 1 && nested == 2);
+	fail_unless(finished == 3);
+	fail_unless((end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000 >= 20);
+
+	/* From a fiber, with another one waiting */
+	finished = 0;
+	fail_unless(!uev_fiber_spawn(&ctx, waiter, NULL, 0));
+	fail_unless(!uev_fiber_spawn(&ctx, exiter, NULL, 0));
+	fail_unless(!uev_run(&ctx, 0));
+	fail_unless(finished == 1);
+
+	close(sv[0]);
+	close(sv[1]);
+
+	return 0;
+}
+
+int main(void)
+{
+	return test(fibers(), "Fibers, I/O, timers, and uev_exit()");
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,123 @@
+/* Verify asynchronous file I/O on both io_uring and the thread pool */
+#include "check.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+
+#define NUM 8
+
+static char data[NUM][4096];
+static char back[NUM][4096];
+static int written, synced, readback, errors;
+
+static void read_cb(uev_t *UNUSED(w), void *UNUSED(arg), void *buf, ssize_t res)
+{
+	fail_unless(res == sizeof(back[0]));
+	fail_unless(buf != NULL);
+	readback++;
+}
+
+static void fsync_cb(uev_t *w, void *UNUSED(arg), void *buf, ssize_t res)
+{
+	int i;
+
+	fail_unless(res == 0);
+	fail_unless(buf == NULL);
+	synced++;
+
+	/* Read back in reverse order, completions may arrive in any order */
+	for (i = NUM - 1; i >= 0; i--)
+		fail_unless(!uev_file_read(w, back[i], sizeof(back[i]), i * sizeof(back[i]), read_cb, NULL));
+}
+
+static void write_cb(uev_t *w, void *UNUSED(arg), void *UNUSED(buf), ssize_t res)
+{
+	fail_unless(res == sizeof(data[0]));
+	if (++written == NUM)
+		fail_unless(!uev_file_fsync(w, fsync_cb, NULL));
+}
+
+static void error_cb(uev_t *UNUSED(w), void *UNUSED(arg), void *UNUSED(buf), ssize_t res)
+{
+	fail_unless(res == -1);
+	fail_unless(errno == EBADF);
+	errors++;
+}
+
+static int file(int backend)
+{
+	char tmpl[] = "/tmp/uev-file.XXXXXX";
+	uev_ctx_t ctx;
+	uev_t w, ro, io;
+	int fd, i, pv[2];
+
+	fd = mkstemp(tmpl);
+	fail_unless(fd >= 0);
+	unlink(tmpl);
+
+	for (i = 0; i < NUM; i++)
+		memset(data[i], 'a' + i, sizeof(data[i]));
+	memset(back, 0, sizeof(back));
+	written = synced = readback = errors = 0;
+
+	uev_init(&ctx);
+	if (uev_file_backend(&ctx, backend) != backend) {
+		fprintf(stderr, "backend %d not available, skipping ...\n", backend);
+		uev_exit(&ctx);
+		close(fd);
+		return 0;
+	}
+
+	uev_file_init(&ctx, &w, fd);
+	for (i = 0; i < NUM; i++)
+		fail_unless(!uev_file_write(&w, data[i], sizeof(data[i]), i * sizeof(data[i]), write_cb, NULL));
+
+	/* Reading from a write-only descriptor fails in the callback */
+	uev_file_init(&ctx, &ro, open("/dev/null", O_WRONLY));
+	fail_unless(!uev_file_read(&ro, back[0], 1, 0, error_cb, NULL));
+
+	/* Longer than an io_uring request can describe */
+	if (sizeof(size_t) > 4)
+		fail_unless(uev_file_read(&ro, back[0], (size_t)UINT32_MAX + 1, 0, error_cb, NULL) && errno == EINVAL);
+
+	/* Only file watchers take requests */
+	fail_unless(!pipe(pv));
+	fail_unless(!uev_io_init(&ctx, &io, NULL, NULL, pv[0], UEV_READ));
+	fail_unless(uev_file_write(&io, data[0], 1, 0, error_cb, NULL) && errno == EINVAL);
+	fail_unless(uev_file_fsync(&io, error_cb, NULL) && errno == EINVAL);
+	uev_io_stop(&io);
+	close(pv[0]);
+	close(pv[1]);
+
+	/* Returns when all requests have completed */
+	fail_unless(!uev_run(&ctx, 0));
+
+	fail_unless(written == NUM);
+	fail_unless(synced == 1);
+	fail_unless(readback == NUM);
+	fail_unless(errors == 1);
+	fail_unless(!memcmp(data, back, sizeof(data)));
+
+	uev_exit(&ctx);
+	close(ro.fd);
+	close(fd);
+
+	return 0;
+}
+
+int main(void)
+{
+	int result = 0;
+
+	result += test(file(UEV_FILE_URING), "Asynchronous file I/O, io_uring");
+	result += test(file(UEV_FILE_THREADS), "Asynchronous file I/O, threads");
+
+	return result;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,281 @@
+/* Verify length prefixed frame watcher and SO_RCVLOWAT wakeups */
+#include "check.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+static size_t lens[32];
+static int frames, last, error;
+
+static void frame_cb(uev_t *UNUSED(w), void *UNUSED(arg), int events, uev_buf_t *buf)
+{
+	size_t i;
+
+	last = events;
+	if (!buf) {
+		error = errno;
+		return;
+	}
+
+	for (i = 0; i < buf->len; i++)
+		fail_unless(buf->data[i] == (char)('a' + frames));
+	lens[frames++] = buf->len;
+}
+
+static void tcp_pair(int sv[2])
+{
+	struct sockaddr_in sin = { .sin_family = AF_INET };
+	socklen_t len = sizeof(sin);
+	int lsd;
+
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	lsd = socket(AF_INET, SOCK_STREAM, 0);
+	fail_unless(lsd >= 0);
+	fail_unless(!bind(lsd, (struct sockaddr *)&sin, sizeof(sin)));
+	fail_unless(!listen(lsd, 1));
+	fail_unless(!getsockname(lsd, (struct sockaddr *)&sin, &len));
+
+	sv[1] = socket(AF_INET, SOCK_STREAM, 0);
+	fail_unless(!connect(sv[1], (struct sockaddr *)&sin, sizeof(sin)));
+	sv[0] = accept4(lsd, NULL, NULL, SOCK_NONBLOCK);
+	fail_unless(sv[0] >= 0);
+	close(lsd);
+}
+
+/* Send len bytes of a frame with payload pattern ch, starting at off */
+static void send_frame(int sd, char ch, uint32_t size, size_t off, size_t len)
+{
+	char buf[4 + 2048];
+	uint32_t hdr = htonl(size);
+
+	memcpy(buf, &hdr, 4);
+	memset(buf + 4, ch, size);
+	fail_unless(write(sd, buf + off, len) == (ssize_t)len);
+}
+
+static int rcvlowat(void)
+{
+	uev_ctx_t ctx;
+	int sv[2], val;
+	socklen_t len = sizeof(val);
+	uev_t w;
+
+	frames = 0;
+	tcp_pair(sv);
+	fail_unless(!uev_init(&ctx));
+	fail_unless(uev_frame_init(&ctx, &w, frame_cb, NULL, sv[0], 3, 2048) && errno == EINVAL);
+	fail_unless(!uev_frame_init(&ctx, &w, frame_cb, NULL, sv[0], 4, 2048));
+
+	/* Header and part of the payload */
+	send_frame(sv[1], 'a', 1000, 0, 304);
+	uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	fail_unless(frames == 0);
+	fail_unless(!getsockopt(sv[0], SOL_SOCKET, SO_RCVLOWAT, &val, &len));
+	fail_unless(val == 700);
+
+	/* Not enough for the rest of the frame, no wakeup */
+	send_frame(sv[1], 'a', 1000, 304, 200);
+	uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	fail_unless(!ioctl(sv[0], FIONREAD, &val));
+	fail_unless(val == 200);
+
+	/* Pausing keeps the partial frame */
+	fail_unless(!uev_io_stop(&w));
+	fail_unless(!uev_io_start(&w));
+
+	/* The rest, and another frame */
+	send_frame(sv[1], 'a', 1000, 504, 500);
+	send_frame(sv[1], 'b', 10, 0, 14);
+	uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	fail_unless(frames == 2);
+	fail_unless(lens[0] == 1000 && lens[1] == 10);
+
+	/* Stopping for good restores the default */
+	fail_unless(uev_frame_stop(NULL) && errno == EINVAL);
+	fail_unless(!uev_frame_stop(&w));
+	len = sizeof(val);
+	fail_unless(!getsockopt(sv[0], SOL_SOCKET, SO_RCVLOWAT, &val, &len));
+	fail_unless(val == 1);
+
+	uev_exit(&ctx);
+	close(sv[0]);
+	close(sv[1]);
+
+	return 0;
+}
+
+/* More than a batch of small frames queued behind a large one */
+static int batch(void)
+{
+	uev_ctx_t ctx;
+	int sv[2], i;
+	uev_t w;
+
+	frames = 0;
+	tcp_pair(sv);
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_frame_init(&ctx, &w, frame_cb, NULL, sv[0], 4, 2048));
+
+	/* Mark is raised for the rest of the large payload */
+	send_frame(sv[1], 'a', 1000, 0, 304);
+	uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	fail_unless(frames == 0);
+
+	send_frame(sv[1], 'a', 1000, 304, 700);
+	for (i = 1; i < 17; i++)
+		send_frame(sv[1], 'a' + i, 10, 0, 14);
+	uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	fail_unless(frames == 16);
+
+	/* The last small frame is less than the old mark */
+	uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	fail_unless(frames == 17);
+
+	uev_exit(&ctx);
+	close(sv[0]);
+	close(sv[1]);
+
+	return 0;
+}
+
+static int hangup(void)
+{
+	uev_ctx_t ctx;
+	int sv[2];
+	uev_t w;
+
+	/* Peer closes after a whole frame */
+	frames = error = 0;
+	tcp_pair(sv);
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_frame_init(&ctx, &w, frame_cb, NULL, sv[0], 4, 2048));
+	send_frame(sv[1], 'a', 100, 0, 104);
+	close(sv[1]);
+	uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	fail_unless(frames == 1);
+	fail_unless((last & UEV_HUP) && !(last & UEV_ERROR));
+	uev_io_stop(&w);
+	close(sv[0]);
+
+	/* Peer closes mid-frame */
+	frames = 0;
+	tcp_pair(sv);
+	fail_unless(!uev_frame_init(&ctx, &w, frame_cb, NULL, sv[0], 4, 2048));
+	send_frame(sv[1], 'a', 100, 0, 54);
+	uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	close(sv[1]);
+	uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	fail_unless(frames == 0);
+	fail_unless((last & UEV_HUP) && (last & UEV_ERROR) && error == EPROTO);
+
+	uev_exit(&ctx);
+	close(sv[0]);
+
+	return 0;
+}
+
+/* Hangup with the end of a frame, and one more, still unread */
+static int lastframe(void)
+{
+	unsigned char buf[] = { 4, 'a', 'a', 'a', 'a', 2, 'b', 'b' };
+	uev_ctx_t ctx;
+	int sv[2];
+	uev_t w;
+
+	frames = error = 0;
+	fail_unless(!socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv));
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_frame_init(&ctx, &w, frame_cb, NULL, sv[0], 1, 16));
+
+	fail_unless(write(sv[1], buf, 3) == 3);
+	uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	fail_unless(frames == 0);
+
+	fail_unless(write(sv[1], buf + 3, sizeof(buf) - 3) == sizeof(buf) - 3);
+	close(sv[1]);
+	uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	fail_unless(frames == 2);
+	fail_unless(lens[0] == 4 && lens[1] == 2);
+	fail_unless((last & UEV_HUP) && !(last & UEV_ERROR));
+	fail_unless(!uev_io_active(&w));
+
+	uev_exit(&ctx);
+	close(sv[0]);
+
+	return 0;
+}
+
+static int oversized(void)
+{
+	unsigned char hdr[2] = { 0, 17 };
+	uev_ctx_t ctx;
+	int sv[2];
+	uev_t w;
+
+	frames = error = 0;
+	fail_unless(!socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv));
+	fail_unless(!uev_init(&ctx));
+	fail_unless(uev_frame_init(&ctx, &w, frame_cb, NULL, sv[0], 2, UEV_FRAME_MAX + 1) && errno == ERANGE);
+	fail_unless(!uev_frame_init(&ctx, &w, frame_cb, NULL, sv[0], 2, 16));
+	fail_unless(write(sv[1], hdr, 2) == 2);
+	uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	fail_unless(frames == 0 && (last & UEV_ERROR) && error == EMSGSIZE);
+	fail_unless(!uev_io_active(&w));
+
+	uev_exit(&ctx);
+	close(sv[0]);
+	close(sv[1]);
+
+	return 0;
+}
+
+/* UNIX sockets ignore SO_RCVLOWAT, frames are collected in user space */
+static int fallback(void)
+{
+	unsigned char buf[] = { 3, 'a', 'a', 'a', 0, 2, 'c', 'c' };
+	uev_ctx_t ctx;
+	size_t i;
+	int sv[2];
+	uev_t w;
+
+	frames = 0;
+	fail_unless(!socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv));
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_frame_init(&ctx, &w, frame_cb, NULL, sv[0], 1, 16));
+
+	for (i = 0; i < sizeof(buf); i++) {
+		fail_unless(write(sv[1], &buf[i], 1) == 1);
+		uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	}
+	fail_unless(frames == 3);
+	fail_unless(lens[0] == 3 && lens[1] == 0 && lens[2] == 2);
+
+	uev_exit(&ctx);
+	close(sv[0]);
+	close(sv[1]);
+
+	return 0;
+}
+
+int main(void)
+{
+	int result = 0;
+
+	result += test(rcvlowat(), "frame watcher, SO_RCVLOWAT follows frame");
+	result += test(batch(), "frame watcher, more frames than a batch");
+	result += test(hangup(), "frame watcher, peer closing mid-frame");
+	result += test(lastframe(), "frame watcher, last frame followed by close");
+	result += test(oversized(), "frame watcher, oversized frame");
+	result += test(fallback(), "frame watcher, partial frames without SO_RCVLOWAT");
+
+	return result;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
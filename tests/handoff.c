@@ -0,0 +1,195 @@
+/* Verify descriptor handoff channels, SCM_RIGHTS and load balancing */
+#include "check.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+
+static int got[2], hup[2];
+static int peer[16];
+
+/* Worker side, answers on the connection it got */
+static void worker_cb(uev_t *UNUSED(w), void *arg, int events, int sd)
+{
+	int id = *(int *)arg;
+	char ch;
+
+	if (events & (UEV_HUP | UEV_ERROR)) {
+		fail_unless(sd == -1);
+		hup[id]++;
+		return;
+	}
+
+	fail_unless(events == UEV_READ && sd >= 0);
+	fail_unless(read(sd, &ch, 1) == 1 && peer[(int)ch] >= 0);
+	fail_unless(write(sd, "!", 1) == 1);
+	close(sd);
+	got[id]++;
+}
+
+static void acceptor_cb(uev_t *UNUSED(w), void *arg, int events, int sd)
+{
+	int id = *(int *)arg;
+
+	fail_unless((events & UEV_HUP) && sd == -1);
+	hup[id]++;
+}
+
+static void run(uev_ctx_t *a, uev_ctx_t *b)
+{
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		uev_run(a, UEV_ONCE | UEV_NONBLOCK);
+		uev_run(b, UEV_ONCE | UEV_NONBLOCK);
+	}
+}
+
+static int id[2] = { 0, 1 };
+
+static void setup(uev_ctx_t *a, uev_ctx_t *b, uev_t ach[2], uev_t bch[2], int ch[2][2])
+{
+	int i;
+
+	fail_unless(!uev_init(a));
+	fail_unless(!uev_init(b));
+	for (i = 0; i < 2; i++) {
+		fail_unless(!socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK, 0, ch[i]));
+		fail_unless(!uev_handoff_init(a, &ach[i], acceptor_cb, &id[i], ch[i][0]));
+		fail_unless(!uev_handoff_init(b, &bch[i], worker_cb, &id[i], ch[i][1]));
+	}
+
+	memset(got, 0, sizeof(got));
+	memset(hup, 0, sizeof(hup));
+}
+
+/* Send @num connections, return descriptor passed for the first one */
+static int send_many(uev_ctx_t *a, int num)
+{
+	int i, first = -1;
+
+	for (i = 0; i < num; i++) {
+		int sv[2];
+		char c = i;
+
+		fail_unless(!socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+		fail_unless(write(sv[1], &c, 1) == 1);
+		peer[i] = sv[1];
+		fail_unless(!uev_handoff_send(a, sv[0]));
+		if (!i)
+			first = sv[0];
+	}
+
+	return first;
+}
+
+static void check_peers(int num)
+{
+	int i;
+
+	for (i = 0; i < num; i++) {
+		char ch;
+
+		fail_unless(read(peer[i], &ch, 1) == 1 && ch == '!');
+		close(peer[i]);
+	}
+}
+
+static int basic(void)
+{
+	uev_t ach[2], bch[2];
+	uev_ctx_t a, b;
+	int ch[2][2], sd, fl;
+
+	setup(&a, &b, ach, bch, ch);
+
+	fl = socket(AF_UNIX, SOCK_STREAM, 0);
+	fail_unless(uev_handoff_init(&a, &ach[0], NULL, NULL, fl) && errno == EINVAL);
+	close(fl);
+
+	/* Nobody reports load, spread evenly */
+	sd = send_many(&a, 6);
+	run(&a, &b);
+	fail_unless(got[0] == 3 && got[1] == 3);
+	fail_unless(fcntl(sd, F_GETFD) == -1 && errno == EBADF);
+	check_peers(6);
+
+	uev_exit(&a);
+	uev_exit(&b);
+	fail_unless(uev_handoff_send(&a, 0) && errno == ENOTCONN);
+
+	return 0;
+}
+
+static int load(void)
+{
+	uev_t ach[2], bch[2];
+	uev_ctx_t a, b;
+	int ch[2][2];
+
+	setup(&a, &b, ach, bch, ch);
+
+	/* Worker 0 busy, coalesced to one report */
+	fail_unless(!uev_handoff_load(&bch[0], 5));
+	fail_unless(!uev_handoff_load(&bch[0], 10));
+	run(&a, &b);
+
+	send_many(&a, 10);
+	run(&a, &b);
+	fail_unless(got[0] == 0 && got[1] == 10);
+	check_peers(10);
+
+	/* Worker 1 reports having served all of them, and more */
+	fail_unless(!uev_handoff_load(&bch[1], 12));
+	run(&a, &b);
+	send_many(&a, 4);
+	run(&a, &b);
+	fail_unless(got[0] == 3 && got[1] == 11);
+	check_peers(4);
+
+	uev_exit(&a);
+	uev_exit(&b);
+
+	return 0;
+}
+
+static int gone(void)
+{
+	uev_t ach[2], bch[2];
+	uev_ctx_t a, b;
+	int ch[2][2];
+
+	setup(&a, &b, ach, bch, ch);
+
+	/* Worker 0 exits with connections queued for it */
+	send_many(&a, 4);
+	uev_io_stop(&bch[0]);
+	close(ch[0][1]);
+	run(&a, &b);
+
+	fail_unless(hup[0] == 1 && got[0] == 0 && got[1] == 4);
+	fail_unless(!uev_handoff_active(&ach[0]));
+	check_peers(4);
+
+	uev_exit(&a);
+	uev_exit(&b);
+
+	return 0;
+}
+
+int main(void)
+{
+	int result = 0;
+
+	result += test(basic(), "handoff, descriptors passed and closed");
+	result += test(load(), "handoff, least loaded peer");
+	result += test(gone(), "handoff, peer gone, descriptors passed on");
+
+	return result;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,188 @@
+/* Verify batched input device reader and event compression */
+#include "check.h"
+#include <fcntl.h>
+#include <linux/input.h>
+#include <linux/joystick.h>
+
+static size_t got;
+static struct input_event ev[UEV_INPUT_BATCH];
+static struct js_event js[UEV_INPUT_BATCH];
+
+static void put(struct input_event *e, int type, int code, int value)
+{
+	memset(e, 0, sizeof(*e));
+	e->type  = type;
+	e->code  = code;
+	e->value = value;
+}
+
+static void evdev_cb(uev_t *w, void *UNUSED(arg), int events, void *batch, size_t num)
+{
+	if (UEV_ERROR == events) {
+		fprintf(stderr, "input watcher failed, restarting ...\n");
+		uev_io_start(w);
+		return;
+	}
+
+	fail_unless(num <= UEV_INPUT_BATCH);
+	memcpy(ev, batch, num * sizeof(ev[0]));
+	got = num;
+}
+
+static void js_cb(uev_t *w, void *UNUSED(arg), int events, void *batch, size_t num)
+{
+	if (UEV_ERROR == events) {
+		fprintf(stderr, "input watcher failed, restarting ...\n");
+		uev_io_start(w);
+		return;
+	}
+
+	fail_unless(num <= UEV_INPUT_BATCH);
+	memcpy(js, batch, num * sizeof(js[0]));
+	got = num;
+}
+
+static int evdev(void)
+{
+	int fd[2];
+	uev_t w;
+	uev_ctx_t ctx;
+	struct input_event in[12];
+
+	if (pipe2(fd, O_NONBLOCK))
+		return 1;
+
+	/* Three motion-only frames, a button frame, and one more motion */
+	put(&in[0],  EV_ABS, ABS_X, 1);
+	put(&in[1],  EV_REL, REL_WHEEL, 1);
+	put(&in[2],  EV_SYN, SYN_REPORT, 0);
+	put(&in[3],  EV_ABS, ABS_X, 2);
+	put(&in[4],  EV_ABS, ABS_Y, 7);
+	put(&in[5],  EV_SYN, SYN_REPORT, 0);
+	put(&in[6],  EV_REL, REL_WHEEL, 2);
+	put(&in[7],  EV_ABS, ABS_X, 3);
+	put(&in[8],  EV_SYN, SYN_REPORT, 0);
+	put(&in[9],  EV_KEY, BTN_LEFT, 1);
+	put(&in[10], EV_SYN, SYN_REPORT, 0);
+	put(&in[11], EV_ABS, ABS_X, 4);
+	write(fd[1], in, sizeof(in));
+
+	uev_init(&ctx);
+	uev_input_init(&ctx, &w, evdev_cb, NULL, fd[0], UEV_INPUT_EVDEV);
+	uev_run(&ctx, UEV_ONCE);
+	uev_exit(&ctx);
+
+	fail_unless(got == 7);
+	fail_unless(ev[0].type == EV_ABS && ev[0].code == ABS_X  && ev[0].value == 3);
+	fail_unless(ev[1].type == EV_REL && ev[1].code == REL_WHEEL && ev[1].value == 3);
+	fail_unless(ev[2].type == EV_ABS && ev[2].code == ABS_Y  && ev[2].value == 7);
+	fail_unless(ev[3].type == EV_SYN && ev[3].code == SYN_REPORT);
+	fail_unless(ev[4].type == EV_KEY && ev[4].value == 1);
+	fail_unless(ev[5].type == EV_SYN && ev[5].code == SYN_REPORT);
+	fail_unless(ev[6].type == EV_ABS && ev[6].value == 4);
+
+	close(fd[0]);
+	close(fd[1]);
+
+	return 0;
+}
+
+static int multitouch(void)
+{
+	int fd[2];
+	uev_t w;
+	uev_ctx_t ctx;
+	struct input_event in[17];
+
+	if (pipe2(fd, O_NONBLOCK))
+		return 1;
+
+	/* Two slots, then pointer motion, then motion with a button */
+	put(&in[0],  EV_ABS, ABS_MT_SLOT, 0);
+	put(&in[1],  EV_ABS, ABS_MT_POSITION_X, 10);
+	put(&in[2],  EV_ABS, ABS_X, 10);
+	put(&in[3],  EV_SYN, SYN_REPORT, 0);
+	put(&in[4],  EV_ABS, ABS_MT_POSITION_X, 11);
+	put(&in[5],  EV_ABS, ABS_X, 11);
+	put(&in[6],  EV_SYN, SYN_REPORT, 0);
+	put(&in[7],  EV_ABS, ABS_MT_SLOT, 1);
+	put(&in[8],  EV_ABS, ABS_MT_POSITION_X, 20);
+	put(&in[9],  EV_SYN, SYN_REPORT, 0);
+	put(&in[10], EV_ABS, ABS_X, 12);
+	put(&in[11], EV_SYN, SYN_REPORT, 0);
+	put(&in[12], EV_ABS, ABS_X, 13);
+	put(&in[13], EV_SYN, SYN_REPORT, 0);
+	put(&in[14], EV_ABS, ABS_X, 14);
+	put(&in[15], EV_KEY, BTN_LEFT, 1);
+	put(&in[16], EV_SYN, SYN_REPORT, 0);
+	write(fd[1], in, sizeof(in));
+
+	uev_init(&ctx);
+	uev_input_init(&ctx, &w, evdev_cb, NULL, fd[0], UEV_INPUT_EVDEV);
+	uev_run(&ctx, UEV_ONCE);
+	uev_exit(&ctx);
+
+	/* Slot frames as-is, only the two pointer frames are merged */
+	fail_unless(got == 15);
+	fail_unless(!memcmp(ev, in, 10 * sizeof(ev[0])));
+	fail_unless(ev[10].type == EV_ABS && ev[10].code == ABS_X && ev[10].value == 13);
+	fail_unless(ev[11].type == EV_SYN && ev[11].code == SYN_REPORT);
+	fail_unless(!memcmp(&ev[12], &in[14], 3 * sizeof(ev[0])));
+
+	close(fd[0]);
+	close(fd[1]);
+
+	return 0;
+}
+
+static int joystick(void)
+{
+	int fd[2];
+	uev_t w;
+	uev_ctx_t ctx;
+	struct js_event in[5] = {
+		{ .type = JS_EVENT_AXIS,   .number = 0, .value = 10 },
+		{ .type = JS_EVENT_AXIS,   .number = 1, .value = 20 },
+		{ .type = JS_EVENT_AXIS,   .number = 0, .value = 30 },
+		{ .type = JS_EVENT_BUTTON, .number = 2, .value = 1  },
+		{ .type = JS_EVENT_AXIS,   .number = 0, .value = 40 },
+	};
+
+	if (pipe2(fd, O_NONBLOCK))
+		return 1;
+	write(fd[1], in, sizeof(in));
+
+	uev_init(&ctx);
+	uev_input_init(&ctx, &w, js_cb, NULL, fd[0], UEV_INPUT_JOYSTICK);
+	uev_run(&ctx, UEV_ONCE);
+	uev_exit(&ctx);
+
+	fail_unless(got == 4);
+	fail_unless(js[0].number == 0 && js[0].value == 30);
+	fail_unless(js[1].number == 1 && js[1].value == 20);
+	fail_unless(js[2].type == JS_EVENT_BUTTON);
+	fail_unless(js[3].number == 0 && js[3].value == 40);
+
+	close(fd[0]);
+	close(fd[1]);
+
+	return 0;
+}
+
+int main(void)
+{
+	int result = 0;
+
+	result += test(evdev(), "Compressing evdev motion frames");
+	result += test(multitouch(), "Keeping evdev multi-touch frames intact");
+	result += test(joystick(), "Compressing joystick axis events");
+
+	return result;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
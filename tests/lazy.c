@@ -0,0 +1,156 @@
+/* Verify bulk registration of I/O watchers and lazy start of epoll */
+#include "check.h"
+#include <errno.h>
+
+#define NUM 16
+
+static int hits[NUM];
+static int errors;
+
+static void pipe_cb(uev_t *w, void *arg, int events)
+{
+	char ch;
+
+	if (UEV_ERROR == events) {
+		errors++;
+		return;
+	}
+
+	if (read(w->fd, &ch, 1) == 1)
+		hits[(intptr_t)arg]++;
+}
+
+/* Number of descriptors in the epoll instance, from /proc */
+static int registered(uev_ctx_t *ctx)
+{
+	char path[64], line[256];
+	FILE *fp;
+	int num = 0;
+
+	snprintf(path, sizeof(path), "/proc/self/fdinfo/%d", ctx->fd);
+	fp = fopen(path, "r");
+	if (!fp)
+		return -1;
+
+	while (fgets(line, sizeof(line), fp)) {
+		if (!strncmp(line, "tfd:", 4))
+			num++;
+	}
+	fclose(fp);
+
+	return num;
+}
+
+static int lazy(void)
+{
+	uev_io_spec_t io[NUM + 1];
+	uev_ctx_t ctx;
+	uev_t w[NUM + 1];
+	int fd[NUM][2], bad[2], i;
+
+	fail_unless(!uev_init1(&ctx, UEV_INIT_LAZY));
+	for (i = 0; i < NUM; i++) {
+		fail_unless(!pipe(fd[i]));
+		io[i].w      = &w[i];
+		io[i].fd     = fd[i][0];
+		io[i].events = UEV_READ;
+		io[i].cb     = pipe_cb;
+		io[i].arg    = (void *)(intptr_t)i;
+	}
+
+	/* A closed descriptor is only found at first uev_run() */
+	fail_unless(!pipe(bad));
+	close(bad[0]);
+	close(bad[1]);
+	io[NUM] = io[0];
+	io[NUM].w  = &w[NUM];
+	io[NUM].fd = bad[0];
+
+	fail_unless(!uev_io_init_many(&ctx, io, NUM + 1));
+	for (i = 0; i <= NUM; i++)
+		fail_unless(uev_io_active(&w[i]));
+	fail_unless(registered(&ctx) == 0);
+
+	write(fd[0][1], "a", 1);
+	write(fd[NUM - 1][1], "b", 1);
+	uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	fail_unless(registered(&ctx) == NUM);
+	fail_unless(errors == 1);
+	fail_unless(!uev_io_active(&w[NUM]));
+	fail_unless(hits[0] == 1 && hits[NUM - 1] == 1);
+
+	/* Not lazy anymore */
+	uev_io_stop(&w[1]);
+	fail_unless(registered(&ctx) == NUM - 1);
+
+	uev_exit(&ctx);
+	for (i = 0; i < NUM; i++) {
+		close(fd[i][0]);
+		close(fd[i][1]);
+	}
+
+	return 0;
+}
+
+static int many(void)
+{
+	uev_io_spec_t io[3];
+	uev_ctx_t ctx;
+	uev_t w[3];
+	int fd[2], bad[2], i;
+
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!pipe(fd));
+	fail_unless(!pipe(bad));
+	close(bad[0]);
+	close(bad[1]);
+
+	for (i = 0; i < 3; i++) {
+		memset(&w[i], 0, sizeof(w[i]));
+		io[i].w      = &w[i];
+		io[i].fd     = fd[0];
+		io[i].events = UEV_READ;
+		io[i].cb     = pipe_cb;
+		io[i].arg    = NULL;
+	}
+	io[1].fd = fd[1];
+
+	/* Invalid entry, nothing is started */
+	io[2].fd = -1;
+	fail_unless(uev_io_init_many(&ctx, io, 3));
+	fail_unless(errno == EINVAL);
+	fail_unless(registered(&ctx) == 0);
+
+	/* Failure to start, the ones already started are stopped */
+	io[2].fd = bad[0];
+	fail_unless(uev_io_init_many(&ctx, io, 3));
+	fail_unless(errno == EBADF);
+	fail_unless(!uev_io_active(&w[0]) && !uev_io_active(&w[1]));
+	fail_unless(registered(&ctx) == 0);
+
+	fail_unless(!uev_io_init_many(&ctx, io, 2));
+	fail_unless(registered(&ctx) == 2);
+
+	uev_exit(&ctx);
+	close(fd[0]);
+	close(fd[1]);
+
+	return 0;
+}
+
+int main(void)
+{
+	int result = 0;
+
+	result += test(many(), "bulk I/O watcher registration");
+	result += test(lazy(), "lazy epoll registration");
+
+	return result;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,152 @@
+/* Verify token bucket rate limiting of I/O watchers */
+#include "check.h"
+#include <errno.h>
+#include <fcntl.h>
+
+#define NUM 200
+
+static int events;
+static size_t bytes;
+
+static void read_cb(uev_t *w, void *UNUSED(arg), int UNUSED(ev))
+{
+	char ch;
+
+	if (read(w->fd, &ch, 1) == 1)
+		events++;
+}
+
+static void recv_cb(uev_t *UNUSED(w), void *UNUSED(arg), int UNUSED(ev), uev_buf_t *buf)
+{
+	if (buf)
+		bytes += buf->len;
+}
+
+static void exit_cb(uev_t *w, void *UNUSED(arg), int UNUSED(ev))
+{
+	uev_exit(w->ctx);
+}
+
+/* Always readable pipe, filled up */
+static void fill(int fd[2])
+{
+	char buf[4096];
+
+	fail_unless(!pipe2(fd, O_NONBLOCK));
+	memset(buf, 'x', sizeof(buf));
+	while (write(fd[1], buf, sizeof(buf)) > 0)
+		;
+}
+
+static int rate_events(void)
+{
+	uev_ctx_t ctx;
+	uev_t w, stop;
+	int fd[2];
+
+	fill(fd);
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_io_init(&ctx, &w, read_cb, NULL, fd[0], UEV_READ));
+	fail_unless(uev_io_limit(&w, 3, 100, 10) && errno == EINVAL);
+	fail_unless(!uev_io_limit(&w, UEV_LIMIT_EVENTS, 100, 10));
+	fail_unless(!uev_timer_init(&ctx, &stop, exit_cb, NULL, 300, 0));
+
+	/* 10 burst, then 100/s for 300 msec */
+	uev_run(&ctx, 0);
+	fail_unless(events >= 30 && events <= 50);
+
+	close(fd[0]);
+	close(fd[1]);
+
+	return 0;
+}
+
+static int rate_bytes(void)
+{
+	uev_ctx_t ctx;
+	uev_t w, stop;
+	int fd[2];
+
+	fill(fd);
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_recv_init(&ctx, &w, recv_cb, NULL, fd[0], 4096));
+	fail_unless(!uev_io_limit(&w, UEV_LIMIT_BYTES, 100000, 4096));
+	fail_unless(!uev_timer_init(&ctx, &stop, exit_cb, NULL, 300, 0));
+
+	/* 4k burst, then 100 kB/s for 300 msec */
+	uev_run(&ctx, 0);
+	fail_unless(bytes >= 25000 && bytes <= 45000);
+
+	close(fd[0]);
+	close(fd[1]);
+
+	return 0;
+}
+
+static int many(void)
+{
+	uev_ctx_t ctx;
+	uev_t w[NUM], *t;
+	int fd[NUM][2], i, timers = 0;
+
+	events = 0;
+	fail_unless(!uev_init(&ctx));
+	for (i = 0; i < NUM; i++) {
+		fail_unless(!pipe(fd[i]));
+		write(fd[i][1], "ab", 2);
+		fail_unless(!uev_io_init(&ctx, &w[i], read_cb, NULL, fd[i][0], UEV_READ));
+		fail_unless(!uev_io_limit(&w[i], UEV_LIMIT_EVENTS, 1, 1));
+	}
+
+	/* One event each, then all are paused, whatever the batch size */
+	for (i = 0; i < NUM && events < NUM; i++)
+		uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	fail_unless(events == NUM);
+	for (i = 0; i < 3; i++)
+		uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	fail_unless(events == NUM);
+
+	/* With one timer for all of them */
+	LIST_FOREACH(t, &ctx.watchers, link) {
+		if (t->type == UEV_TIMER_TYPE)
+			timers++;
+	}
+	fail_unless(timers == 1);
+
+	/* Stopping and starting again keeps the empty bucket */
+	fail_unless(!uev_io_stop(&w[1]));
+	fail_unless(!uev_io_start(&w[1]));
+	uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	fail_unless(events == NUM);
+
+	/* Removing the limit resumes the watcher */
+	fail_unless(!uev_io_limit(&w[0], UEV_LIMIT_EVENTS, 0, 0));
+	uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	fail_unless(events == NUM + 1);
+
+	uev_exit(&ctx);
+	for (i = 0; i < NUM; i++) {
+		close(fd[i][0]);
+		close(fd[i][1]);
+	}
+
+	return 0;
+}
+
+int main(void)
+{
+	int result = 0;
+
+	result += test(rate_events(), "rate limit, events per second");
+	result += test(rate_bytes(), "rate limit, bytes per second");
+	result += test(many(), "rate limit, many watchers one timer");
+
+	return result;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
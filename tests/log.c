@@ -0,0 +1,124 @@
+/* Verify group commit of append logs, offsets, ordering, and errors */
+#include "check.h"
+#include <errno.h>
+#include <fcntl.h>
+
+#define NUM 100
+
+static int durable, more, errors;
+static off_t last = -1;
+
+static void durable_cb(uev_t *w, void *arg, off_t off)
+{
+	char rec[32];
+	int i = (int)(intptr_t)arg;
+
+	fail_unless(off >= 0);
+	fail_unless(i == durable);
+	fail_unless(off > last);
+	last = off;
+	durable++;
+
+	/* Appended while a batch is in flight, goes in the next one */
+	if (i == 0) {
+		for (i = NUM; i < 2 * NUM; i++) {
+			snprintf(rec, sizeof(rec), "record %03d\n", i);
+			fail_unless(!uev_log_append(w, rec, strlen(rec), durable_cb, (void *)(intptr_t)i));
+		}
+		more = 1;
+	}
+
+	if (durable == 2 * NUM)
+		fail_unless(!uev_log_stop(w));
+}
+
+static void error_cb(uev_t *w, void *UNUSED(arg), off_t off)
+{
+	fail_unless(off == -1);
+	fail_unless(errno == EBADF);
+	errors++;
+
+	/* Failed for good, later appends too */
+	fail_unless(uev_log_append(w, "x", 1, error_cb, NULL) == -1);
+	fail_unless(errno == EBADF);
+}
+
+static int append(int backend)
+{
+	char tmpl[] = "/tmp/uev-log.XXXXXX";
+	char rec[32], buf[4096];
+	uev_ctx_t ctx;
+	uev_t w, ro;
+	ssize_t len;
+	int fd, i;
+
+	fd = mkstemp(tmpl);
+	fail_unless(fd >= 0);
+
+	durable = more = errors = 0;
+	last = -1;
+
+	uev_init(&ctx);
+	if (uev_file_backend(&ctx, backend) != backend) {
+		fprintf(stderr, "backend %d not available, skipping ...\n", backend);
+		uev_exit(&ctx);
+		unlink(tmpl);
+		close(fd);
+		return 0;
+	}
+
+	/* Appends to what is already in the file */
+	fail_unless(write(fd, "header\n", 7) == 7);
+
+	fail_unless(!uev_log_init(&ctx, &w, fd));
+	for (i = 0; i < NUM; i++) {
+		snprintf(rec, sizeof(rec), "record %03d\n", i);
+		fail_unless(!uev_log_append(&w, rec, strlen(rec), durable_cb, (void *)(intptr_t)i));
+	}
+
+	/* Writing to a read-only descriptor fails in the callback */
+	fail_unless(!uev_log_init(&ctx, &ro, open(tmpl, O_RDONLY)));
+	fail_unless(!uev_log_append(&ro, "x", 1, error_cb, NULL));
+	fail_unless(!uev_log_append(&ro, "y", 1, error_cb, NULL));
+
+	/* Returns when all records are on disk */
+	fail_unless(!uev_run(&ctx, 0));
+
+	fail_unless(more == 1);
+	fail_unless(durable == 2 * NUM);
+	fail_unless(errors == 2);
+	fail_unless(last == 7 + (2 * NUM - 1) * 11);
+
+	len = pread(fd, buf, sizeof(buf), 0);
+	fail_unless(len == 7 + 2 * NUM * 11);
+	fail_unless(!memcmp(buf, "header\nrecord 000\n", 18));
+	fail_unless(!memcmp(&buf[len - 11], "record 199\n", 11));
+
+	/* Records not yet written are dropped on uev_exit() */
+	fail_unless(!uev_log_init(&ctx, &w, fd));
+	fail_unless(!uev_log_append(&w, "dropped\n", 8, durable_cb, NULL));
+
+	uev_exit(&ctx);
+	unlink(tmpl);
+	close(ro.fd);
+	close(fd);
+
+	return 0;
+}
+
+int main(void)
+{
+	int result = 0;
+
+	result += test(append(UEV_FILE_URING), "Append log, io_uring");
+	result += test(append(UEV_FILE_THREADS), "Append log, threads");
+
+	return result;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,173 @@
+/* Verify writable threshold, TCP_NOTSENT_LOWAT and user space tracking */
+#include "check.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/sockios.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+#define TOTAL (4 * 1024 * 1024)
+
+static size_t sent, received, threshold;
+static int wakeups, sndbuf;
+
+static void write_cb(uev_t *w, void *UNUSED(arg), int UNUSED(events))
+{
+	char buf[4096];
+	int queued;
+
+	wakeups++;
+	if (threshold) {
+		fail_unless(!ioctl(w->fd, SIOCOUTQ, &queued));
+		fail_unless((size_t)(sndbuf - queued) >= threshold);
+	}
+
+	memset(buf, 'x', sizeof(buf));
+	while (sent < TOTAL) {
+		ssize_t num;
+
+		num = write(w->fd, buf, sizeof(buf));
+		if (num <= 0)
+			return;
+		sent += num;
+	}
+
+	uev_io_stop(w);
+}
+
+static void read_cb(uev_t *w, void *UNUSED(arg), int UNUSED(events))
+{
+	char buf[1024];
+	ssize_t num;
+
+	num = read(w->fd, buf, sizeof(buf));
+	if (num > 0)
+		received += num;
+	if (num <= 0 || received == TOTAL)
+		uev_exit(w->ctx);
+}
+
+static void stall_cb(uev_t *w, void *UNUSED(arg), int UNUSED(events))
+{
+	uev_exit(w->ctx);
+}
+
+/* Number of writer wakeups to send TOTAL bytes over a UNIX socket */
+static int stream(int lowat)
+{
+	socklen_t len = sizeof(sndbuf);
+	uev_t writer, reader, stall;
+	uev_ctx_t ctx;
+	int sv[2];
+
+	sent = received = threshold = 0;
+	wakeups = 0;
+
+	fail_unless(!socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv));
+	fail_unless(!getsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, &len));
+
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_io_init(&ctx, &writer, write_cb, NULL, sv[0], UEV_WRITE));
+	fail_unless(!uev_io_init(&ctx, &reader, read_cb, NULL, sv[1], UEV_READ));
+	fail_unless(!uev_timer_init(&ctx, &stall, stall_cb, NULL, 5000, 0));
+	if (lowat) {
+		threshold = sndbuf - sndbuf / 16;
+		fail_unless(!uev_io_lowat(&writer, threshold));
+	}
+
+	uev_run(&ctx, 0);
+	fail_unless(received == TOTAL);
+
+	uev_exit(&ctx);
+	close(sv[0]);
+	close(sv[1]);
+
+	return wakeups;
+}
+
+static int unix_stream(void)
+{
+	int plain, lowat;
+
+	plain = stream(0);
+	lowat = stream(1);
+	fail_unless(lowat < plain);
+
+	return 0;
+}
+
+static int tcp(void)
+{
+	struct sockaddr_in sin = { .sin_family = AF_INET };
+	socklen_t len = sizeof(sin);
+	uev_ctx_t ctx;
+	int lsd, sd, val;
+	uev_t w;
+
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	lsd = socket(AF_INET, SOCK_STREAM, 0);
+	fail_unless(lsd >= 0);
+	fail_unless(!bind(lsd, (struct sockaddr *)&sin, sizeof(sin)));
+	fail_unless(!listen(lsd, 1));
+	fail_unless(!getsockname(lsd, (struct sockaddr *)&sin, &len));
+
+	sd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	fail_unless(sd >= 0);
+	connect(sd, (struct sockaddr *)&sin, sizeof(sin));
+
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_io_init(&ctx, &w, write_cb, NULL, sd, UEV_NONE));
+	fail_unless(!uev_io_lowat(&w, 16384));
+
+	len = sizeof(val);
+	fail_unless(!getsockopt(sd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &val, &len));
+	fail_unless(val == 16384);
+
+	/* Handled by the kernel, nothing to track */
+	fail_unless(w.lowat == 0);
+
+	uev_exit(&ctx);
+	close(sd);
+	close(lsd);
+
+	return 0;
+}
+
+static int unsupported(void)
+{
+	uev_ctx_t ctx;
+	int fd[2];
+	uev_t w;
+
+	fail_unless(!pipe2(fd, O_NONBLOCK));
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_io_init(&ctx, &w, write_cb, NULL, fd[1], UEV_WRITE));
+	fail_unless(uev_io_lowat(&w, 16384) && errno == EOPNOTSUPP);
+	fail_unless(!uev_io_lowat(&w, 0));
+
+	uev_exit(&ctx);
+	close(fd[0]);
+	close(fd[1]);
+
+	return 0;
+}
+
+int main(void)
+{
+	int result = 0;
+
+	result += test(unix_stream(), "writable threshold, UNIX socket, fewer wakeups");
+	result += test(tcp(), "writable threshold, TCP_NOTSENT_LOWAT");
+	result += test(unsupported(), "writable threshold, pipes not supported");
+
+	return result;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,103 @@
+/* Verify netlink watcher, batched multipart parsing and resync */
+#include "check.h"
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+static int msgs, done, resyncs;
+static uint16_t types[16];
+
+static void netlink_cb(uev_t *w, void *UNUSED(arg), int events, struct nlmsghdr *nlh)
+{
+	if (UEV_ERROR == events) {
+		fprintf(stderr, "netlink watcher failed, restarting ...\n");
+		uev_io_start(w);
+		return;
+	}
+
+	fail_unless(nlh != NULL);
+	if (nlh->nlmsg_type == NLMSG_DONE) {
+		done++;
+		return;
+	}
+
+	fail_unless(msgs < 16);
+	types[msgs++] = nlh->nlmsg_type;
+}
+
+static void resync_cb(uev_t *UNUSED(w), void *UNUSED(arg), int UNUSED(events))
+{
+	resyncs++;
+}
+
+/* Append one message to a datagram buffer */
+static size_t add(char *buf, size_t pos, uint16_t type, uint16_t flags, size_t payload)
+{
+	struct nlmsghdr *nlh = (struct nlmsghdr *)(buf + pos);
+
+	memset(nlh, 0, NLMSG_SPACE(payload));
+	nlh->nlmsg_len   = NLMSG_LENGTH(payload);
+	nlh->nlmsg_type  = type;
+	nlh->nlmsg_flags = flags;
+
+	return pos + NLMSG_SPACE(payload);
+}
+
+static int multipart(void)
+{
+	int sd[2];
+	char buf[UEV_NETLINK_BUFSZ * 2];
+	size_t len;
+	uev_t w;
+	uev_ctx_t ctx;
+
+	if (socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, sd))
+		return 1;
+
+	/* One datagram with three parts, a no-op and an end-of-dump */
+	len = add(buf, 0,   RTM_NEWLINK,  NLM_F_MULTI, 16);
+	len = add(buf, len, NLMSG_NOOP,   NLM_F_MULTI, 0);
+	len = add(buf, len, RTM_NEWADDR,  NLM_F_MULTI, 24);
+	len = add(buf, len, RTM_NEWROUTE, NLM_F_MULTI, 28);
+	send(sd[1], buf, len, 0);
+	len = add(buf, 0,   NLMSG_DONE,   NLM_F_MULTI, 4);
+	send(sd[1], buf, len, 0);
+
+	uev_init(&ctx);
+	uev_netlink_init(&ctx, &w, netlink_cb, resync_cb, NULL, sd[0]);
+	uev_run(&ctx, UEV_ONCE);
+
+	fail_unless(msgs == 3);
+	fail_unless(done == 1);
+	fail_unless(types[0] == RTM_NEWLINK);
+	fail_unless(types[1] == RTM_NEWADDR);
+	fail_unless(types[2] == RTM_NEWROUTE);
+	fail_unless(resyncs == 0);
+
+	/* Overrun marker and a truncated datagram both trigger resync */
+	len = add(buf, 0, NLMSG_OVERRUN, 0, 0);
+	send(sd[1], buf, len, 0);
+	len = add(buf, 0, RTM_NEWROUTE, 0, UEV_NETLINK_BUFSZ);
+	send(sd[1], buf, len, 0);
+
+	uev_run(&ctx, UEV_ONCE);
+	fail_unless(resyncs == 1);
+
+	uev_exit(&ctx);
+	close(sd[0]);
+	close(sd[1]);
+
+	return 0;
+}
+
+int main(void)
+{
+	return test(multipart(), "Batched multipart netlink parsing");
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
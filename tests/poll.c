@@ -0,0 +1,158 @@
+/* Verify poll() backend, and automatic move to epoll when outgrown */
+#include "check.h"
+#include <errno.h>
+
+#define NUM (UEV_POLL_MAX + 1)
+
+static int hits[NUM];
+static int timeouts;
+
+static void pipe_cb(uev_t *w, void *arg, int events)
+{
+	char ch;
+
+	fail_unless(events & UEV_READ);
+	if (read(w->fd, &ch, 1) == 1)
+		hits[(intptr_t)arg]++;
+}
+
+static int errors;
+
+static void error_cb(uev_t *UNUSED(w), void *UNUSED(arg), int events)
+{
+	fail_unless(events == UEV_ERROR);
+	errors++;
+}
+
+static void timer_cb(uev_t *UNUSED(w), void *UNUSED(arg), int UNUSED(events))
+{
+	timeouts++;
+}
+
+static int backend(void)
+{
+	uev_ctx_t ctx;
+	uev_t w[3], t;
+	int fd[3][2], i;
+
+	fail_unless(!uev_init1(&ctx, UEV_INIT_POLL));
+	fail_unless(ctx.fd == -1);
+
+	for (i = 0; i < 3; i++) {
+		fail_unless(!pipe(fd[i]));
+		fail_unless(!uev_io_init(&ctx, &w[i], pipe_cb, (void *)(intptr_t)i, fd[i][0], UEV_READ));
+	}
+	fail_unless(!uev_timer_init(&ctx, &t, timer_cb, NULL, 10, 0));
+	fail_unless(ctx.npfd == 4);
+
+	/* Array is kept dense when a watcher in the middle is stopped */
+	uev_io_stop(&w[1]);
+	fail_unless(ctx.npfd == 3);
+
+	write(fd[0][1], "a", 1);
+	write(fd[1][1], "b", 1);
+	write(fd[2][1], "c", 1);
+	uev_run(&ctx, UEV_ONCE);
+	fail_unless(hits[0] == 1 && hits[1] == 0 && hits[2] == 1);
+
+	/* One-shot watcher is disabled after the event, until set again */
+	uev_io_stop(&w[0]);
+	uev_io_set(&w[0], fd[0][0], UEV_READ | UEV_ONESHOT);
+	write(fd[0][1], "dd", 2);
+	uev_run(&ctx, UEV_ONCE);
+	fail_unless(hits[0] == 2);
+	uev_run(&ctx, UEV_ONCE);
+	fail_unless(hits[0] == 2);
+	fail_unless(timeouts == 1);
+	uev_io_set(&w[0], fd[0][0], UEV_READ | UEV_ONESHOT);
+	uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	fail_unless(hits[0] == 3);
+
+	/* Not supported without epoll */
+	fail_unless(uev_io_set(&w[1], fd[1][0], UEV_READ | UEV_EDGE));
+	fail_unless(errno == EINVAL);
+
+	uev_exit(&ctx);
+	for (i = 0; i < 3; i++) {
+		close(fd[i][0]);
+		close(fd[i][1]);
+	}
+
+	return 0;
+}
+
+/* Descriptor closed behind the watcher's back, POLLNVAL is an error */
+static int closed(void)
+{
+	uev_ctx_t ctx;
+	uev_t w;
+	int fd[2], i;
+
+	fail_unless(!uev_init1(&ctx, UEV_INIT_POLL));
+	fail_unless(!pipe(fd));
+	fail_unless(!uev_io_init(&ctx, &w, error_cb, NULL, fd[0], UEV_READ));
+	close(fd[0]);
+
+	for (i = 0; i < 10; i++)
+		uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	fail_unless(errors == 1);
+	fail_unless(!uev_io_active(&w));
+	fail_unless(ctx.npfd == 0);
+
+	uev_exit(&ctx);
+	close(fd[1]);
+
+	return 0;
+}
+
+static int automatic(void)
+{
+	uev_ctx_t ctx;
+	uev_t w[NUM];
+	int fd[NUM][2], i;
+
+	memset(hits, 0, sizeof(hits));
+	fail_unless(!uev_init1(&ctx, UEV_INIT_AUTO));
+
+	for (i = 0; i < NUM; i++) {
+		fail_unless(!pipe(fd[i]));
+		fail_unless(!uev_io_init(&ctx, &w[i], pipe_cb, (void *)(intptr_t)i, fd[i][0], UEV_READ));
+		if (i < UEV_POLL_MAX)
+			fail_unless(ctx.fd == -1);
+	}
+
+	/* Moved to epoll, with all watchers */
+	fail_unless(ctx.fd >= 0);
+	fail_unless(ctx.npfd == 0);
+
+	write(fd[0][1], "a", 1);
+	write(fd[NUM - 1][1], "b", 1);
+	uev_run(&ctx, UEV_ONCE);
+	fail_unless(hits[0] == 1 && hits[NUM - 1] == 1);
+
+	uev_exit(&ctx);
+	for (i = 0; i < NUM; i++) {
+		close(fd[i][0]);
+		close(fd[i][1]);
+	}
+
+	return 0;
+}
+
+int main(void)
+{
+	int result = 0;
+
+	result += test(backend(), "poll() backend");
+	result += test(closed(), "poll() backend, closed descriptor");
+	result += test(automatic(), "poll() backend, move to epoll");
+
+	return result;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,123 @@
+/* Verify receive buffers are borrowed from a shared pool per context */
+#include "check.h"
+#include <sys/socket.h>
+
+#define NUM_CONNS 100
+
+static int sd[NUM_CONNS][2];
+static uev_t w[NUM_CONNS];
+static uev_buf_t *kept;
+static int reads;
+
+static void recv_cb(uev_t *w, void *UNUSED(arg), int events, uev_buf_t *buf)
+{
+	if (UEV_ERROR == events) {
+		fprintf(stderr, "receive watcher failed, restarting ...\n");
+		uev_io_start(w);
+		return;
+	}
+
+	fail_unless(buf != NULL);
+	fail_unless(buf->len == 5 && !memcmp(buf->data, "hello", 5));
+	fail_unless(buf->size >= 1000);
+	reads++;
+
+	/* Hold on to the first one, e.g. for an incomplete request */
+	if (!kept) {
+		kept = buf;
+		uev_buf_keep(buf);
+	}
+}
+
+static size_t most;
+
+static void size_cb(uev_t *UNUSED(w), void *UNUSED(arg), int UNUSED(events), uev_buf_t *buf)
+{
+	fail_unless(buf != NULL);
+	if (buf->len > most)
+		most = buf->len;
+}
+
+static int pool(void)
+{
+	uev_ctx_t ctx;
+	uev_buf_t *buf;
+	int i;
+
+	uev_init(&ctx);
+	for (i = 0; i < NUM_CONNS; i++) {
+		if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sd[i]))
+			return 1;
+		uev_recv_init(&ctx, &w[i], recv_cb, NULL, sd[i][0], 1000);
+	}
+
+	/* Idle connections hold no buffers */
+	fail_unless(ctx.pool[1] == NULL);
+
+	write(sd[10][1], "hello", 5);
+	write(sd[20][1], "hello", 5);
+	write(sd[30][1], "hello", 5);
+	for (i = 0; i < 10 && reads < 3; i++)
+		uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+
+	/* Three reads, one buffer kept, the other two reads shared one */
+	fail_unless(reads == 3);
+	fail_unless(kept != NULL);
+	fail_unless(ctx.pooled[1] == 1);
+
+	uev_buf_put(&ctx, kept);
+	fail_unless(ctx.pooled[1] == 2);
+
+	/* Same size class is reused, not reallocated */
+	buf = uev_buf_get(&ctx, 2048);
+	fail_unless(buf == kept);
+	uev_buf_put(&ctx, buf);
+
+	uev_exit(&ctx);
+	for (i = 0; i < NUM_CONNS; i++) {
+		close(sd[i][0]);
+		close(sd[i][1]);
+	}
+
+	return 0;
+}
+
+/* Buffers are from a larger size class, reads are still at most size */
+static int limited(void)
+{
+	static char data[3000];
+	uev_ctx_t ctx;
+	uev_t r;
+	int fd[2];
+
+	fail_unless(!socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fd));
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_recv_init(&ctx, &r, size_cb, NULL, fd[0], 1000));
+
+	fail_unless(write(fd[1], data, sizeof(data)) == sizeof(data));
+	uev_run(&ctx, UEV_ONCE);
+	fail_unless(most == 1000);
+
+	uev_exit(&ctx);
+	close(fd[0]);
+	close(fd[1]);
+
+	return 0;
+}
+
+int main(void)
+{
+	int result = 0;
+
+	result += test(pool(), "Borrowing pooled receive buffers");
+	result += test(limited(), "Reading at most the requested size");
+
+	return result;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,129 @@
+/* Verify pull mode, uev_poll() returns ready watchers without callbacks */
+#include "check.h"
+#include <errno.h>
+#include <sys/socket.h>
+
+#define NUM 4
+
+static int calls;
+
+static void cb(uev_t *UNUSED(w), void *UNUSED(arg), int UNUSED(events))
+{
+	calls++;
+}
+
+static int frames;
+
+static void frame_cb(uev_t *UNUSED(w), void *UNUSED(arg), int events, uev_buf_t *buf)
+{
+	fail_unless(events == UEV_READ && buf != NULL);
+	fail_unless(buf->len == 3 && !memcmp(buf->data, "abc", 3));
+	frames++;
+}
+
+/* Frame watchers keep a partial header, they are never returned */
+static int owned(void)
+{
+	unsigned char msg[] = { 0, 3, 'a', 'b', 'c' };
+	uev_event_t ev[2];
+	uev_ctx_t ctx;
+	int sv[2];
+	uev_t w;
+
+	fail_unless(!socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv));
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_frame_init(&ctx, &w, frame_cb, NULL, sv[0], 2, 16));
+
+	fail_unless(write(sv[1], msg, 1) == 1);
+	fail_unless(uev_poll(&ctx, ev, 2, 100) == 0);
+	fail_unless(write(sv[1], msg + 1, sizeof(msg) - 1) == sizeof(msg) - 1);
+	fail_unless(uev_poll(&ctx, ev, 2, 100) == 0);
+	fail_unless(frames == 1);
+
+	uev_exit(&ctx);
+	close(sv[0]);
+	close(sv[1]);
+
+	return 0;
+}
+
+static int pull(int flags)
+{
+	uev_event_t ev[NUM + 2];
+	uev_ctx_t ctx;
+	uev_t w[NUM], out, once, tick;
+	int fd[NUM][2], i, n, seen;
+	char buf[4];
+
+	fail_unless(!uev_init1(&ctx, flags));
+	for (i = 0; i < NUM; i++) {
+		fail_unless(!pipe(fd[i]));
+		fail_unless(!uev_io_init(&ctx, &w[i], cb, NULL, fd[i][0], UEV_READ));
+	}
+	fail_unless(!uev_io_init(&ctx, &out, cb, NULL, fd[0][1], UEV_READ));
+	fail_unless(!uev_timer_init(&ctx, &once, cb, NULL, 10, 0));
+	fail_unless(!uev_timer_init(&ctx, &tick, cb, NULL, 10, 10));
+
+	fail_unless(uev_poll(&ctx, NULL, 1, 0) == -1 && errno == EINVAL);
+	fail_unless(uev_poll(&ctx, ev, 0, 0) == -1 && errno == EINVAL);
+
+	/* Only ready watchers are returned */
+	write(fd[1][1], "a", 1);
+	write(fd[3][1], "b", 1);
+	n = uev_poll(&ctx, ev, NUM + 2, 0);
+	fail_unless(n == 2);
+	for (i = 0, seen = 0; i < n; i++) {
+		fail_unless(ev[i].events == UEV_READ);
+		if (ev[i].w == &w[1] || ev[i].w == &w[3])
+			seen++;
+		read(ev[i].w->fd, buf, sizeof(buf));
+	}
+	fail_unless(seen == 2);
+
+	/* Timers are read and one-shot timers stopped by the library */
+	usleep(20000);
+	n = uev_poll(&ctx, ev, NUM + 2, 100);
+	fail_unless(n == 2);
+	fail_unless(!uev_timer_active(&once));
+	fail_unless(uev_timer_active(&tick));
+
+	/* Periodic timer is still running, nothing else */
+	n = uev_poll(&ctx, ev, NUM + 2, 100);
+	fail_unless(n == 1 && ev[0].w == &tick);
+
+	/* Output queued by the caller is written before waiting */
+	uev_timer_stop(&tick);
+	fail_unless(uev_poll(&ctx, ev, NUM + 2, 0) == 0);
+	fail_unless(!uev_io_write(&out, "c", 1));
+	n = uev_poll(&ctx, ev, NUM + 2, 0);
+	fail_unless(n == 1 && ev[0].w == &w[0]);
+
+	fail_unless(calls == 0);
+	uev_exit(&ctx);
+	fail_unless(uev_poll(&ctx, ev, NUM + 2, 0) == -1 && errno == EINVAL);
+
+	for (i = 0; i < NUM; i++) {
+		close(fd[i][0]);
+		close(fd[i][1]);
+	}
+
+	return 0;
+}
+
+int main(void)
+{
+	int result = 0;
+
+	result += test(pull(0), "uev_poll() with epoll");
+	result += test(pull(UEV_INIT_POLL), "uev_poll() with poll()");
+	result += test(owned(), "uev_poll() dispatches frame watchers");
+
+	return result;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
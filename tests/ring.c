@@ -0,0 +1,105 @@
+/* Verify io_uring multishot receive with a shared provided buffer ring */
+#include "check.h"
+#include <errno.h>
+#include <sys/socket.h>
+
+#define NUM 4
+
+static char data[NUM + 1][16];
+static int got, hup, keep;
+static int kept[NUM + 1];
+
+static void recv_cb(uev_t *w, void *UNUSED(arg), int events, int bid, size_t len)
+{
+	if (events & (UEV_HUP | UEV_ERROR)) {
+		fail_unless(bid == -1);
+		fail_unless(!uev_ring_recv_active(w));
+		hup++;
+		return;
+	}
+
+	fail_unless(bid >= 0 && bid < NUM);
+	fail_unless(len < sizeof(data[0]));
+	memcpy(data[got], uev_bufring_data(w->ctx, bid), len);
+	if (keep) {
+		uev_bufring_keep(w->ctx, bid);
+		kept[got] = bid;
+	}
+	got++;
+}
+
+static int ring(void)
+{
+	char msg[16];
+	uev_ctx_t ctx;
+	uev_t w[2];
+	int sd[2][2], i;
+
+	uev_init(&ctx);
+	if (uev_bufring_init(&ctx, NUM, sizeof(data[0]))) {
+		fprintf(stderr, "io_uring provided buffers not available, skipping ...\n");
+		uev_exit(&ctx);
+		return 0;
+	}
+
+	for (i = 0; i < 2; i++) {
+		fail_unless(!socketpair(AF_UNIX, SOCK_STREAM, 0, sd[i]));
+		fail_unless(!uev_ring_recv_init(&ctx, &w[i], recv_cb, NULL, sd[i][0]));
+	}
+
+	/* Both watchers share the same buffers, all kept by the callback */
+	keep = 1;
+	for (i = 0; i < NUM; i++) {
+		snprintf(msg, sizeof(msg), "msg %d", i);
+		write(sd[i % 2][1], msg, strlen(msg));
+		while (got == i)
+			uev_run(&ctx, UEV_ONCE);
+		fail_unless(!strcmp(data[i], msg));
+	}
+
+	/* Out of buffers, the watcher waits until one is given back */
+	write(sd[0][1], "last", 4);
+	uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	usleep(10000);
+	uev_run(&ctx, UEV_ONCE | UEV_NONBLOCK);
+	fail_unless(got == NUM);
+	fail_unless(uev_ring_recv_active(&w[0]));
+
+	keep = 0;
+	uev_bufring_put(&ctx, kept[2]);
+	while (got == NUM)
+		uev_run(&ctx, UEV_ONCE);
+	fail_unless(!strcmp(data[NUM], "last"));
+
+	/* Peer closed, watcher stopped with UEV_HUP */
+	close(sd[0][1]);
+	while (!hup)
+		uev_run(&ctx, UEV_ONCE);
+	fail_unless(!uev_ring_recv_active(&w[0]));
+
+	/* Loop returns when the last receive has been cancelled */
+	fail_unless(!uev_ring_recv_stop(&w[1]));
+	fail_unless(!uev_run(&ctx, 0));
+	fail_unless(hup == 1);
+
+	uev_exit(&ctx);
+	for (i = 0; i < 2; i++) {
+		close(sd[i][0]);
+		if (i)
+			close(sd[i][1]);
+	}
+
+	return 0;
+}
+
+int main(void)
+{
+	return test(ring(), "Completion-based receive, provided buffers");
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,77 @@
+/* Verify the scratch arena, alignment, growth, reset, and keep */
+#include "check.h"
+#include <errno.h>
+#include <stdint.h>
+
+#define ITERATIONS 5
+
+static char *first, *kept;
+static int iterations;
+
+static void cb(uev_t *w, void *UNUSED(arg), int UNUSED(events))
+{
+	char *p, *q, *big;
+	size_t i;
+
+	p = uev_scratch(w->ctx, 1);
+	q = uev_scratch(w->ctx, 100);
+	fail_unless(p && q);
+	fail_unless(((uintptr_t)p % 16) == 0 && ((uintptr_t)q % 16) == 0);
+	fail_unless(q >= p + 16);
+
+	/* Larger than a chunk, the arena grows to one chunk for it all */
+	big = uev_scratch(w->ctx, 4 * UEV_SCRATCH_SIZE);
+	fail_unless(big != NULL);
+	for (i = 0; i < 4 * UEV_SCRATCH_SIZE; i++)
+		big[i] = (char)i;
+
+	/* After that, memory of the last iteration is reused */
+	if (iterations == 1)
+		first = p;
+	if (iterations > 1)
+		fail_unless(p == first);
+
+	/* Lives on after this iteration */
+	memcpy(q, "keep me", 8);
+	if (!kept)
+		kept = uev_scratch_keep(q, 8);
+
+	if (++iterations == ITERATIONS)
+		uev_timer_stop(w);
+}
+
+static int scratch(void)
+{
+	uev_ctx_t ctx;
+	uev_t w;
+
+	fail_unless(uev_scratch(NULL, 1) == NULL && errno == EINVAL);
+
+	uev_init(&ctx);
+	fail_unless(uev_scratch(&ctx, 0) == NULL && errno == EINVAL);
+	fail_unless(uev_scratch_keep(NULL, 1) == NULL && errno == EINVAL);
+
+	/* One callback per loop iteration */
+	fail_unless(!uev_timer_init(&ctx, &w, cb, NULL, 1, 1));
+	fail_unless(!uev_run(&ctx, 0));
+
+	fail_unless(iterations == ITERATIONS);
+	fail_unless(kept && !strcmp(kept, "keep me"));
+	free(kept);
+
+	uev_exit(&ctx);
+
+	return 0;
+}
+
+int main(void)
+{
+	return test(scratch(), "Scratch arena, reset every loop iteration");
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
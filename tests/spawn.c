@@ -0,0 +1,156 @@
+/* Verify spawned children, stdio pipes, exit status, and kill */
+#include "config.h"
+#include "check.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/wait.h>
+
+static char out[256], err[256];
+static size_t outlen, errlen, total;
+static int hups, reads;
+
+static void spawn_cb(uev_t *w, void *UNUSED(arg), int events, int fd, const char *buf, size_t len)
+{
+	if (events & UEV_HUP) {
+		fail_unless(fd == -1 && !buf && !len);
+		hups++;
+		uev_exit(w->ctx);
+		return;
+	}
+
+	fail_unless(events == UEV_READ && !hups);
+	fail_unless(len > 0 && len <= UEV_SPAWN_BUFSIZE);
+	reads++;
+	total += len;
+	if (fd == 1 && outlen + len < sizeof(out)) {
+		memcpy(&out[outlen], buf, len);
+		outlen += len;
+	}
+	if (fd == 2 && errlen + len < sizeof(err)) {
+		memcpy(&err[errlen], buf, len);
+		errlen += len;
+	}
+}
+
+static int run(char *const argv[], int flags, const char *input)
+{
+	uev_ctx_t ctx;
+	uev_t w;
+
+	memset(out, 0, sizeof(out));
+	memset(err, 0, sizeof(err));
+	outlen = errlen = total = 0;
+	hups = reads = 0;
+
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_spawn(&ctx, &w, spawn_cb, NULL, argv, NULL, flags));
+	fail_unless(uev_spawn_active(&w));
+	if (input) {
+		int fd = uev_spawn_stdin(&w);
+
+		fail_unless(fd >= 0);
+		fail_unless(write(fd, input, strlen(input)) == (ssize_t)strlen(input));
+		close(fd);
+	} else {
+		fail_unless(uev_spawn_stdin(&w) == -1 && errno == EINVAL);
+	}
+	fail_unless(!uev_run(&ctx, 0));
+	fail_unless(hups == 1 && !uev_spawn_active(&w));
+
+	return uev_spawn_status(&w);
+}
+
+static int output(void)
+{
+	char *sh[]   = { "sh", "-c", "echo out; echo err >&2; exit 3", NULL };
+	char *big[]  = { "head", "-c", "1000000", "/dev/zero", NULL };
+	char *cat[]  = { "/bin/cat", NULL };
+	char *none[] = { "/nonexistent", NULL };
+	uev_ctx_t ctx;
+	uev_t w;
+	int status;
+
+	status = run(sh, UEV_SPAWN_STDOUT | UEV_SPAWN_STDERR | UEV_SPAWN_PATH, NULL);
+	fail_unless(WIFEXITED(status) && WEXITSTATUS(status) == 3);
+	fail_unless(!strcmp(out, "out\n") && !strcmp(err, "err\n"));
+
+	/* Streamed in large reads */
+	status = run(big, UEV_SPAWN_STDOUT | UEV_SPAWN_PATH, NULL);
+	fail_unless(WIFEXITED(status) && !WEXITSTATUS(status));
+	fail_unless(total == 1000000 && reads < 100);
+
+	status = run(cat, UEV_SPAWN_STDIN | UEV_SPAWN_STDOUT, "hello");
+	fail_unless(WIFEXITED(status) && !WEXITSTATUS(status) && !strcmp(out, "hello"));
+
+	fail_unless(!uev_init(&ctx));
+	fail_unless(uev_spawn(&ctx, &w, spawn_cb, NULL, none, NULL, 0) && errno == ENOENT);
+	fail_unless(uev_spawn(&ctx, &w, spawn_cb, NULL, cat, NULL, 16) && errno == EINVAL);
+	uev_exit(&ctx);
+
+	return 0;
+}
+
+static int kill_child(void)
+{
+	char *argv[] = { "sleep", "10", NULL };
+	char cmd[64];
+	char *check[] = { "sh", "-c", cmd, NULL };
+	uev_ctx_t ctx;
+	sigset_t set;
+	uev_t w;
+	int status, fd;
+
+	/* Blocked in the parent, as with signal watchers, not in the child */
+	sigemptyset(&set);
+	sigaddset(&set, SIGTERM);
+	sigprocmask(SIG_BLOCK, &set, NULL);
+
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_spawn(&ctx, &w, spawn_cb, NULL, argv, NULL, UEV_SPAWN_PATH));
+	fail_unless(uev_spawn_status(&w) == -1);
+	fail_unless(!uev_spawn_kill(&w, SIGTERM));
+	hups = 0;
+	fail_unless(!uev_run(&ctx, 0));
+	status = uev_spawn_status(&w);
+	fail_unless(hups == 1 && WIFSIGNALED(status) && WTERMSIG(status) == SIGTERM);
+	fail_unless(uev_spawn_kill(&w, SIGTERM) && errno == ESRCH);
+
+	/* Other descriptors are not inherited */
+	fd = open("/dev/null", O_RDONLY);
+	snprintf(cmd, sizeof(cmd), "test -e /proc/self/fd/%d", fd);
+	status = run(check, UEV_SPAWN_PATH, NULL);
+#ifdef HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP
+	fail_unless(WIFEXITED(status) && WEXITSTATUS(status) == 1);
+#endif
+	close(fd);
+
+	/* Still running at exit, stopped without callback */
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_spawn(&ctx, &w, spawn_cb, NULL, argv, NULL, UEV_SPAWN_PATH | UEV_SPAWN_STDOUT));
+	hups = 0;
+	uev_spawn_kill(&w, SIGKILL);
+	uev_exit(&ctx);
+	fail_unless(!hups && w.fd == -1);
+	waitpid(-1, NULL, 0);
+
+	return 0;
+}
+
+int main(void)
+{
+	int result = 0;
+
+	result += test(output(), "spawn, stdin, stdout, stderr, and exit");
+	result += test(kill_child(), "spawn, kill, and descriptors closed");
+
+	return result;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
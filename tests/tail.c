@@ -0,0 +1,225 @@
+/* Verify tail watcher, new lines, rotation, and truncation */
+#include "check.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+
+static char got[256];
+static size_t len;
+
+static void tail_cb(uev_t *UNUSED(w), void *UNUSED(arg), int events, const char *lines, size_t num)
+{
+	fail_unless(events == UEV_READ);
+	fail_unless(len + num < sizeof(got));
+	memcpy(&got[len], lines, num);
+	len += num;
+	got[len] = 0;
+}
+
+static size_t total;
+static char tail[8];
+
+/* Counts bytes, and keeps the last few of them */
+static void count_cb(uev_t *UNUSED(w), void *UNUSED(arg), int UNUSED(events), const char *lines, size_t num)
+{
+	size_t keep = sizeof(tail) - 1;
+
+	total += num;
+	if (num >= keep) {
+		memcpy(tail, lines + num - keep, keep);
+	} else {
+		memmove(tail, tail + num, keep - num);
+		memcpy(tail + keep - num, lines, num);
+	}
+}
+
+static void tick_cb(uev_t *UNUSED(w), void *UNUSED(arg), int UNUSED(events))
+{
+}
+
+/* Run the event loop until @lines have been received */
+static int expect(uev_ctx_t *ctx, const char *lines)
+{
+	int i;
+
+	for (i = 0; i < 100 && strcmp(got, lines); i++)
+		uev_run(ctx, UEV_ONCE);
+
+	if (strcmp(got, lines)) {
+		fprintf(stderr, "expected \"%s\", got \"%s\"\n", lines, got);
+		return 1;
+	}
+
+	len = 0;
+	got[0] = 0;
+
+	return 0;
+}
+
+static void append(const char *path, const char *str)
+{
+	int fd;
+
+	fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+	fail_unless(fd >= 0);
+	fail_unless(write(fd, str, strlen(str)) == (ssize_t)strlen(str));
+	close(fd);
+}
+
+static int follow(void)
+{
+	char dir[] = "/tmp/uev-tail-XXXXXX", path[64], old[64];
+	uev_ctx_t ctx;
+	uev_t w, b, tick;
+	int fd;
+
+	fail_unless(mkdtemp(dir) != NULL);
+	snprintf(path, sizeof(path), "%s/log", dir);
+	snprintf(old, sizeof(old), "%s/log.1", dir);
+	append(path, "old\n");
+
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_timer_init(&ctx, &tick, tick_cb, NULL, 10, 10));
+	fail_unless(!uev_tail_init(&ctx, &w, tail_cb, NULL, path, 0));
+	fail_unless(uev_tail_active(&w));
+
+	/* Only complete lines, from the end */
+	append(path, "a\nb");
+	fail_unless(!expect(&ctx, "a\n"));
+	append(path, "\nc\n");
+	fail_unless(!expect(&ctx, "b\nc\n"));
+
+	/* Existing content */
+	fail_unless(!uev_tail_init(&ctx, &b, tail_cb, NULL, path, UEV_TAIL_BEGIN));
+	fail_unless(!expect(&ctx, "old\na\nb\nc\n"));
+	fail_unless(!uev_tail_stop(&b));
+	fail_unless(!uev_tail_active(&b));
+
+	/* Rotation, the writer still has the old file open */
+	fd = open(path, O_WRONLY | O_APPEND);
+	fail_unless(rename(path, old) == 0);
+	write(fd, "d\ne", 3);
+	fail_unless(!expect(&ctx, "d\n"));
+	close(fd);
+	append(path, "new\n");
+	fail_unless(!expect(&ctx, "enew\n"));
+
+	/* Truncation, read from the start again */
+	fail_unless(truncate(path, 0) == 0);
+	append(path, "x\n");
+	fail_unless(!expect(&ctx, "x\n"));
+
+	fail_unless(!uev_tail_stop(&w));
+	append(path, "y\n");
+	uev_run(&ctx, UEV_ONCE);
+	fail_unless(len == 0);
+
+	uev_exit(&ctx);
+	unlink(path);
+	unlink(old);
+	rmdir(dir);
+
+	return 0;
+}
+
+/* More unread in the old file than is read per wakeup, then rotation */
+static int rotation(void)
+{
+	char dir[] = "/tmp/uev-tail-XXXXXX", path[64], old[64];
+	char line[4096];
+	size_t size = 0;
+	uev_ctx_t ctx;
+	uev_t w, tick;
+	int fd, i;
+
+	fail_unless(mkdtemp(dir) != NULL);
+	snprintf(path, sizeof(path), "%s/log", dir);
+	snprintf(old, sizeof(old), "%s/log.1", dir);
+	append(path, "");
+
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_timer_init(&ctx, &tick, tick_cb, NULL, 10, 10));
+	fail_unless(!uev_tail_init(&ctx, &w, count_cb, NULL, path, 0));
+	uev_run(&ctx, UEV_ONCE);
+
+	fd = open(path, O_WRONLY | O_APPEND);
+	fail_unless(fd >= 0);
+	memset(line, 'x', sizeof(line) - 1);
+	line[sizeof(line) - 1] = '\n';
+	for (i = 0; i < 5000; i++) {
+		fail_unless(write(fd, line, sizeof(line)) == sizeof(line));
+		size += sizeof(line);
+	}
+	fail_unless(size > 16 * UEV_TAIL_BUFSIZE);
+	fail_unless(rename(path, old) == 0);
+	write(fd, "last\n", 5);
+	size += 5;
+	close(fd);
+	append(path, "new\n");
+	size += 4;
+
+	for (i = 0; i < 100 && total < size; i++)
+		uev_run(&ctx, UEV_ONCE);
+	fail_unless(total == size);
+	fail_unless(!memcmp(tail, "st\nnew\n", 7));
+
+	uev_exit(&ctx);
+	unlink(path);
+	unlink(old);
+	rmdir(dir);
+
+	return 0;
+}
+
+/* Stopping the last tail watcher lets uev_run() return, a new one restarts */
+static int restart(void)
+{
+	char dir[] = "/tmp/uev-tail-XXXXXX", path[64];
+	uev_ctx_t ctx;
+	uev_t w;
+
+	fail_unless(mkdtemp(dir) != NULL);
+	snprintf(path, sizeof(path), "%s/log", dir);
+	append(path, "one\n");
+
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_tail_init(&ctx, &w, tail_cb, NULL, path, UEV_TAIL_BEGIN));
+	fail_unless(!uev_tail_stop(&w));
+	fail_unless(!uev_run(&ctx, 0));
+
+	/* Failing to add one does not keep the loop running either */
+	fail_unless(uev_tail_init(&ctx, &w, tail_cb, NULL, "/nonexistent/log", 0) && errno == ENOENT);
+	fail_unless(!uev_run(&ctx, 0));
+
+	len    = 0;
+	got[0] = 0;
+	fail_unless(!uev_tail_init(&ctx, &w, tail_cb, NULL, path, 0));
+	append(path, "two\n");
+	fail_unless(!expect(&ctx, "two\n"));
+	fail_unless(!uev_tail_stop(&w));
+	fail_unless(!uev_run(&ctx, 0));
+
+	uev_exit(&ctx);
+	unlink(path);
+	rmdir(dir);
+
+	return 0;
+}
+
+int main(void)
+{
+	int result = 0;
+
+	result += test(follow(), "tail watcher");
+	result += test(rotation(), "tail watcher, rotation with a backlog");
+	result += test(restart(), "tail watcher, stop last and restart");
+
+	return result;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,111 @@
+/* Verify kernel receive timestamps and the receive delay histogram */
+#include "check.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+static struct timespec stamp;
+static int calls;
+
+/* Histogram is freed by uev_exit(), so @arg says if to exit */
+static void recv_cb(uev_t *w, void *arg, int UNUSED(events), uev_buf_t *buf)
+{
+	fail_unless(buf && buf->len == 5);
+	stamp = buf->stamp;
+	calls++;
+	if (arg)
+		uev_exit(w->ctx);
+}
+
+static void udp_pair(int sv[2])
+{
+	struct sockaddr_in sin = { .sin_family = AF_INET };
+	socklen_t len = sizeof(sin);
+
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	sv[0] = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+	fail_unless(!bind(sv[0], (struct sockaddr *)&sin, sizeof(sin)));
+	fail_unless(!getsockname(sv[0], (struct sockaddr *)&sin, &len));
+
+	sv[1] = socket(AF_INET, SOCK_DGRAM, 0);
+	fail_unless(!connect(sv[1], (struct sockaddr *)&sin, sizeof(sin)));
+}
+
+/* Datagram waits @msec in the kernel before the loop runs */
+static void receive(uev_ctx_t *ctx, int sv[2], int on, int msec)
+{
+	uev_t w;
+
+	fail_unless(!uev_init(ctx));
+	fail_unless(!uev_recv_init(ctx, &w, recv_cb, ctx, sv[0], 512));
+	if (on)
+		fail_unless(!uev_recv_timestamp(&w, 1));
+
+	fail_unless(write(sv[1], "hello", 5) == 5);
+	usleep(msec * 1000);
+	fail_unless(!uev_run(ctx, 0));
+}
+
+static int timestamp(void)
+{
+	struct timespec now;
+	uev_delay_t d;
+	uev_ctx_t ctx;
+	int sv[2], pfd[2], i, slow = 0;
+	uev_t w;
+
+	udp_pair(sv);
+
+	/* Not enabled */
+	receive(&ctx, sv, 0, 0);
+	fail_unless(calls == 1 && !stamp.tv_sec && !stamp.tv_nsec);
+
+	/* Enabled, 20 ms in the receive queue */
+	receive(&ctx, sv, 1, 20);
+	clock_gettime(CLOCK_REALTIME, &now);
+	fail_unless(calls == 2 && stamp.tv_sec);
+	fail_unless(stamp.tv_sec <= now.tv_sec && stamp.tv_sec >= now.tv_sec - 2);
+
+	/* 20 ms is in bucket 15, or later */
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_recv_init(&ctx, &w, recv_cb, NULL, sv[0], 512));
+	fail_unless(!uev_recv_timestamp(&w, 1));
+	fail_unless(write(sv[1], "hello", 5) == 5);
+	usleep(20000);
+	fail_unless(!uev_run(&ctx, UEV_ONCE));
+	fail_unless(!uev_recv_delay(&ctx, &d, 1));
+	fail_unless(d.count == 1 && d.max >= 20000 && d.total == d.max);
+	for (i = 15; i < UEV_DELAY_BUCKETS; i++)
+		slow += d.hist[i];
+	fail_unless(slow == 1);
+	fail_unless(!uev_recv_delay(&ctx, &d, 0) && d.count == 0);
+	uev_exit(&ctx);
+
+	/* Only sockets have receive timestamps */
+	fail_unless(!pipe(pfd));
+	fail_unless(!uev_init(&ctx));
+	fail_unless(!uev_recv_init(&ctx, &w, recv_cb, NULL, pfd[0], 512));
+	fail_unless(uev_recv_timestamp(&w, 1) && errno == ENOTSOCK);
+	fail_unless(!uev_recv_delay(&ctx, &d, 0) && d.count == 0);
+	uev_exit(&ctx);
+
+	close(pfd[0]);
+	close(pfd[1]);
+	close(sv[0]);
+	close(sv[1]);
+
+	return 0;
+}
+
+int main(void)
+{
+	return test(timestamp(), "receive watcher, kernel timestamps");
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */